@@ -0,0 +1,272 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"  // IWYU pragma: keep
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir {
+namespace sdy {
+
+#define GEN_PASS_DEF_DECOMPOSESHARDEDFFTPASS
+#include "shardy/dialect/sdy/transforms/export/passes.h.inc"
+
+namespace {
+
+using stablehlo::FftType;
+
+using AxesPerDim = SmallVector<SmallVector<AxisRefAttr>>;
+
+// A 1-D FFT along `dim`, applied to a tensor whose dimensions are sharded
+// along `axesPerDim`.
+struct FftStage {
+  int64_t dim;
+  AxesPerDim axesPerDim;
+  // Whether the axes sharding the tensor differ from the previous stage.
+  bool resharded;
+};
+
+bool isInverseFft(FftType fftType) {
+  return fftType == FftType::IFFT || fftType == FftType::IRFFT;
+}
+
+int64_t getAxesSize(ArrayRef<AxisRefAttr> axes, MeshAttr mesh) {
+  int64_t size = 1;
+  for (AxisRefAttr axis : axes) {
+    size *= axis.getSize(mesh);
+  }
+  return size;
+}
+
+// Returns whether `lhs` and `rhs` shard each dimension along the same axes,
+// regardless of whether the dimensions are open or closed.
+bool haveSameAxes(TensorShardingAttr lhs, TensorShardingAttr rhs) {
+  return lhs.getMeshName() == rhs.getMeshName() &&
+         llvm::equal(lhs.getDimShardings(), rhs.getDimShardings(),
+                     [](DimensionShardingAttr lhsDim,
+                        DimensionShardingAttr rhsDim) {
+                       return lhsDim.getAxes() == rhsDim.getAxes();
+                     });
+}
+
+// Plans the 1-D FFT stages of `fft`, such that the dimension transformed by
+// each stage is unsharded, by moving its axes to another dimension that stays
+// evenly sharded. The axes are moved to the most recently transformed dimension
+// if possible, then to a batch dimension, and otherwise to a dimension that is
+// transformed by a later stage.
+//
+// Returns an empty vector if the axes of some dimension can't be moved.
+SmallVector<FftStage> planFftStages(stablehlo::FftOp fft,
+                                    TensorShardingAttr operandSharding,
+                                    MeshAttr mesh) {
+  auto operandType = cast<RankedTensorType>(fft.getOperand().getType());
+  auto resultType = cast<RankedTensorType>(fft.getType());
+  const int64_t rank = operandType.getRank();
+  const int64_t firstFftDim = rank - fft.getFftLength().size();
+  const bool isInverse = isInverseFft(fft.getFftType());
+
+  // Forward FFTs transform the last dimension first, since it's the one that
+  // changes from real to complex, and inverse FFTs transform it last.
+  SmallVector<int64_t> stageDims =
+      llvm::to_vector(llvm::seq<int64_t>(firstFftDim, rank));
+  if (!isInverse) {
+    std::reverse(stageDims.begin(), stageDims.end());
+  }
+
+  AxesPerDim axesPerDim = llvm::map_to_vector(
+      operandSharding.getDimShardings(),
+      [](DimensionShardingAttr dimSharding) {
+        return llvm::to_vector(dimSharding.getAxes());
+      });
+  // The shape only changes after the stage that transforms the last dimension.
+  SmallVector<int64_t> shape(operandType.getShape());
+
+  SmallVector<FftStage> stages;
+  for (auto [stageIndex, dim] : llvm::enumerate(stageDims)) {
+    bool resharded = false;
+    if (!axesPerDim[dim].empty()) {
+      SmallVector<int64_t> candidateDims(
+          llvm::reverse(ArrayRef(stageDims).take_front(stageIndex)));
+      llvm::append_range(candidateDims, llvm::seq<int64_t>(0, firstFftDim));
+      llvm::append_range(candidateDims,
+                         ArrayRef(stageDims).drop_front(stageIndex + 1));
+      const int64_t movedSize = getAxesSize(axesPerDim[dim], mesh);
+      const auto* tgtDimIt = llvm::find_if(candidateDims, [&](int64_t tgtDim) {
+        return shape[tgtDim] %
+                   (getAxesSize(axesPerDim[tgtDim], mesh) * movedSize) ==
+               0;
+      });
+      if (tgtDimIt == candidateDims.end()) {
+        return {};
+      }
+      for (AxisRefAttr axis : axesPerDim[dim]) {
+        addAxisOrMerge(axesPerDim[*tgtDimIt], axis, mesh);
+      }
+      axesPerDim[dim].clear();
+      resharded = true;
+    }
+    stages.push_back({dim, axesPerDim, resharded});
+    if (dim == rank - 1) {
+      shape.back() = resultType.getShape().back();
+    }
+  }
+  return stages;
+}
+
+// Decomposes `fft` into a sequence of 1-D FFTs, one per transformed dimension,
+// if any of the transformed dimensions of its operand is sharded (a pencil
+// decomposition).
+//
+// Each stage transposes the dimension it transforms to be the last one, applies
+// a 1-D FFT along it, and transposes the result back. Before each stage, the
+// axes sharding the transformed dimension are moved to another dimension via a
+// reshard, which amounts to an all-to-all, so that the tensor is never
+// replicated along those axes.
+void decomposeShardedFft(stablehlo::FftOp fft, IRRewriter& rewriter) {
+  ArrayRef<int64_t> fftLength = fft.getFftLength();
+  if (fftLength.size() < 2) {
+    return;
+  }
+  Value operand = fft.getOperand();
+  TensorShardingAttr operandSharding = getSharding(operand);
+  auto operandType = dyn_cast<RankedTensorType>(operand.getType());
+  auto resultType = dyn_cast<RankedTensorType>(fft.getType());
+  if (!operandSharding || !operandType || !operandType.hasStaticShape() ||
+      !resultType || !resultType.hasStaticShape()) {
+    return;
+  }
+  const int64_t rank = operandType.getRank();
+  const int64_t firstFftDim = rank - fftLength.size();
+  if (llvm::none_of(llvm::seq<int64_t>(firstFftDim, rank), [&](int64_t dim) {
+        return !operandSharding.getDimSharding(dim).emptyAxes();
+      })) {
+    return;
+  }
+  MeshAttr mesh = operandSharding.getMesh(fft);
+  assert(mesh && "unknown mesh");
+
+  SmallVector<FftStage> stages = planFftStages(fft, operandSharding, mesh);
+  if (stages.empty()) {
+    return;
+  }
+
+  MLIRContext* ctx = fft.getContext();
+  Location loc = fft.getLoc();
+  auto getStageSharding = [&](const AxesPerDim& axesPerDim) {
+    SmallVector<DimensionShardingAttr> dimShardings = llvm::map_to_vector(
+        axesPerDim, [&](ArrayRef<AxisRefAttr> axes) {
+          return DimensionShardingAttr::get(ctx, axes, /*isClosed=*/true);
+        });
+    return TensorShardingAttr::get(ctx, operandSharding.getMeshOrRef(),
+                                   dimShardings,
+                                   operandSharding.getReplicatedAxes());
+  };
+
+  const bool isInverse = isInverseFft(fft.getFftType());
+  rewriter.setInsertionPoint(fft);
+  Value current = operand;
+  for (const FftStage& stage : stages) {
+    TensorShardingAttr stageSharding = getStageSharding(stage.axesPerDim);
+    if (stage.resharded) {
+      current = rewriter.create<ReshardOp>(loc, current, stageSharding);
+    }
+    auto currentType = cast<RankedTensorType>(current.getType());
+
+    const bool isLastDim = stage.dim == rank - 1;
+    SmallVector<int64_t> permutation =
+        llvm::to_vector(llvm::seq<int64_t>(0, rank));
+    std::swap(permutation[stage.dim], permutation.back());
+    TensorShardingAttr permutedSharding = getStageSharding(
+        llvm::map_to_vector(permutation, [&](int64_t dim) {
+          return stage.axesPerDim[dim];
+        }));
+    auto permuteType = [&](RankedTensorType type) {
+      return RankedTensorType::get(
+          llvm::map_to_vector(
+              permutation, [&](int64_t dim) { return type.getDimSize(dim); }),
+          type.getElementType());
+    };
+
+    Value stageInput = current;
+    if (!isLastDim) {
+      auto transpose = rewriter.create<stablehlo::TransposeOp>(
+          loc, permuteType(currentType), current, permutation);
+      setSharding(transpose, permutedSharding);
+      stageInput = transpose;
+    }
+
+    FftType stageFftType = fft.getFftType();
+    int64_t stageLength = fftLength.back();
+    auto stageType = cast<RankedTensorType>(stageInput.getType());
+    if (isLastDim) {
+      SmallVector<int64_t> stageShape(currentType.getShape());
+      stageShape.back() = resultType.getShape().back();
+      stageType =
+          RankedTensorType::get(stageShape, resultType.getElementType());
+    } else {
+      stageFftType = isInverse ? FftType::IFFT : FftType::FFT;
+      stageLength = fftLength[stage.dim - firstFftDim];
+    }
+    auto stageFft = rewriter.create<stablehlo::FftOp>(
+        loc, stageType, stageInput, stageFftType, ArrayRef(stageLength));
+    setSharding(stageFft, isLastDim ? stageSharding : permutedSharding);
+    current = stageFft;
+
+    if (!isLastDim) {
+      auto transpose = rewriter.create<stablehlo::TransposeOp>(
+          loc, currentType, current, permutation);
+      setSharding(transpose, stageSharding);
+      current = transpose;
+    }
+  }
+
+  if (TensorShardingAttr resultSharding = getSharding(fft.getResult());
+      resultSharding && !haveSameAxes(resultSharding, getSharding(current))) {
+    current = rewriter.create<ReshardOp>(loc, current, resultSharding);
+  }
+  rewriter.replaceOp(fft, current);
+}
+
+struct DecomposeShardedFftPass
+    : public impl::DecomposeShardedFftPassBase<DecomposeShardedFftPass> {
+  using DecomposeShardedFftPassBase::DecomposeShardedFftPassBase;
+
+  void runOnOperation() final {
+    func::FuncOp funcOp = getOperation();
+    IRRewriter rewriter(funcOp);
+    funcOp.walk(
+        [&](stablehlo::FftOp fft) { decomposeShardedFft(fft, rewriter); });
+  }
+};
+
+}  // namespace
+
+}  // namespace sdy
+}  // namespace mlir
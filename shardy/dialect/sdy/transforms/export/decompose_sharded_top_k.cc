@@ -0,0 +1,244 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cassert>
+#include <cstdint>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"  // IWYU pragma: keep
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/constants.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir {
+namespace sdy {
+
+#define GEN_PASS_DEF_DECOMPOSESHARDEDTOPKPASS
+#include "shardy/dialect/sdy/transforms/export/passes.h.inc"
+
+namespace {
+
+using stablehlo::ComparisonDirection;
+using stablehlo::ComparisonType;
+
+constexpr StringRef kTopKTarget = "mhlo.topk";
+
+// Returns whether the `mhlo.topk` custom call returns the largest elements,
+// which is the default if the `largest` attribute is missing.
+bool isLargestTopK(stablehlo::CustomCallOp topK) {
+  auto attributes = topK->getAttrOfType<DictionaryAttr>("mhlo.attributes");
+  if (!attributes) {
+    return true;
+  }
+  auto largest = attributes.getAs<BoolAttr>("largest");
+  return !largest || largest.getValue();
+}
+
+// Returns `sharding` with the sharding of its last dimension replaced by the
+// given `lastDimShardings`.
+TensorShardingAttr replaceLastDimSharding(
+    TensorShardingAttr sharding,
+    ArrayRef<DimensionShardingAttr> lastDimShardings) {
+  SmallVector<DimensionShardingAttr> dimShardings(
+      sharding.getDimShardings().drop_back());
+  llvm::append_range(dimShardings, lastDimShardings);
+  return TensorShardingAttr::get(sharding.getContext(),
+                                 sharding.getMeshOrRef(), dimShardings,
+                                 sharding.getReplicatedAxes());
+}
+
+// Creates a comparator in the region of `sort` that orders the candidate
+// values, i.e. its first input, in the order of `topK`, and keeps the order of
+// equal values, since `sort` is stable.
+void createComparator(stablehlo::SortOp sort, stablehlo::CustomCallOp topK,
+                      IRRewriter& rewriter) {
+  SmallVector<Type> argTypes;
+  SmallVector<Location> argLocs;
+  for (Value input : sort.getInputs()) {
+    auto scalarType = RankedTensorType::get(
+        {}, cast<ShapedType>(input.getType()).getElementType());
+    argTypes.append(2, scalarType);
+    argLocs.append(2, sort.getLoc());
+  }
+  OpBuilder::InsertionGuard guard(rewriter);
+  Block* block = rewriter.createBlock(&sort.getComparator(),
+                                      sort.getComparator().end(), argTypes,
+                                      argLocs);
+  Type elementType = getElementTypeOrSelf(argTypes.front());
+  auto compare = rewriter.create<stablehlo::CompareOp>(
+      sort.getLoc(), block->getArgument(0), block->getArgument(1),
+      isLargestTopK(topK) ? ComparisonDirection::GT : ComparisonDirection::LT,
+      isa<FloatType>(elementType) ? ComparisonType::TOTALORDER
+                                  : ComparisonType::NOTYPE);
+  rewriter.create<stablehlo::ReturnOp>(sort.getLoc(), compare.getResult());
+}
+
+// Decomposes `topK` into a local top-k on each shard of the last dimension of
+// its operand, followed by a final top-k on the candidates of all shards, if
+// the last dimension of the operand is sharded and the candidates are fewer
+// than the elements of that dimension.
+//
+// For example, given an operand `tensor<BxNxf32>` whose last dimension is
+// sharded along axes of size S, and a top-k of `k` elements:
+// 1. reshape the operand into `tensor<BxSx(N/S)xf32>`, sharded along the same
+//    axes in dimension S,
+// 2. apply the top-k on the last dimension, which is local to each shard,
+// 3. add the offset of each shard to the local indices,
+// 4. reshape the candidates into `tensor<Bx(S*k)xf32>`,
+// 5. sort the candidate values and indices, which requires all-gathering only
+//    the S*k candidates,
+// 6. slice the first `k` elements of the sorted values and indices.
+void decomposeShardedTopK(stablehlo::CustomCallOp topK, IRRewriter& rewriter) {
+  if (topK.getCallTargetName() != kTopKTarget || topK.getNumOperands() != 1 ||
+      topK.getNumResults() != 2) {
+    return;
+  }
+  Value operand = topK.getOperand(0);
+  TensorShardingAttr operandSharding = getSharding(operand);
+  auto operandType = dyn_cast<RankedTensorType>(operand.getType());
+  if (!operandSharding || !operandType || !operandType.hasStaticShape() ||
+      operandType.getRank() == 0) {
+    return;
+  }
+  MeshAttr mesh = operandSharding.getMesh(topK);
+  assert(mesh && "unknown mesh");
+
+  DimensionShardingAttr lastDimSharding =
+      operandSharding.getDimShardings().back();
+  const int64_t numShards = lastDimSharding.getShardedSize(mesh);
+  const int64_t dimSize = operandType.getShape().back();
+  auto valuesType = cast<RankedTensorType>(topK.getResult(0).getType());
+  auto indicesType = cast<RankedTensorType>(topK.getResult(1).getType());
+  const int64_t k = valuesType.getShape().back();
+  if (numShards == 1 || dimSize % numShards != 0 ||
+      k * numShards >= dimSize) {
+    return;
+  }
+
+  MLIRContext* ctx = topK.getContext();
+  Location loc = topK.getLoc();
+  const int64_t shardSize = dimSize / numShards;
+  auto unshardedDim = DimensionShardingAttr::get(ctx, {}, /*isClosed=*/true);
+  TensorShardingAttr splitSharding = replaceLastDimSharding(
+      operandSharding, {lastDimSharding, unshardedDim});
+  TensorShardingAttr candidatesSharding =
+      replaceLastDimSharding(operandSharding, lastDimSharding);
+
+  auto getTypeWithLastDims = [](RankedTensorType type,
+                                ArrayRef<int64_t> lastDims) {
+    SmallVector<int64_t> shape(type.getShape().drop_back());
+    llvm::append_range(shape, lastDims);
+    return RankedTensorType::get(shape, type.getElementType());
+  };
+
+  rewriter.setInsertionPoint(topK);
+  auto splitOperand = rewriter.create<stablehlo::ReshapeOp>(
+      loc, getTypeWithLastDims(operandType, {numShards, shardSize}), operand);
+  setSharding(splitOperand, splitSharding);
+
+  // Local top-k per shard.
+  Operation* localTopK = rewriter.clone(*topK);
+  localTopK->setOperand(0, splitOperand);
+  localTopK->getResult(0).setType(
+      getTypeWithLastDims(valuesType, {numShards, k}));
+  localTopK->getResult(1).setType(
+      getTypeWithLastDims(indicesType, {numShards, k}));
+  localTopK->removeAttr(kShardingRuleAttr);
+  setShardings(localTopK, {splitSharding, splitSharding});
+
+  // Convert the local indices into indices of the original operand.
+  auto localIndicesType =
+      cast<RankedTensorType>(localTopK->getResult(1).getType());
+  auto shardIndex = rewriter.create<stablehlo::IotaOp>(
+      loc, localIndicesType, localIndicesType.getRank() - 2);
+  setSharding(shardIndex, splitSharding);
+  auto shardSizeConstant = rewriter.create<stablehlo::ConstantOp>(
+      loc, SplatElementsAttr::get(
+               localIndicesType,
+               rewriter.getIntegerAttr(localIndicesType.getElementType(),
+                                       shardSize)));
+  setSharding(shardSizeConstant, splitSharding);
+  auto shardOffset = rewriter.create<stablehlo::MulOp>(
+      loc, localIndicesType, shardIndex, shardSizeConstant);
+  setSharding(shardOffset, splitSharding);
+  auto globalIndices = rewriter.create<stablehlo::AddOp>(
+      loc, localIndicesType, localTopK->getResult(1), shardOffset);
+  setSharding(globalIndices, splitSharding);
+
+  // Final top-k on the candidates of all shards.
+  auto candidateValues = rewriter.create<stablehlo::ReshapeOp>(
+      loc, getTypeWithLastDims(valuesType, numShards * k),
+      localTopK->getResult(0));
+  setSharding(candidateValues, candidatesSharding);
+  auto candidateIndices = rewriter.create<stablehlo::ReshapeOp>(
+      loc, getTypeWithLastDims(indicesType, numShards * k), globalIndices);
+  setSharding(candidateIndices, candidatesSharding);
+
+  StringRef meshName = operandSharding.getMeshName();
+  SmallVector<TensorShardingAttr> resultShardings = llvm::map_to_vector(
+      topK.getResults(),
+      [&](Value result) { return getOrCreateSharding(result, meshName); });
+  auto sort = rewriter.create<stablehlo::SortOp>(
+      loc, ValueRange{candidateValues, candidateIndices},
+      /*dimension=*/valuesType.getRank() - 1, /*isStable=*/true);
+  createComparator(sort, topK, rewriter);
+  setShardings(sort, llvm::map_to_vector(
+                         resultShardings, [&](TensorShardingAttr sharding) {
+                           return replaceLastDimSharding(sharding,
+                                                         unshardedDim);
+                         }));
+
+  SmallVector<int64_t> startIndices(valuesType.getRank(), 0);
+  SmallVector<int64_t> strides(valuesType.getRank(), 1);
+  SmallVector<Value> results;
+  for (auto [sorted, resultSharding] :
+       llvm::zip_equal(sort.getResults(), resultShardings)) {
+    auto slice = rewriter.create<stablehlo::SliceOp>(
+        loc, sorted, startIndices, valuesType.getShape(), strides);
+    setSharding(slice, resultSharding);
+    results.push_back(slice);
+  }
+  rewriter.replaceOp(topK, results);
+}
+
+struct DecomposeShardedTopKPass
+    : public impl::DecomposeShardedTopKPassBase<DecomposeShardedTopKPass> {
+  using DecomposeShardedTopKPassBase::DecomposeShardedTopKPassBase;
+
+  void runOnOperation() final {
+    func::FuncOp funcOp = getOperation();
+    IRRewriter rewriter(funcOp);
+    funcOp.walk([&](stablehlo::CustomCallOp customCall) {
+      decomposeShardedTopK(customCall, rewriter);
+    });
+  }
+};
+
+}  // namespace
+
+}  // namespace sdy
+}  // namespace mlir
@@ -36,6 +36,8 @@ void addExportPipeline(OpPassManager& pm, StringRef dumpDirectory,
   pm.addPass(mlir::sdy::createSaveModuleOpPass(dumpDirectory,
                                                "sdy_module_after_sdy_export"));
   if (enableInsertExplicitCollectives) {
+    pm.addNestedPass<func::FuncOp>(createDecomposeShardedFftPass());
+    pm.addNestedPass<func::FuncOp>(createDecomposeShardedTopKPass());
     pm.addNestedPass<func::FuncOp>(createCloseShardingsPass());
     pm.addNestedPass<func::FuncOp>(createInsertExplicitReshardsPass());
     pm.addPass(mlir::sdy::createSaveModuleOpPass(
@@ -16,6 +16,7 @@ limitations under the License.
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <numeric>
 #include <optional>
 
 #include "llvm/ADT/Hashing.h"
@@ -23,6 +24,7 @@ limitations under the License.
 #include "llvm/ADT/SmallVector.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"  // IWYU pragma: keep
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/SymbolTable.h"
@@ -516,13 +518,71 @@ AxesPerFactor findCommonAxesOnUnaryOperation(
   return factorAxisRefs;
 }
 
+// Adds `axisRef` to the first batching factor, in order, whose available
+// capacity, i.e., factor size divided by its current sharding size, is
+// divisible by the size of `axisRef`. Returns false if there is no such factor.
+bool addAxisRefToBatchingFactor(AxisRefAttr axisRef,
+                                ArrayRef<int64_t> batchingFactors,
+                                OpShardingRuleAttr shardingRule, MeshAttr mesh,
+                                AxesPerFactor& factorCommonAxes) {
+  const int64_t axisSize = axisRef.getSize(mesh);
+  for (const int64_t factorIndex : batchingFactors) {
+    SmallVector<AxisRefAttr>& factorSharding = factorCommonAxes[factorIndex];
+    const int64_t factorCapacity =
+        shardingRule.getFactorSizes()[factorIndex] /
+        AxisListRef(factorSharding).getShardingSize(mesh);
+    if (factorCapacity % axisSize == 0) {
+      addAxisOrMerge(factorSharding, axisRef, mesh);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Splits `axisRef` into sub-axes, from major to minor, and adds each of them to
+// a batching factor, in order, whose available capacity is divisible by it.
+// Returns false if the remaining minor sub-axis of `axisRef` does not fit into
+// any of the batching factors, in which case only that minor sub-axis is not
+// added, while the major sub-axes added so far are kept.
+bool splitAxisRefToBatchingFactors(AxisRefAttr axisRef,
+                                   ArrayRef<int64_t> batchingFactors,
+                                   OpShardingRuleAttr shardingRule,
+                                   MeshAttr mesh,
+                                   AxesPerFactor& factorCommonAxes) {
+  MLIRContext* ctx = mesh.getContext();
+  int64_t preSize = axisRef.getSubAxisPreSize();
+  int64_t remainingSize = axisRef.getSize(mesh);
+  for (const int64_t factorIndex : batchingFactors) {
+    SmallVector<AxisRefAttr>& factorSharding = factorCommonAxes[factorIndex];
+    const int64_t factorCapacity =
+        shardingRule.getFactorSizes()[factorIndex] /
+        AxisListRef(factorSharding).getShardingSize(mesh);
+    const int64_t gcd = std::gcd(factorCapacity, remainingSize);
+    if (gcd == 1) {
+      continue;
+    }
+    addAxisOrMerge(factorSharding,
+                   AxisRefAttr::get(ctx, axisRef.getName(),
+                                    SubAxisInfoAttr::get(ctx, preSize, gcd)),
+                   mesh);
+    preSize *= gcd;
+    remainingSize /= gcd;
+    if (remainingSize == 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Distributes `axisRefsToDistribute`, in order, to batching factors. Each axis
+// is added as a whole to the first batching factor that can fit it, and if
+// there is no such factor, it is split into sub-axes across multiple batching
+// factors. Stops at the first axis that can not be distributed, as the axes
+// that follow would otherwise be used without their major axis.
 void distributeAxisRefsToBatchingFactors(
     ArrayRef<AxisRefAttr> axisRefsToDistribute, OpShardingRuleAttr shardingRule,
     MeshAttr mesh, AxesPerFactor& factorCommonAxes) {
-  // TODO(enver): Instead iterate batching factors in the order of their
-  // available capacity, the one with largest available capacity being the
-  // first one to distribute `axisRefsToDistribute`. Sort first, and then
-  // iterate over sorted list.
+  SmallVector<int64_t> batchingFactors;
   for (const int64_t factorIndex : shardingRule.getBatchingFactors()) {
     const int64_t factorSize = shardingRule.getFactorSizes()[factorIndex];
     // Skip if a factor has size zero which could happen if the correspoinding
@@ -530,35 +590,26 @@ void distributeAxisRefsToBatchingFactors(
     if (factorSize == 0) {
       continue;
     }
-    SmallVector<AxisRefAttr>& factorSharding = factorCommonAxes[factorIndex];
-    const int64_t factorShardingSize =
-        AxisListRef(factorSharding).getShardingSize(mesh);
-    // NOTE: Here, `factorSize` can be smaller than `factorShardingSize` as in
-    // some cases it is allowed to have shardings larger than its size.
-    if ((factorSize % factorShardingSize) != 0) {
-      // Skip the factor if factor size does not divide its sharding size,
-      // hence a new axis can not be appended properly.
+    // NOTE: Here, `factorSize` can be smaller than the factor sharding size as
+    // in some cases it is allowed to have shardings larger than its size.
+    // Skip the factor if factor size does not divide its sharding size, hence
+    // a new axis can not be appended properly.
+    if (factorSize %
+            AxisListRef(factorCommonAxes[factorIndex]).getShardingSize(mesh) !=
+        0) {
       continue;
     }
-    int64_t factorCapacity = factorSize / factorShardingSize;
-    while (!axisRefsToDistribute.empty()) {
-      AxisRefAttr axisRef = axisRefsToDistribute.front();
-      const int64_t axisSize = axisRef.getSize(mesh);
-      // TODO(enver): Split `axisRef` to fit it into the batching factor's
-      // available space. The gcd of `axisSize` and `factorCapacity` should fit
-      // to the batching factor.
-      // The following check also guarantees that `factorCapacity` is not
-      // smaller than `axisSize`.
-      if (factorCapacity % axisSize != 0) {
-        break;
-      }
-      addAxisOrMerge(factorSharding, axisRef, mesh);
-
-      factorCapacity /= axisSize;
-      axisRefsToDistribute = axisRefsToDistribute.drop_front();
-    }
-    if (axisRefsToDistribute.empty()) {
-      break;
+    batchingFactors.push_back(factorIndex);
+  }
+  // TODO(enver): Instead iterate batching factors in the order of their
+  // available capacity, the one with largest available capacity being the
+  // first one to distribute `axisRefsToDistribute`.
+  for (AxisRefAttr axisRef : axisRefsToDistribute) {
+    if (!addAxisRefToBatchingFactor(axisRef, batchingFactors, shardingRule,
+                                    mesh, factorCommonAxes) &&
+        !splitAxisRefToBatchingFactors(axisRef, batchingFactors, shardingRule,
+                                       mesh, factorCommonAxes)) {
+      return;
     }
   }
 }
@@ -0,0 +1,100 @@
+// RUN: sdy_opt %s -sdy-decompose-sharded-fft | FileCheck %s
+
+sdy.mesh @mesh = <["x"=4, "y"=2]>
+
+// CHECK-LABEL: func @fft_first_fft_dim_sharded
+func.func @fft_first_fft_dim_sharded(%arg0: tensor<8x32x64xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}, {}]>}) -> tensor<8x32x64xcomplex<f32>> {
+  // CHECK-NEXT: %[[FFT_0:.*]] = stablehlo.fft %arg0, type = {{ *}}FFT, length = [64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"x"}, {}]>]>} : (tensor<8x32x64xcomplex<f32>>) -> tensor<8x32x64xcomplex<f32>>
+  // CHECK-NEXT: %[[RESHARD:.*]] = sdy.reshard %[[FFT_0]] <@mesh, [{}, {}, {"x"}]> : tensor<8x32x64xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_0:.*]] = stablehlo.transpose %[[RESHARD]], dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"x"}, {}]>]>} : (tensor<8x32x64xcomplex<f32>>) -> tensor<8x64x32xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_1:.*]] = stablehlo.fft %[[TRANSPOSE_0]], type = {{ *}}FFT, length = [32] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"x"}, {}]>]>} : (tensor<8x64x32xcomplex<f32>>) -> tensor<8x64x32xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_1:.*]] = stablehlo.transpose %[[FFT_1]], dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {}, {"x"}]>]>} : (tensor<8x64x32xcomplex<f32>>) -> tensor<8x32x64xcomplex<f32>>
+  // CHECK-NEXT: return %[[TRANSPOSE_1]]
+  %0 = stablehlo.fft %arg0, type = FFT, length = [32, 64] : (tensor<8x32x64xcomplex<f32>>) -> tensor<8x32x64xcomplex<f32>>
+  return %0 : tensor<8x32x64xcomplex<f32>>
+}
+
+// The axes can't be moved to the truncated last dimension, so they are moved
+// to the batch dimension instead.
+// CHECK-LABEL: func @rfft_first_fft_dim_sharded
+func.func @rfft_first_fft_dim_sharded(%arg0: tensor<8x32x64xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}, {}]>}) -> tensor<8x32x33xcomplex<f32>> {
+  // CHECK-NEXT: %[[FFT_0:.*]] = stablehlo.fft %arg0, type = {{ *}}RFFT, length = [64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"x"}, {}]>]>} : (tensor<8x32x64xf32>) -> tensor<8x32x33xcomplex<f32>>
+  // CHECK-NEXT: %[[RESHARD:.*]] = sdy.reshard %[[FFT_0]] <@mesh, [{"x"}, {}, {}]> : tensor<8x32x33xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_0:.*]] = stablehlo.transpose %[[RESHARD]], dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}, {}]>]>} : (tensor<8x32x33xcomplex<f32>>) -> tensor<8x33x32xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_1:.*]] = stablehlo.fft %[[TRANSPOSE_0]], type = {{ *}}FFT, length = [32] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}, {}]>]>} : (tensor<8x33x32xcomplex<f32>>) -> tensor<8x33x32xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_1:.*]] = stablehlo.transpose %[[FFT_1]], dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}, {}]>]>} : (tensor<8x33x32xcomplex<f32>>) -> tensor<8x32x33xcomplex<f32>>
+  // CHECK-NEXT: return %[[TRANSPOSE_1]]
+  %0 = stablehlo.fft %arg0, type = RFFT, length = [32, 64] : (tensor<8x32x64xf32>) -> tensor<8x32x33xcomplex<f32>>
+  return %0 : tensor<8x32x33xcomplex<f32>>
+}
+
+// Without batch dimensions, the axes are moved back and forth between the
+// transformed dimensions.
+// CHECK-LABEL: func @ifft_without_batch_dims
+func.func @ifft_without_batch_dims(%arg0: tensor<32x64xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{"x"}, {}]>}) -> tensor<32x64xcomplex<f32>> {
+  // CHECK-NEXT: %[[RESHARD_0:.*]] = sdy.reshard %arg0 <@mesh, [{}, {"x"}]> : tensor<32x64xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_0:.*]] = stablehlo.transpose %[[RESHARD_0]], dims = [1, 0] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}]>]>} : (tensor<32x64xcomplex<f32>>) -> tensor<64x32xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_0:.*]] = stablehlo.fft %[[TRANSPOSE_0]], type = {{ *}}IFFT, length = [32] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}]>]>} : (tensor<64x32xcomplex<f32>>) -> tensor<64x32xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_1:.*]] = stablehlo.transpose %[[FFT_0]], dims = [1, 0] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"x"}]>]>} : (tensor<64x32xcomplex<f32>>) -> tensor<32x64xcomplex<f32>>
+  // CHECK-NEXT: %[[RESHARD_1:.*]] = sdy.reshard %[[TRANSPOSE_1]] <@mesh, [{"x"}, {}]> : tensor<32x64xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_1:.*]] = stablehlo.fft %[[RESHARD_1]], type = {{ *}}IFFT, length = [64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}]>]>} : (tensor<32x64xcomplex<f32>>) -> tensor<32x64xcomplex<f32>>
+  // CHECK-NEXT: return %[[FFT_1]]
+  %0 = stablehlo.fft %arg0, type = IFFT, length = [32, 64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x"}, {}]>]>} : (tensor<32x64xcomplex<f32>>) -> tensor<32x64xcomplex<f32>>
+  return %0 : tensor<32x64xcomplex<f32>>
+}
+
+// The result sharding only differs from the last stage in open dimensions, so
+// no reshard is added.
+// CHECK-LABEL: func @ifft_result_sharding_open
+func.func @ifft_result_sharding_open(%arg0: tensor<32x64xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{"x"}, {}]>}) -> tensor<32x64xcomplex<f32>> {
+  // CHECK:      %[[FFT_1:.*]] = stablehlo.fft %{{.*}}, type = {{ *}}IFFT, length = [64]
+  // CHECK-NEXT: return %[[FFT_1]]
+  %0 = stablehlo.fft %arg0, type = IFFT, length = [32, 64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x", ?}, {?}]>]>} : (tensor<32x64xcomplex<f32>>) -> tensor<32x64xcomplex<f32>>
+  return %0 : tensor<32x64xcomplex<f32>>
+}
+
+// The sub-axis moved to the batch dimension is merged with the one already
+// sharding it.
+// CHECK-LABEL: func @rfft_moved_sub_axis_merged
+func.func @rfft_moved_sub_axis_merged(%arg0: tensor<8x32x64xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"x":(1)2}, {"x":(2)2}, {}]>}) -> tensor<8x32x33xcomplex<f32>> {
+  // CHECK-NEXT: %[[FFT_0:.*]] = stablehlo.fft %arg0, type = {{ *}}RFFT, length = [64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x":(1)2}, {"x":(2)2}, {}]>]>}
+  // CHECK-NEXT: %[[RESHARD:.*]] = sdy.reshard %[[FFT_0]] <@mesh, [{"x"}, {}, {}]> : tensor<8x32x33xcomplex<f32>>
+  %0 = stablehlo.fft %arg0, type = RFFT, length = [32, 64] : (tensor<8x32x64xf32>) -> tensor<8x32x33xcomplex<f32>>
+  return %0 : tensor<8x32x33xcomplex<f32>>
+}
+
+// CHECK-LABEL: func @irfft_last_dim_sharded
+func.func @irfft_last_dim_sharded(%arg0: tensor<8x32x33xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{}, {}, {"y"}]>}) -> tensor<8x32x64xf32> {
+  // CHECK-NEXT: %[[TRANSPOSE_0:.*]] = stablehlo.transpose %arg0, dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"y"}, {}]>]>} : (tensor<8x32x33xcomplex<f32>>) -> tensor<8x33x32xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_0:.*]] = stablehlo.fft %[[TRANSPOSE_0]], type = {{ *}}IFFT, length = [32] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"y"}, {}]>]>} : (tensor<8x33x32xcomplex<f32>>) -> tensor<8x33x32xcomplex<f32>>
+  // CHECK-NEXT: %[[TRANSPOSE_1:.*]] = stablehlo.transpose %[[FFT_0]], dims = [0, 2, 1] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {}, {"y"}]>]>} : (tensor<8x33x32xcomplex<f32>>) -> tensor<8x32x33xcomplex<f32>>
+  // CHECK-NEXT: %[[RESHARD:.*]] = sdy.reshard %[[TRANSPOSE_1]] <@mesh, [{}, {"y"}, {}]> : tensor<8x32x33xcomplex<f32>>
+  // CHECK-NEXT: %[[FFT_1:.*]] = stablehlo.fft %[[RESHARD]], type = {{ *}}IRFFT, length = [64] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}, {"y"}, {}]>]>} : (tensor<8x32x33xcomplex<f32>>) -> tensor<8x32x64xf32>
+  // CHECK-NEXT: return %[[FFT_1]]
+  %0 = stablehlo.fft %arg0, type = IRFFT, length = [32, 64] : (tensor<8x32x33xcomplex<f32>>) -> tensor<8x32x64xf32>
+  return %0 : tensor<8x32x64xf32>
+}
+
+// CHECK-LABEL: func @rfft_axes_cannot_be_moved
+func.func @rfft_axes_cannot_be_moved(%arg0: tensor<32x64xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"x"}, {}]>}) -> tensor<32x33xcomplex<f32>> {
+  // CHECK-NEXT: stablehlo.fft %arg0, type = {{ *}}RFFT, length = [32, 64]
+  // CHECK-NOT:  sdy.reshard
+  %0 = stablehlo.fft %arg0, type = RFFT, length = [32, 64] : (tensor<32x64xf32>) -> tensor<32x33xcomplex<f32>>
+  return %0 : tensor<32x33xcomplex<f32>>
+}
+
+// CHECK-LABEL: func @fft_single_dim_not_decomposed
+func.func @fft_single_dim_not_decomposed(%arg0: tensor<8x64xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}]>}) -> tensor<8x64xcomplex<f32>> {
+  // CHECK-NEXT: stablehlo.fft %arg0, type = {{ *}}FFT, length = [64]
+  // CHECK-NOT:  sdy.reshard
+  %0 = stablehlo.fft %arg0, type = FFT, length = [64] : (tensor<8x64xcomplex<f32>>) -> tensor<8x64xcomplex<f32>>
+  return %0 : tensor<8x64xcomplex<f32>>
+}
+
+// CHECK-LABEL: func @fft_only_batch_dim_sharded
+func.func @fft_only_batch_dim_sharded(%arg0: tensor<8x32x64xcomplex<f32>> {sdy.sharding = #sdy.sharding<@mesh, [{"x"}, {}, {}]>}) -> tensor<8x32x64xcomplex<f32>> {
+  // CHECK-NEXT: stablehlo.fft %arg0, type = {{ *}}FFT, length = [32, 64]
+  // CHECK-NOT:  stablehlo.transpose
+  %0 = stablehlo.fft %arg0, type = FFT, length = [32, 64] : (tensor<8x32x64xcomplex<f32>>) -> tensor<8x32x64xcomplex<f32>>
+  return %0 : tensor<8x32x64xcomplex<f32>>
+}
@@ -0,0 +1,101 @@
+// RUN: sdy_opt %s -sdy-decompose-sharded-top-k | FileCheck %s
+
+sdy.mesh @mesh = <["x"=4, "y"=2]>
+
+// CHECK-LABEL: func @top_k_dim_sharded
+func.func @top_k_dim_sharded(%arg0: tensor<8x1024xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"y"}, {"x"}]>})
+    -> (tensor<8x2xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"y"}, {}]>}, tensor<8x2xi32> {sdy.sharding = #sdy.sharding<@mesh, [{"y"}, {}]>}) {
+  // CHECK-NEXT: %[[SPLIT:.*]] = stablehlo.reshape %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>]>} : (tensor<8x1024xf32>) -> tensor<8x4x256xf32>
+  // CHECK-NEXT: %[[LOCAL:.*]]:2 = stablehlo.custom_call @mhlo.topk(%[[SPLIT]])
+  // CHECK-SAME:   sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>, <@mesh, [{"y"}, {"x"}, {}]>]>
+  // CHECK-SAME:   (tensor<8x4x256xf32>) -> (tensor<8x4x2xf32>, tensor<8x4x2xi32>)
+  // CHECK-NEXT: %[[IOTA:.*]] = stablehlo.iota dim = 1 {{.*}}sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>]>} : tensor<8x4x2xi32>
+  // CHECK-NEXT: %[[SHARD_SIZE:.*]] = stablehlo.constant {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>]>} dense<256> : tensor<8x4x2xi32>
+  // CHECK-NEXT: %[[OFFSET:.*]] = stablehlo.multiply %[[IOTA]], %[[SHARD_SIZE]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>]>} : tensor<8x4x2xi32>
+  // CHECK-NEXT: %[[INDICES:.*]] = stablehlo.add %[[LOCAL]]#1, %[[OFFSET]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}, {}]>]>} : tensor<8x4x2xi32>
+  // CHECK-NEXT: %[[CANDIDATE_VALUES:.*]] = stablehlo.reshape %[[LOCAL]]#0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}]>]>} : (tensor<8x4x2xf32>) -> tensor<8x8xf32>
+  // CHECK-NEXT: %[[CANDIDATE_INDICES:.*]] = stablehlo.reshape %[[INDICES]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {"x"}]>]>} : (tensor<8x4x2xi32>) -> tensor<8x8xi32>
+  // CHECK-NEXT: %[[SORT:.*]]:2 = "stablehlo.sort"(%[[CANDIDATE_VALUES]], %[[CANDIDATE_INDICES]]) <{dimension = 1 : i64, is_stable = true}> ({
+  // CHECK-NEXT: ^bb0(%[[LHS:.*]]: tensor<f32>, %[[RHS:.*]]: tensor<f32>, %{{.*}}: tensor<i32>, %{{.*}}: tensor<i32>):
+  // CHECK-NEXT:   %[[COMPARE:.*]] = stablehlo.compare  GT, %[[LHS]], %[[RHS]],  TOTALORDER : (tensor<f32>, tensor<f32>) -> tensor<i1>
+  // CHECK-NEXT:   stablehlo.return %[[COMPARE]] : tensor<i1>
+  // CHECK-NEXT: }) {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {}]>, <@mesh, [{"y"}, {}]>]>} : (tensor<8x8xf32>, tensor<8x8xi32>) -> (tensor<8x8xf32>, tensor<8x8xi32>)
+  // CHECK-NEXT: %[[VALUES:.*]] = stablehlo.slice %[[SORT]]#0 [0:8, 0:2]  {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {}]>]>} : (tensor<8x8xf32>) -> tensor<8x2xf32>
+  // CHECK-NEXT: %[[RESULT_INDICES:.*]] = stablehlo.slice %[[SORT]]#1 [0:8, 0:2]  {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {}]>]>} : (tensor<8x8xi32>) -> tensor<8x2xi32>
+  // CHECK-NEXT: return %[[VALUES]], %[[RESULT_INDICES]]
+  %0:2 = stablehlo.custom_call @mhlo.topk(%arg0) {
+    mhlo.attributes = {k = 2 : i64, largest = true},
+    mhlo.version = 1 : i64,
+    sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"y"}, {}]>, <@mesh, [{"y"}, {}]>]>}
+    : (tensor<8x1024xf32>) -> (tensor<8x2xf32>, tensor<8x2xi32>)
+  return %0#0, %0#1 : tensor<8x2xf32>, tensor<8x2xi32>
+}
+
+// CHECK-LABEL: func @top_k_of_1d_smallest
+func.func @top_k_of_1d_smallest(%arg0: tensor<64xi32> {sdy.sharding = #sdy.sharding<@mesh, [{"x", "y"}]>}) -> (tensor<4xi32>, tensor<4xi32>) {
+  // CHECK-NEXT: %[[SPLIT:.*]] = stablehlo.reshape %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"x", "y"}, {}]>]>} : (tensor<64xi32>) -> tensor<8x8xi32>
+  // CHECK-NEXT: %[[LOCAL:.*]]:2 = stablehlo.custom_call @mhlo.topk(%[[SPLIT]])
+  // CHECK-SAME:   (tensor<8x8xi32>) -> (tensor<8x4xi32>, tensor<8x4xi32>)
+  // CHECK-NEXT: %[[IOTA:.*]] = stablehlo.iota dim = 0
+  // CHECK-NEXT: %[[SHARD_SIZE:.*]] = stablehlo.constant {{.*}} dense<8> : tensor<8x4xi32>
+  // CHECK:      stablehlo.reshape {{.*}} : (tensor<8x4xi32>) -> tensor<32xi32>
+  // CHECK-NEXT: stablehlo.reshape {{.*}} : (tensor<8x4xi32>) -> tensor<32xi32>
+  // CHECK-NEXT: %[[SORT:.*]]:2 = "stablehlo.sort"
+  // CHECK:        stablehlo.compare  LT, %{{.*}}, %{{.*}}
+  // CHECK:      }) {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{}]>, <@mesh, [{}]>]>}
+  // CHECK-NEXT: stablehlo.slice %[[SORT]]#0 [0:4] {{.*}} : (tensor<32xi32>) -> tensor<4xi32>
+  // CHECK-NEXT: stablehlo.slice %[[SORT]]#1 [0:4] {{.*}} : (tensor<32xi32>) -> tensor<4xi32>
+  %0:2 = stablehlo.custom_call @mhlo.topk(%arg0) {
+    mhlo.attributes = {k = 4 : i64, largest = false},
+    mhlo.version = 1 : i64}
+    : (tensor<64xi32>) -> (tensor<4xi32>, tensor<4xi32>)
+  return %0#0, %0#1 : tensor<4xi32>, tensor<4xi32>
+}
+
+// CHECK-LABEL: func @top_k_dim_not_sharded
+func.func @top_k_dim_not_sharded(%arg0: tensor<8x1024xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"x"}, {}]>}) -> (tensor<8x2xf32>, tensor<8x2xi32>) {
+  // CHECK-NEXT: stablehlo.custom_call @mhlo.topk(%arg0)
+  // CHECK-NOT:  stablehlo.sort
+  %0:2 = stablehlo.custom_call @mhlo.topk(%arg0) {
+    mhlo.attributes = {k = 2 : i64, largest = true},
+    mhlo.version = 1 : i64}
+    : (tensor<8x1024xf32>) -> (tensor<8x2xf32>, tensor<8x2xi32>)
+  return %0#0, %0#1 : tensor<8x2xf32>, tensor<8x2xi32>
+}
+
+// CHECK-LABEL: func @top_k_not_smaller_than_shard
+func.func @top_k_not_smaller_than_shard(%arg0: tensor<8x16xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}]>}) -> (tensor<8x4xf32>, tensor<8x4xi32>) {
+  // CHECK-NEXT: stablehlo.custom_call @mhlo.topk(%arg0)
+  // CHECK-NOT:  stablehlo.sort
+  %0:2 = stablehlo.custom_call @mhlo.topk(%arg0) {
+    mhlo.attributes = {k = 4 : i64, largest = true},
+    mhlo.version = 1 : i64}
+    : (tensor<8x16xf32>) -> (tensor<8x4xf32>, tensor<8x4xi32>)
+  return %0#0, %0#1 : tensor<8x4xf32>, tensor<8x4xi32>
+}
+
+// CHECK-LABEL: func @top_k_dim_not_divisible
+func.func @top_k_dim_not_divisible(%arg0: tensor<8x1022xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}]>}) -> (tensor<8x2xf32>, tensor<8x2xi32>) {
+  // CHECK-NEXT: stablehlo.custom_call @mhlo.topk(%arg0)
+  // CHECK-NOT:  stablehlo.sort
+  %0:2 = stablehlo.custom_call @mhlo.topk(%arg0) {
+    mhlo.attributes = {k = 2 : i64, largest = true},
+    mhlo.version = 1 : i64}
+    : (tensor<8x1022xf32>) -> (tensor<8x2xf32>, tensor<8x2xi32>)
+  return %0#0, %0#1 : tensor<8x2xf32>, tensor<8x2xi32>
+}
+
+// CHECK-LABEL: func @approx_top_k_not_decomposed
+func.func @approx_top_k_not_decomposed(%arg0: tensor<16x64xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"x"}]>}, %arg1: tensor<16x64xf32>, %arg2: tensor<f32>, %arg3: tensor<i32>) -> (tensor<16x2xf32>, tensor<16x2xf32>) {
+  // CHECK-NEXT: stablehlo.custom_call @ApproxTopK
+  // CHECK-NOT:  stablehlo.sort
+  %0:2 = stablehlo.custom_call @ApproxTopK(%arg0, %arg1, %arg2, %arg3) {
+    mhlo.backend_config = {
+      aggregate_to_topk = true,
+      recall_target = 0.9 : f32,
+      reduction_dim = 1 : i64,
+      reduction_input_size_override = -1 : i64,
+      top_k = 2 : i64}} :
+    (tensor<16x64xf32>, tensor<16x64xf32>, tensor<f32>, tensor<i32>) -> (tensor<16x2xf32>, tensor<16x2xf32>)
+  return %0#0, %0#1 : tensor<16x2xf32>, tensor<16x2xf32>
+}
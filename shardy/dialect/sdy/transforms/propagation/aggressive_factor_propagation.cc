@@ -19,6 +19,7 @@ limitations under the License.
 #include <cstdint>
 #include <tuple>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Sequence.h"
 #include "llvm/ADT/SmallVector.h"
@@ -33,15 +34,6 @@ namespace sdy {
 
 namespace {
 
-bool expandTensorSharding(ShardingProjection& projection, int64_t tensorIndex,
-                          int64_t factorIndex, ArrayRef<AxisRefAttr> newAxes) {
-  if (tensorIndex < projection.getNumOperands()) {
-    return projection.expandOperandSharding(tensorIndex, factorIndex, newAxes);
-  }
-  return projection.expandResultSharding(
-      tensorIndex - projection.getNumOperands(), factorIndex, newAxes);
-}
-
 struct TensorIndexSize {
   int64_t index;
   int64_t size;
@@ -84,6 +76,28 @@ SmallVector<TensorIndexSize> getFactorToSourceTensor(
 
 }  // namespace
 
+SmallVector<int64_t> AggressiveFactorPropagation::getFactorPreferenceOrder(
+    const ShardingProjection& projection, ArrayRef<int64_t> factorSizes,
+    AxesPerFactorRef axesPerFactor, MeshAttr, Operation*) const {
+  // We sort the factors based on:
+  // 1. larger source tensor size first
+  // 2. smaller source tensor index first
+  // 3. smaller factor index first
+  // Unstable sort is fine because there is no equality in the candidates.
+  // TODO(b/376233527): reevaluate this conflict resolution heuristic.
+  SmallVector<int64_t> sortedFactorIndices =
+      llvm::to_vector(llvm::seq<int64_t>(0, factorSizes.size()));
+  SmallVector<TensorIndexSize> factorToSourceTensor =
+      getFactorToSourceTensor(projection, factorSizes, axesPerFactor);
+  llvm::sort(sortedFactorIndices, [&](int64_t i, int64_t j) {
+    return std::forward_as_tuple(-factorToSourceTensor[i].size,
+                                 factorToSourceTensor[i].index, i) <
+           std::forward_as_tuple(-factorToSourceTensor[j].size,
+                                 factorToSourceTensor[j].index, j);
+  });
+  return sortedFactorIndices;
+}
+
 UpdateTensorShardings AggressiveFactorPropagation::propagateFactorShardings(
     ShardingProjection& projection,
     PropagationDirectionAlongFactor directionAlongFactor,
@@ -107,26 +121,16 @@ UpdateTensorShardings AggressiveFactorPropagation::propagateFactorShardings(
     return result;
   }
 
-  // We sort the factors based on:
-  // 1. larger source tensor size first
-  // 2. smaller source tensor index first
-  // 3. smaller factor index first
-  // Unstable sort is fine because there is no equality in the candidates.
-  // TODO(b/376233527): reevaluate this conflict resolution heuristic.
-  SmallVector<int64_t> sortedFactorIndices =
-      llvm::to_vector(llvm::seq<int64_t>(0, factorSizes.size()));
-  SmallVector<TensorIndexSize> factorToSourceTensor =
-      getFactorToSourceTensor(projection, factorSizes, axesPerFactor);
-  llvm::sort(sortedFactorIndices, [&](int64_t i, int64_t j) {
-    return std::forward_as_tuple(-factorToSourceTensor[i].size,
-                                 factorToSourceTensor[i].index, i) <
-           std::forward_as_tuple(-factorToSourceTensor[j].size,
-                                 factorToSourceTensor[j].index, j);
-  });
+  // Conflicts across factors are resolved in this order of preference.
+  SmallVector<int64_t> sortedFactorIndices = getFactorPreferenceOrder(
+      projection, factorSizes, axesPerFactor, mesh, op);
 
   // The propagation on each tensor is independent. This strategy can propagate
   // different shardings to different tensors along the same factor. Examples
   // are provided in the docstring of this class.
+  //
+  // `newAxes` is reused for every tensor and factor to avoid reallocating it.
+  SmallVector<AxisRefAttr> newAxes;
   for (const auto& [tensorIndex, tensorFactorShardings] :
        llvm::enumerate(llvm::concat<const TensorFactorShardings>(
            projection.getOperands(), projection.getResults()))) {
@@ -142,7 +146,8 @@ UpdateTensorShardings AggressiveFactorPropagation::propagateFactorShardings(
         continue;
       }
       const FactorSharding& factorSharding = factorShardingIt->second;
-      SmallVector<AxisRefAttr> newAxes = axesPerFactor[factorIndex];
+      newAxes.assign(axesPerFactor[factorIndex].begin(),
+                     axesPerFactor[factorIndex].end());
 
       // Resolve conflicts within a factor.
       truncateAxesByRemovingConflicts(
@@ -172,7 +177,7 @@ UpdateTensorShardings AggressiveFactorPropagation::propagateFactorShardings(
           },
           mesh, conservativePropagation);
       tensorUpdated |=
-          expandTensorSharding(projection, tensorIndex, factorIndex, newAxes);
+          projection.expandTensorSharding(tensorIndex, factorIndex, newAxes);
     }
 
     if (tensorIndex < projection.getNumOperands()) {
@@ -186,5 +191,16 @@ UpdateTensorShardings AggressiveFactorPropagation::propagateFactorShardings(
   return result;
 }
 
+UpdateTensorShardings
+AggressiveFactorPropagation::propagateDirtyFactorShardings(
+    ShardingProjection& projection, const BitVector&,
+    MutableArrayRef<CachedFactorAxes>,
+    PropagationDirectionAlongFactor directionAlongFactor,
+    ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+    bool conservativePropagation) const {
+  return propagateFactorShardings(projection, directionAlongFactor, factorSizes,
+                                  mesh, op, conservativePropagation);
+}
+
 }  // namespace sdy
 }  // namespace mlir
@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <cstdint>
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
@@ -81,6 +83,26 @@ class AggressiveFactorPropagation : public BasicFactorPropagation {
       PropagationDirectionAlongFactor directionAlongFactor,
       ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
       bool conservativePropagation) const override;
+
+  // Conflicts across factors are resolved w.r.t. the axes of all factors at
+  // once, so all factors are recomputed regardless of `dirtyFactors`.
+  UpdateTensorShardings propagateDirtyFactorShardings(
+      ShardingProjection& projection, const BitVector& dirtyFactors,
+      MutableArrayRef<CachedFactorAxes> cachedFactorAxes,
+      PropagationDirectionAlongFactor directionAlongFactor,
+      ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+      bool conservativePropagation) const override;
+
+ protected:
+  // Returns the indices of all factors, sorted by the order of preference in
+  // which conflicts across factors are resolved, given the compatible major
+  // axes of each factor (`axesPerFactor`).
+  //
+  // The default order prefers factors with a larger source tensor, see the
+  // class comment above.
+  virtual SmallVector<int64_t> getFactorPreferenceOrder(
+      const ShardingProjection& projection, ArrayRef<int64_t> factorSizes,
+      AxesPerFactorRef axesPerFactor, MeshAttr mesh, Operation* op) const;
 };
 
 }  // namespace sdy
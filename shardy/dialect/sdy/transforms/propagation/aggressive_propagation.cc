@@ -26,8 +26,11 @@ limitations under the License.
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 #include "shardy/dialect/sdy/transforms/propagation/basic_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/cost_based_factor_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_budget_factor_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/passes.h"
+#include "shardy/dialect/sdy/transforms/propagation/reshard_cost_model.h"
 #include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
 
 namespace mlir {
@@ -57,10 +60,24 @@ LogicalResult AggressivePropagationPassImpl::propagate(
     ModuleOp moduleOp, const SymbolTable& symbolTable,
     const ShardingGroupMap& shardingGroupMap,
     GetDirectionToPropagateFn getDirectionToPropagate) {
+  if (propagationStrategy == PropagationStrategy::CostBased &&
+      perDeviceMemoryBudget > 0) {
+    return moduleOp->emitError(
+        "The per-device memory budget isn't supported by the cost-based "
+        "propagation strategy.");
+  }
+  MemoryBudgetFactorPropagation memoryBudgetFactorPropagation(
+      perDeviceMemoryBudget);
+  const FactorPropagation* aggressiveStrategy = &aggressiveFactorPropagation;
+  if (perDeviceMemoryBudget > 0) {
+    aggressiveStrategy = &memoryBudgetFactorPropagation;
+  }
+  CostBasedFactorPropagation costBasedFactorPropagation(reshardCostModel);
+
   SmallVector<const FactorPropagation*, 2> strategies;
   switch (propagationStrategy) {
     case PropagationStrategy::Aggressive: {
-      strategies.push_back(&aggressiveFactorPropagation);
+      strategies.push_back(aggressiveStrategy);
       break;
     }
     case PropagationStrategy::Basic: {
@@ -69,7 +86,11 @@ LogicalResult AggressivePropagationPassImpl::propagate(
     }
     case PropagationStrategy::BasicThenAggressive: {
       strategies.push_back(&getBasicFactorPropagation());
-      strategies.push_back(&aggressiveFactorPropagation);
+      strategies.push_back(aggressiveStrategy);
+      break;
+    }
+    case PropagationStrategy::CostBased: {
+      strategies.push_back(&costBasedFactorPropagation);
       break;
     }
   }
@@ -84,6 +105,13 @@ LogicalResult AggressivePropagationPassImpl::propagate(
   return success();
 }
 
+void AggressivePropagationPassImpl::setPropagationOptions(
+    const PropagationOptions& options) {
+  BasicPropagationPassImpl::setPropagationOptions(options);
+  perDeviceMemoryBudget = options.perDeviceMemoryBudget;
+  reshardCostModel = options.reshardCostModel;
+}
+
 std::unique_ptr<Pass> createAggressivePropagationPass(
     const PropagationOptions& options, PropagationStrategy strategy) {
   return std::make_unique<AggressivePropagationPass>(options, strategy);
@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_AGGRESSIVE_PROPAGATION_H_
 #define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_AGGRESSIVE_PROPAGATION_H_
 
+#include <cstdint>
 #include <memory>
+#include <utility>
 
 #include "llvm/Support/CommandLine.h"
 #include "mlir/IR/BuiltinOps.h"
@@ -44,6 +46,11 @@ enum class PropagationStrategy {
   // shardings without conflicts, and then resolve conflicts with the aggressive
   // strategy.
   BasicThenAggressive,
+
+  // Use the aggressive strategy, but resolve conflicts across factors w.r.t.
+  // the estimated reshard cost on the losing side (see
+  // `CostBasedFactorPropagation`).
+  CostBased,
 };
 
 // The implementation class for the op-priority propagation pass.
@@ -52,7 +59,15 @@ class AggressivePropagationPassImpl : public BasicPropagationPassImpl {
   using BasicPropagationPassImpl::BasicPropagationPassImpl;
 
   AggressivePropagationPassImpl(const AggressivePropagationPassImpl& other)
-      : BasicPropagationPassImpl(other) {}
+      : BasicPropagationPassImpl(other),
+        reshardCostModel(other.reshardCostModel) {}
+
+  // Sets the cost model used by the `CostBased` strategy. If null,
+  // `BytesReshardCostModel` is used.
+  void setReshardCostModel(
+      std::shared_ptr<const ReshardCostModel> reshardCostModel) {
+    this->reshardCostModel = std::move(reshardCostModel);
+  }
 
  protected:
   // This method calls `BasicPropagationPassImpl::propagate` with specified
@@ -66,11 +81,23 @@ class AggressivePropagationPassImpl : public BasicPropagationPassImpl {
   //
   // If `propagationStrategy` is `BasicThenAggressive`, we first use the basic
   // strategy, and then the aggressive strategy to resolve conflicts.
+  //
+  // If `propagationStrategy` is `CostBased`, we use
+  // `CostBasedFactorPropagation` with `reshardCostModel`.
+  //
+  // If `perDeviceMemoryBudget` is positive, the aggressive strategy is replaced
+  // with `MemoryBudgetFactorPropagation` w.r.t. that budget. Returns failure if
+  // `propagationStrategy` is also `CostBased`, as the budget isn't supported by
+  // that strategy.
   LogicalResult propagate(
       ModuleOp moduleOp, const SymbolTable& symbolTable,
       const ShardingGroupMap& shardingGroupMap,
       GetDirectionToPropagateFn getDirectionToPropagate) override;
 
+  // Sets the propagation options declared in `BasicPropagationPassImpl` and
+  // below.
+  void setPropagationOptions(const PropagationOptions& options);
+
   Option<PropagationStrategy> propagationStrategy = {
       *this, "propagation-strategy",
       llvm::cl::desc("which factor propagation strategy to use"),
@@ -83,11 +110,25 @@ class AggressivePropagationPassImpl : public BasicPropagationPassImpl {
           clEnumValN(PropagationStrategy::BasicThenAggressive,
                      "basic-then-aggressive",
                      "basic factor propagation followed by aggressive factor "
-                     "propagation"))};
+                     "propagation"),
+          clEnumValN(PropagationStrategy::CostBased, "cost-based",
+                     "aggressive factor propagation that resolves conflicts "
+                     "w.r.t. the estimated reshard cost"))};
+
+  Option<int64_t> perDeviceMemoryBudget{
+      *this, "per-device-memory-budget",
+      llvm::cl::desc("the per-device memory budget in bytes, which the "
+                     "aggressive strategy tries to satisfy by further sharding "
+                     "tensors that exceed it. A non-positive value disables the "
+                     "budget. Can't be used with the cost-based strategy"),
+      llvm::cl::init(0)};
 
  private:
   // This class owns the aggressive factor propagation strategy.
   AggressiveFactorPropagation aggressiveFactorPropagation;
+  // The cost model of the `CostBased` strategy, which is shared by all clones
+  // of this pass.
+  std::shared_ptr<const ReshardCostModel> reshardCostModel;
 };
 
 std::unique_ptr<Pass> createAggressivePropagationPass(
@@ -25,6 +25,7 @@ limitations under the License.
 #include <tuple>
 #include <utility>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -301,6 +302,37 @@ std::pair<SmallVector<AxisRefAttr>, bool> getCompatibleMajorAxesInternal(
   return {result, canExpand};
 }
 
+// Returns true if any of `axes` overlaps with the sharding or overflow axes of
+// a factor other than `factorIndex` in any tensor of `projection`.
+bool overlapsWithOtherFactors(const ShardingProjection& projection,
+                              int64_t factorIndex, ArrayRef<AxisRefAttr> axes,
+                              const FactorAxesMasks* masks) {
+  if (masks && llvm::none_of(axes, [&](AxisRefAttr axis) {
+        return masks->mayOverlapWithOtherFactors(axis, factorIndex);
+      })) {
+    return false;
+  }
+  auto overlapsWithAxes = [&](ArrayRef<AxisRefAttr> otherAxes) {
+    return llvm::any_of(otherAxes, [&](AxisRefAttr otherAxis) {
+      return llvm::any_of(
+          axes, [&](AxisRefAttr axis) { return axis.overlaps(otherAxis); });
+    });
+  };
+  for (const TensorFactorShardings& tensorFactorSharding :
+       llvm::concat<const TensorFactorShardings>(projection.getOperands(),
+                                                 projection.getResults())) {
+    for (const auto& [otherFactorIndex, sharding] :
+         tensorFactorSharding.factorIndexToSharding) {
+      if (otherFactorIndex != factorIndex &&
+          (overlapsWithAxes(sharding.axisRefs) ||
+           overlapsWithAxes(sharding.overflowAxes))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 }  // namespace
 
 SmallVector<AxisRefAttr> BasicFactorPropagation::getCompatibleMajorAxes(
@@ -372,8 +404,30 @@ std::optional<AxisRefAttr> BasicFactorPropagation::compatiblePrefix(
 std::optional<AxisRefAttr> BasicFactorPropagation::compatiblePrefix(
     AxisRefAttr axisRef, const ShardingProjection& projection,
     int64_t factorIndex, int64_t prevShardedSize, int64_t factorSize,
-    MeshAttr mesh) const {
+    MeshAttr mesh, const FactorAxesMasks* masks) const {
   AxisRefAttr result = axisRef;
+  if (masks && !masks->mayOverlapWithOtherFactors(axisRef, factorIndex)) {
+    // There are no conflicts across factors in any tensor, and a prefix of
+    // `axisRef` can't introduce one, so we only need to remove conflicts
+    // within the factor in the tensors that are mapped to it.
+    for (const TensorFactorShardings& tensorFactorSharding :
+         llvm::concat<const TensorFactorShardings>(projection.getOperands(),
+                                                   projection.getResults())) {
+      auto factorShardingIt =
+          tensorFactorSharding.factorIndexToSharding.find(factorIndex);
+      if (factorShardingIt ==
+          tensorFactorSharding.factorIndexToSharding.end()) {
+        continue;
+      }
+      SDY_ASSIGN_OR_RETURN_IF_NULLOPT(
+          result, compatiblePrefixNoConflictsWithinFactor(
+                      result, tensorFactorSharding.replicatedAxes,
+                      factorShardingIt->second, prevShardedSize, factorSize,
+                      mesh));
+    }
+    return result;
+  }
+
   for (const TensorFactorShardings& tensorFactorSharding :
        llvm::concat<const TensorFactorShardings>(projection.getOperands(),
                                                  projection.getResults())) {
@@ -387,7 +441,8 @@ std::optional<AxisRefAttr> BasicFactorPropagation::compatiblePrefix(
 SmallVector<AxisRefAttr> BasicFactorPropagation::getCompatibleMajorShardingAxes(
     const ShardingProjection& projection, int64_t factorIndex,
     PropagationDirection direction, int64_t factorSize, MeshAttr mesh,
-    Operation* op, bool conservativePropagation) const {
+    Operation* op, bool conservativePropagation,
+    const FactorAxesMasks* masks) const {
   // Finds the compatible major axes ignoring conflicts.
   SmallVector<AxisRefAttr> resultAxes =
       getCompatibleMajorAxes(projection, factorIndex, direction, op);
@@ -398,7 +453,7 @@ SmallVector<AxisRefAttr> BasicFactorPropagation::getCompatibleMajorShardingAxes(
       resultAxes,
       [&](AxisRefAttr axisRef, int64_t prevShardedSize) {
         return compatiblePrefix(axisRef, projection, factorIndex,
-                                prevShardedSize, factorSize, mesh);
+                                prevShardedSize, factorSize, mesh, masks);
       },
       mesh, conservativePropagation);
 
@@ -412,6 +467,8 @@ UpdateTensorShardings BasicFactorPropagation::propagateFactorShardings(
     bool conservativePropagation) const {
   UpdateTensorShardings result(projection.getNumOperands(),
                                projection.getNumResults());
+  std::optional<FactorAxesMasks> masks =
+      FactorAxesMasks::build(projection, factorSizes.size(), mesh);
 
   // We propagate each factor separately.
   for (auto [factorIndex, factorSize] : llvm::enumerate(factorSizes)) {
@@ -420,11 +477,57 @@ UpdateTensorShardings BasicFactorPropagation::propagateFactorShardings(
     // tensors that aren't already sharded.
     SmallVector<AxisRefAttr> axesToPropagate = getCompatibleMajorShardingAxes(
         projection, factorIndex, directionAlongFactor(factorIndex), factorSize,
-        mesh, op, conservativePropagation);
+        mesh, op, conservativePropagation, masks ? &*masks : nullptr);
 
     // Update all shardings along this factor if possible.
     auto [updateOperandForFactor, updateResultForFactor] =
         projection.expandSharding(factorIndex, axesToPropagate);
+    if (masks) {
+      masks->addAxes(factorIndex, axesToPropagate);
+    }
+
+    result.updateOperands |= updateOperandForFactor;
+    result.updateResults |= updateResultForFactor;
+  }
+
+  return result;
+}
+
+UpdateTensorShardings BasicFactorPropagation::propagateDirtyFactorShardings(
+    ShardingProjection& projection, const BitVector& dirtyFactors,
+    MutableArrayRef<CachedFactorAxes> cachedFactorAxes,
+    PropagationDirectionAlongFactor directionAlongFactor,
+    ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+    bool conservativePropagation) const {
+  assert(cachedFactorAxes.size() == factorSizes.size() &&
+         dirtyFactors.size() == factorSizes.size());
+  UpdateTensorShardings result(projection.getNumOperands(),
+                               projection.getNumResults());
+  std::optional<FactorAxesMasks> masks =
+      FactorAxesMasks::build(projection, factorSizes.size(), mesh);
+
+  for (auto [factorIndex, factorSize] : llvm::enumerate(factorSizes)) {
+    PropagationDirection direction = directionAlongFactor(factorIndex);
+    CachedFactorAxes& cached = cachedFactorAxes[factorIndex];
+    // The factors are expanded one after the other, so a factor that was
+    // expanded before this one may have introduced a conflict with the cached
+    // axes, even if no tensor changed since the previous visit.
+    if (!cached.valid || dirtyFactors.test(factorIndex) ||
+        cached.direction != direction ||
+        overlapsWithOtherFactors(projection, factorIndex, cached.axes,
+                                 masks ? &*masks : nullptr)) {
+      cached.axes = getCompatibleMajorShardingAxes(
+          projection, factorIndex, direction, factorSize, mesh, op,
+          conservativePropagation, masks ? &*masks : nullptr);
+      cached.direction = direction;
+      cached.valid = true;
+    }
+
+    auto [updateOperandForFactor, updateResultForFactor] =
+        projection.expandSharding(factorIndex, cached.axes);
+    if (masks) {
+      masks->addAxes(factorIndex, cached.axes);
+    }
 
     result.updateOperands |= updateOperandForFactor;
     result.updateResults |= updateResultForFactor;
@@ -20,6 +20,7 @@ limitations under the License.
 #include <functional>
 #include <optional>
 
+#include "llvm/ADT/BitVector.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
@@ -47,6 +48,21 @@ class BasicFactorPropagation : public FactorPropagation {
       ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
       bool conservativePropagation) const override;
 
+  // Propagates the factor shardings in `projection`, reusing the cached axes
+  // of a factor that isn't in `dirtyFactors` if they were propagated in the
+  // same direction and don't conflict with the axes of other factors.
+  //
+  // Since shardings only grow during propagation, if no tensor mapped to a
+  // factor changed, the compatible major axes of that factor are the same as
+  // before, and the only thing that can truncate them is a new conflict with
+  // other factors (e.g., along a tensor that isn't mapped to the factor).
+  UpdateTensorShardings propagateDirtyFactorShardings(
+      ShardingProjection& projection, const BitVector& dirtyFactors,
+      MutableArrayRef<CachedFactorAxes> cachedFactorAxes,
+      PropagationDirectionAlongFactor directionAlongFactor,
+      ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+      bool conservativePropagation) const override;
+
  protected:
   // Finds all compatible major axes that can shard the given factor for all
   // tensors.
@@ -85,10 +101,15 @@ class BasicFactorPropagation : public FactorPropagation {
   //   - Given factor shardings ["a":(1)2] and ["a":(1)4], returns ["a":(1)4].
   //   - Given factor shardings ["a":(1)2, "b"] and ["a":(1)4], returns
   //     ["a":(1)2].
+  //
+  // If `masks` is specified, an axis that can't overlap with any other factor
+  // according to it is only checked for conflicts within the factor, in the
+  // tensors mapped to the factor.
   SmallVector<AxisRefAttr> getCompatibleMajorShardingAxes(
       const ShardingProjection& projection, int64_t factorIndex,
       PropagationDirection direction, int64_t factorSize, MeshAttr mesh,
-      Operation* op, bool conservativePropagation) const;
+      Operation* op, bool conservativePropagation,
+      const FactorAxesMasks* masks = nullptr) const;
 
   // Finds the longest prefix of axes that shard the given factor, such that all
   // tensors either:
@@ -163,10 +184,13 @@ class BasicFactorPropagation : public FactorPropagation {
 
   // Returns the largest compatible prefix of `axisRef` by removing conflicts
   // with every `TensorFactorShardings` in `projection`.
+  //
+  // If `masks` rules out any conflict across factors, only the conflicts
+  // within the factor are removed.
   std::optional<AxisRefAttr> compatiblePrefix(
       AxisRefAttr axisRef, const ShardingProjection& projection,
       int64_t factorIndex, int64_t prevShardedSize, int64_t factorSize,
-      MeshAttr mesh) const;
+      MeshAttr mesh, const FactorAxesMasks* masks) const;
 };
 
 }  // namespace sdy
@@ -19,6 +19,8 @@ limitations under the License.
 #include <cstdint>
 #include <utility>
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
@@ -617,6 +619,39 @@ TEST_F(BasicFactorPropagationTest, UniDirectionalPropagationWithConflict) {
   EXPECT_THAT(toSetBitsVector(updateResults), IsEmpty());
 }
 
+TEST_F(BasicFactorPropagationTest, PrecomputedDirectionsAlongFactors) {
+  ShardingProjection projection(
+      /*operands=*/
+      {{.factorIndexToSharding =
+            {{0, {.axisRefs = {createAxis("a"), createAxis("b")}}},
+             {1, {.axisRefs = {}}},
+             {2, {.axisRefs = {createAxis("d")}}}}}},
+      /*results=*/
+      {{.factorIndexToSharding = {
+            {0, {.axisRefs = {}}},
+            {1, {.axisRefs = {createAxis("c")}}},
+            {2, {.axisRefs = {}}}}}});
+  ShardingProjection projectionWithPredicate = projection;
+
+  // Reading the directions from an array gives the same result as computing
+  // them with a predicate.
+  SmallVector<PropagationDirection> directions = {
+      PropagationDirection::FORWARD, PropagationDirection::BACKWARD,
+      PropagationDirection::NONE};
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, 3, PropagationDirectionAlongFactor(directions));
+  auto [updateOperandsWithPredicate, updateResultsWithPredicate] =
+      propagateFactorShardings(
+          projectionWithPredicate, 3,
+          [&](int64_t factorIndex) { return directions[factorIndex]; });
+
+  EXPECT_THAT(toSetBitsVector(updateOperands), ElementsAre(0));
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(updateOperands, updateOperandsWithPredicate);
+  EXPECT_EQ(updateResults, updateResultsWithPredicate);
+  EXPECT_EQ(projection, projectionWithPredicate);
+}
+
 TEST_F(BasicFactorPropagationTest,
        ConservativePropagationStopsSplitAxes) {
   ShardingProjection projection(
@@ -646,6 +681,145 @@ TEST_F(BasicFactorPropagationTest,
   EXPECT_EQ(projection, projectionExpected);
 }
 
+TEST_F(BasicFactorPropagationTest, CleanFactorsReuseCachedAxes) {
+  ShardingProjection projection(
+      /*operands=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {}}}}},
+       {.factorIndexToSharding = {{0, {.axisRefs = {}}},
+                                  {1, {.axisRefs = {}}}}}},
+      /*results=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {}}},
+                                  {1, {.axisRefs = {}}}}}});
+
+  // The cached axes of factor 1 are reused as is, even though recomputing them
+  // would find no axes, since factor 1 isn't dirty.
+  SmallVector<CachedFactorAxes> cachedFactorAxes(2);
+  cachedFactorAxes[1] = {.axes = {createAxis("b")},
+                         .direction = PropagationDirection::BOTH,
+                         .valid = true};
+  BitVector dirtyFactors(2);
+  dirtyFactors.set(0);
+
+  ShardingProjection projectionExpected(
+      /*operands=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {createAxis("b")}}}}},
+       {.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {createAxis("b")}}}}}},
+      /*results=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {createAxis("b")}}}}}});
+
+  auto [updateOperands, updateResults] =
+      BasicFactorPropagation().propagateDirtyFactorShardings(
+          projection, dirtyFactors, cachedFactorAxes, propagateAnything(),
+          /*factorSizes=*/{1, 1}, /*mesh=*/nullptr, /*op=*/nullptr,
+          /*conservativePropagation=*/false);
+  EXPECT_THAT(toSetBitsVector(updateOperands), ElementsAre(0, 1));
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(projection, projectionExpected);
+  EXPECT_THAT(cachedFactorAxes[0].axes, ElementsAre(createAxis("a")));
+  EXPECT_TRUE(cachedFactorAxes[0].valid);
+}
+
+TEST_F(BasicFactorPropagationTest, CachedAxesConflictingAcrossFactors) {
+  ShardingProjection projection(
+      /*operands=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {createAxis("b")}}}}}},
+      /*results=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {}}},
+                                  {1, {.axisRefs = {}}}}}});
+
+  // Factor 1 isn't dirty, but its cached axes overlap with the axes of factor
+  // 0, and the cached axes of factor 0 were propagated in another direction,
+  // so both are recomputed.
+  SmallVector<CachedFactorAxes> cachedFactorAxes = {
+      {.axes = {}, .direction = PropagationDirection::NONE, .valid = true},
+      {.axes = {createAxis("a")},
+       .direction = PropagationDirection::BOTH,
+       .valid = true}};
+
+  ShardingProjection projectionExpected(
+      /*operands=*/{projection.getOperand(0)},
+      /*results=*/
+      {{.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}},
+                                  {1, {.axisRefs = {createAxis("b")}}}}}});
+
+  auto [updateOperands, updateResults] =
+      BasicFactorPropagation().propagateDirtyFactorShardings(
+          projection, /*dirtyFactors=*/BitVector(2), cachedFactorAxes,
+          propagateAnything(), /*factorSizes=*/{1, 1}, /*mesh=*/nullptr,
+          /*op=*/nullptr, /*conservativePropagation=*/false);
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(projection, projectionExpected);
+  EXPECT_THAT(cachedFactorAxes[1].axes, ElementsAre(createAxis("b")));
+}
+
+TEST_F(BasicFactorPropagationTest, AxesMasksMatchScalarConflictChecks) {
+  MeshAttr mesh = MeshAttr::get(
+      &context,
+      {MeshAxisAttr::get(&context, "a", 2), MeshAxisAttr::get(&context, "b", 2),
+       MeshAxisAttr::get(&context, "c", 2), MeshAxisAttr::get(&context, "d", 2),
+       MeshAxisAttr::get(&context, "e", 2)});
+
+  // All factors are minor-most, so passing a mesh only enables the axes masks,
+  // and propagating with and without it should give the same result.
+  SmallVector<TensorFactorShardings> operands;
+  for (int64_t i = 0; i < 16; ++i) {
+    SmallVector<AxisRefAttr> factor0Axes;
+    if (i % 2 == 0) {
+      factor0Axes.push_back(createAxis("a"));
+    }
+    if (i % 4 == 0) {
+      factor0Axes.push_back(createAxis("b"));
+    }
+    operands.push_back(
+        {.factorIndexToSharding = {
+             {0, {.axisRefs = factor0Axes, .isMinorMost = true}},
+             {1, {.axisRefs = {}, .isMinorMost = true}}}});
+  }
+  // Factor 2 is only mapped to this operand, and conflicts with factor 0 on
+  // "b" and with factor 1 on "d".
+  operands.push_back(
+      {.factorIndexToSharding = {
+           {1, {.axisRefs = {createAxis("c")}, .isMinorMost = true}},
+           {2,
+            {.axisRefs = {createAxis("b"), createAxis("d")},
+             .isMinorMost = true}}}});
+  SmallVector<TensorFactorShardings> results = {
+      {.factorIndexToSharding = {
+           {0, {.axisRefs = {}, .isMinorMost = true}},
+           {1,
+            {.axisRefs = {createAxis("c"), createAxis("d"), createAxis("e")},
+             .isMinorMost = true}}}}};
+
+  ShardingProjection projectionWithMasks(operands, results);
+  ShardingProjection projectionWithoutMasks(operands, results);
+  UpdateTensorShardings updateWithMasks = propagateFactorShardings(
+      projectionWithMasks, /*factorSizes=*/{1, 1, 1}, propagateAnything(),
+      mesh);
+  UpdateTensorShardings updateWithoutMasks = propagateFactorShardings(
+      projectionWithoutMasks, /*factorSizes=*/{1, 1, 1}, propagateAnything(),
+      /*mesh=*/nullptr);
+
+  EXPECT_EQ(projectionWithMasks, projectionWithoutMasks);
+  EXPECT_EQ(updateWithMasks.updateOperands, updateWithoutMasks.updateOperands);
+  EXPECT_EQ(updateWithMasks.updateResults, updateWithoutMasks.updateResults);
+  // Factor 0 gets ["a"], since "b" conflicts with factor 2, and factor 1 gets
+  // ["c"], since "d" conflicts with factor 2.
+  EXPECT_THAT(projectionWithMasks.getOperand(1)
+                  .factorIndexToSharding.lookup(0)
+                  .axisRefs,
+              ElementsAre(createAxis("a")));
+  EXPECT_THAT(projectionWithMasks.getOperand(1)
+                  .factorIndexToSharding.lookup(1)
+                  .axisRefs,
+              ElementsAre(createAxis("c")));
+}
+
 }  // namespace
 }  // namespace sdy
 }  // namespace mlir
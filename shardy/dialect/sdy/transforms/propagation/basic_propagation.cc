@@ -19,10 +19,15 @@ limitations under the License.
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <optional>
 #include <utility>
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Threading.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -35,11 +40,14 @@ limitations under the License.
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/IR/Value.h"
 #include "mlir/IR/ValueRange.h"
 #include "mlir/IR/Visitors.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassRegistry.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
+#include "mlir/Rewrite/PatternApplicator.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -48,11 +56,16 @@ limitations under the License.
 #include "shardy/dialect/sdy/ir/utils.h"
 #include "shardy/dialect/sdy/transforms/propagation/debugging/source_sharding.h"
 #include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/function_wavefronts.h"
+#include "shardy/dialect/sdy/transforms/propagation/interprocedural_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_builder.h"
 #include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_registry.h"
+#include "shardy/dialect/sdy/transforms/propagation/parallel_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/passes.h"
+#include "shardy/dialect/sdy/transforms/propagation/propagation_scheduler.h"
 #include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
 #include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+#include "shardy/dialect/sdy/transforms/propagation/utils.h"
 
 namespace mlir {
 namespace sdy {
@@ -143,11 +156,137 @@ struct PropagationTensorParams {
         setShardingCallback(setShardingCallback) {}
 };
 
+// Caches the axes propagated along each factor of an op between visits, so
+// that a visit only recomputes the factors mapped to a tensor whose sharding
+// changed since the previous visit (see
+// `FactorPropagation::propagateDirtyFactorShardings`).
+//
+// If `threadSafe` is true, entries are created under a lock, since independent
+// functions may be propagated through concurrently, but an entry is only
+// accessed by the thread propagating through its op.
+class FactorShardingCache {
+ public:
+  explicit FactorShardingCache(bool threadSafe) : threadSafe(threadSafe) {}
+
+  struct Entry {
+    // The sharding rule the factor axes were propagated with.
+    OpShardingRuleAttr shardingRule;
+    // The shardings of the operands and results after the previous visit.
+    SmallVector<TensorShardingAttr> operandShardings;
+    SmallVector<TensorShardingAttr> resultShardings;
+    SmallVector<CachedFactorAxes> factorAxes;
+
+    // Returns the factors of `shardingRule` that are mapped to a dimension of
+    // an operand or result whose sharding in `operandShardings` or
+    // `resultShardings` differs from the previous visit.
+    //
+    // All factors are dirty if the op wasn't visited with `shardingRule`
+    // before, in which case the cached factor axes are reset.
+    BitVector getDirtyFactors(OpShardingRuleAttr shardingRule,
+                              ArrayRef<TensorShardingAttr> operandShardings,
+                              ArrayRef<TensorShardingAttr> resultShardings);
+  };
+
+  // Returns the entry of `op`, which is empty if `op` wasn't visited yet.
+  Entry& getEntry(Operation* op) {
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (threadSafe) {
+      lock.lock();
+    }
+    std::unique_ptr<Entry>& entry = entries[op];
+    if (!entry) {
+      entry = std::make_unique<Entry>();
+    }
+    return *entry;
+  }
+
+ private:
+  bool threadSafe;
+  std::mutex mutex;
+  llvm::DenseMap<Operation*, std::unique_ptr<Entry>> entries;
+};
+
+// Precomputes the direction to propagate along each factor of an op the first
+// time it's visited in a call to `propagate`, since the direction doesn't
+// change throughout a call (e.g., during an op-priority stage). Later visits
+// read the directions from an array, instead of calling
+// `getDirectionToPropagate` for every factor.
+//
+// If `threadSafe` is true, directions are computed under a lock, since
+// independent functions may be propagated through concurrently.
+class FactorDirectionCache {
+ public:
+  FactorDirectionCache(GetDirectionToPropagateFn getDirectionToPropagate,
+                       bool threadSafe)
+      : getDirectionToPropagate(std::move(getDirectionToPropagate)),
+        threadSafe(threadSafe) {}
+
+  // Returns the direction along each of the `numFactors` factors of `op`.
+  ArrayRef<PropagationDirection> getDirections(Operation* op,
+                                               int64_t numFactors) {
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (threadSafe) {
+      lock.lock();
+    }
+    ArrayRef<PropagationDirection>& directions = opToDirections[op];
+    if (directions.empty() && numFactors > 0) {
+      auto* data = allocator.Allocate<PropagationDirection>(numFactors);
+      for (int64_t factorIndex = 0; factorIndex < numFactors; ++factorIndex) {
+        data[factorIndex] = getDirectionToPropagate(op, factorIndex);
+      }
+      directions = ArrayRef<PropagationDirection>(data, numFactors);
+    }
+    return directions;
+  }
+
+ private:
+  GetDirectionToPropagateFn getDirectionToPropagate;
+  bool threadSafe;
+  std::mutex mutex;
+  llvm::BumpPtrAllocator allocator;
+  llvm::DenseMap<Operation*, ArrayRef<PropagationDirection>> opToDirections;
+};
+
+BitVector FactorShardingCache::Entry::getDirtyFactors(
+    OpShardingRuleAttr shardingRule,
+    ArrayRef<TensorShardingAttr> operandShardings,
+    ArrayRef<TensorShardingAttr> resultShardings) {
+  int64_t numFactors = shardingRule.getNumFactors();
+  if (shardingRule != this->shardingRule) {
+    this->shardingRule = shardingRule;
+    factorAxes.assign(numFactors, CachedFactorAxes());
+    return BitVector(numFactors, true);
+  }
+
+  BitVector dirtyFactors(numFactors);
+  auto markChangedTensors = [&](ArrayRef<TensorShardingAttr> shardings,
+                                ArrayRef<TensorShardingAttr> prevShardings,
+                                ArrayRef<TensorMappingAttr> tensorMappings) {
+    for (auto [sharding, prevSharding, tensorMapping] :
+         llvm::zip_equal(shardings, prevShardings, tensorMappings)) {
+      if (sharding == prevSharding) {
+        continue;
+      }
+      for (DimMappingAttr dimMapping : tensorMapping.getDimMappings()) {
+        for (int64_t factorIndex : dimMapping.getFactorIndices()) {
+          dirtyFactors.set(factorIndex);
+        }
+      }
+    }
+  };
+  markChangedTensors(operandShardings, this->operandShardings,
+                     shardingRule.getOperandMappings());
+  markChangedTensors(resultShardings, this->resultShardings,
+                     shardingRule.getResultMappings());
+  return dirtyFactors;
+}
+
 // Update the sharding of `value` to the sharding in `tensorFactorShardings`.
 //
-// Returns true if it's possible to update the sharding, i.e., if strided view
-// isn't needed and all non-minor-most factors are divisible by sharding axes.
-bool updateTensorSharding(Value modifiedValue,
+// Returns the new sharding if it's possible to update the sharding, i.e., if
+// strided view isn't needed and all non-minor-most factors are divisible by
+// sharding axes, otherwise returns a null sharding.
+TensorShardingAttr updateTensorSharding(Value modifiedValue,
                           TensorShardingAttr oldTensorSharding,
                           SetTensorShardingCallback setTensorShardingCallback,
                           const TensorFactorShardings& tensorFactorShardings,
@@ -172,7 +311,7 @@ bool updateTensorSharding(Value modifiedValue,
     static llvm::once_flag flag;
     emitOpWarningOnce(flag, getOwningOp(modifiedValue),
                       "can't propagate sharding as strided view is needed");
-    return false;
+    return TensorShardingAttr();
   }
 
   setTensorShardingCallback(newSharding);
@@ -194,7 +333,7 @@ bool updateTensorSharding(Value modifiedValue,
     }
   }
 
-  return true;
+  return newSharding;
 }
 
 // Updates the sharding of all tensors according to `tensorFactorShardings`.
@@ -204,41 +343,67 @@ bool updateTensorSharding(Value modifiedValue,
 // If an operand or result couldn't be updated to the corresponding sharding in
 // `tensorFactorShardings`, e.g., if strided view is required, sets the
 // respective bit in `updateTensor` or `updateResult` to false.
+//
+// If `shardingsAfterUpdate` is specified, it's set to the sharding of each
+// tensor after the update.
 void updateTensorShardings(
     const PropagationTensorParams& tensorParams,
     ArrayRef<TensorFactorShardings> tensorFactorShardings,
     ArrayRef<TensorMappingAttr> tensorMappings, ArrayRef<int64_t> factorSizes,
-    BitVector& updateTensor, const PropagationSharedParams& params) {
+    BitVector& updateTensor, const PropagationSharedParams& params,
+    SmallVector<TensorShardingAttr>* shardingsAfterUpdate) {
+  if (shardingsAfterUpdate) {
+    shardingsAfterUpdate->assign(tensorParams.shardings.begin(),
+                                 tensorParams.shardings.end());
+  }
   for (int64_t index : updateTensor.set_bits()) {
-    if (!updateTensorSharding(getShardableValue(tensorParams.tensors[index]),
-                              tensorParams.shardings[index],
-                              std::bind(tensorParams.setShardingCallback,
-                                        std::placeholders::_1, index),
-                              tensorFactorShardings[index],
-                              tensorMappings[index], factorSizes, params)) {
+    TensorShardingAttr newSharding = updateTensorSharding(
+        getShardableValue(tensorParams.tensors[index]),
+        tensorParams.shardings[index],
+        std::bind(tensorParams.setShardingCallback, std::placeholders::_1,
+                  index),
+        tensorFactorShardings[index], tensorMappings[index], factorSizes,
+        params);
+    if (!newSharding) {
       updateTensor.reset(index);
+    } else if (shardingsAfterUpdate) {
+      (*shardingsAfterUpdate)[index] = newSharding;
     }
   }
 }
 
 // Same as the overload above, except operates on both operands and results.
+//
+// If `cacheEntry` is specified, the shardings of the operands and results after
+// the update are saved on it.
 void updateTensorShardings(const PropagationTensorParams& operandsParams,
                            const PropagationTensorParams& resultsParams,
                            OpShardingRuleAttr shardingRule,
                            const ShardingProjection& shardingProjection,
                            BitVector& updateOperand, BitVector& updateResult,
-                           const PropagationSharedParams& params) {
-  updateTensorShardings(operandsParams, shardingProjection.getOperands(),
-                        shardingRule.getOperandMappings(),
-                        shardingRule.getFactorSizes(), updateOperand, params);
-  updateTensorShardings(resultsParams, shardingProjection.getResults(),
-                        shardingRule.getResultMappings(),
-                        shardingRule.getFactorSizes(), updateResult, params);
+                           const PropagationSharedParams& params,
+                           FactorShardingCache::Entry* cacheEntry) {
+  updateTensorShardings(
+      operandsParams, shardingProjection.getOperands(),
+      shardingRule.getOperandMappings(), shardingRule.getFactorSizes(),
+      updateOperand, params,
+      cacheEntry ? &cacheEntry->operandShardings : nullptr);
+  updateTensorShardings(
+      resultsParams, shardingProjection.getResults(),
+      shardingRule.getResultMappings(), shardingRule.getFactorSizes(),
+      updateResult, params,
+      cacheEntry ? &cacheEntry->resultShardings : nullptr);
 }
 
 // Propagates tensor shardings of the given `operands` and `results` according
 // to `shardingRule`.
 //
+// If `factorShardingCache` is specified, only the factors that may have changed
+// since the previous visit of `op` are recomputed.
+//
+// If `layoutCache` is specified, the projection is built from the cached
+// layout of `shardingRule`.
+//
 // NOTE: the `operands`/`results` can be any sort of ValueRange associated to
 // the Operation. For example, for CaseOp, an op with no operands, it's called
 // with the return values of each branch/region.
@@ -249,7 +414,9 @@ LogicalResult propagateTensorShardings(
     PropagationDirectionAlongFactor directionAlongFactor,
     const FactorPropagation& factorPropagation, bool conservativePropagation,
     Operation* op, const SymbolTable& symbolTable, PatternRewriter* rewriter,
-    ShardingGroupMap shardingGroupMap) {
+    ShardingGroupMap shardingGroupMap,
+    FactorShardingCache* factorShardingCache = nullptr,
+    ShardingRuleLayoutCache* layoutCache = nullptr) {
   std::optional<StringRef> meshName = getCommonMeshName(
       operandsParams.shardings, resultsParams.shardings, symbolTable);
 
@@ -278,20 +445,42 @@ LogicalResult propagateTensorShardings(
     };
   }
 
-  ShardingProjection shardingProjection = ShardingProjection::build(
-      operandsParams.shardings, resultsParams.shardings, shardingRule, mesh);
+  // The projection is rebuilt in place for every op visited by this thread,
+  // to avoid allocating its tensors and factor shardings for each visit.
+  static thread_local ShardingProjection shardingProjection;
+  if (layoutCache) {
+    shardingProjection.rebuild(operandsParams.shardings,
+                               resultsParams.shardings,
+                               layoutCache->getLayout(shardingRule), mesh);
+  } else {
+    shardingProjection.rebuild(operandsParams.shardings,
+                               resultsParams.shardings, shardingRule, mesh);
+  }
   bool anyUpdated = false;
+  FactorShardingCache::Entry* cacheEntry =
+      factorShardingCache ? &factorShardingCache->getEntry(op) : nullptr;
   auto updateShardings = [&]() {
-    auto [updateOperand, updateResult] =
-        factorPropagation.propagateFactorShardings(
-            shardingProjection, directionAlongFactor,
-            shardingRule.getFactorSizes(), mesh, op, conservativePropagation);
+    UpdateTensorShardings updateTensors =
+        cacheEntry
+            ? factorPropagation.propagateDirtyFactorShardings(
+                  shardingProjection,
+                  cacheEntry->getDirtyFactors(shardingRule,
+                                              operandsParams.shardings,
+                                              resultsParams.shardings),
+                  cacheEntry->factorAxes, directionAlongFactor,
+                  shardingRule.getFactorSizes(), mesh, op,
+                  conservativePropagation)
+            : factorPropagation.propagateFactorShardings(
+                  shardingProjection, directionAlongFactor,
+                  shardingRule.getFactorSizes(), mesh, op,
+                  conservativePropagation);
+    auto& [updateOperand, updateResult] = updateTensors;
     PropagationSharedParams params{shardingGroupMap, meshName.value(), mesh,
                                    notifyOpModified};
 
     updateTensorShardings(operandsParams, resultsParams, shardingRule,
                           shardingProjection, updateOperand, updateResult,
-                          params);
+                          params, cacheEntry);
 
     anyUpdated = updateOperand.any() || updateResult.any();
   };
@@ -322,7 +511,9 @@ LogicalResult propagateTensorShardings(
     PropagationDirectionAlongFactor directionAlongFactor,
     const FactorPropagation& factorPropagation,
     const ShardingGroupMap& shardingGroupMap,
-    bool conservativePropagation = false) {
+    bool conservativePropagation = false,
+    FactorShardingCache* factorShardingCache = nullptr,
+    ShardingRuleLayoutCache* layoutCache = nullptr) {
   SmallVector<TensorShardingAttr> operandsShardings = getShardings(operands);
   SmallVector<TensorShardingAttr> resultsShardings = getShardings(results);
   PropagationTensorParams operandsParams = PropagationTensorParams(
@@ -341,7 +532,8 @@ LogicalResult propagateTensorShardings(
   return propagateTensorShardings(operandsParams, resultsParams, shardingRule,
                                   directionAlongFactor, factorPropagation,
                                   conservativePropagation, op, symbolTable,
-                                  &rewriter, shardingGroupMap);
+                                  &rewriter, shardingGroupMap,
+                                  factorShardingCache, layoutCache);
 }
 
 // Propagates the shardings between the operands of the `funcOp`'s terminator
@@ -413,21 +605,64 @@ LogicalResult propagateFuncResults(ModuleOp moduleOp,
   return success();
 }
 
+// Returns true if `getDirectionToPropagate` is `propagateAny`, i.e., shardings
+// are propagated in both directions along every factor of every op.
+bool isPropagateAny(const GetDirectionToPropagateFn& getDirectionToPropagate) {
+  auto* fn = getDirectionToPropagate
+                 .target<PropagationDirection (*)(Operation*, int64_t)>();
+  return fn && *fn == &propagateAny;
+}
+
+// Returns true if propagating through `op` can no longer update any sharding,
+// since all tensors it propagates between are saturated (see `isSaturated`).
+//
+// Shardings only grow during propagation, so a saturated op remains saturated.
+bool isOpSaturated(Operation* op, const SymbolTable& symbolTable) {
+  // The tensors of an op are typically all sharded on the same mesh, so the
+  // mesh is only looked up again if it differs from the previous tensor's.
+  Attribute meshOrRef;
+  MeshAttr mesh;
+  auto isValueSaturated = [&](Value value) {
+    TensorShardingAttr sharding = getSharding(value);
+    if (!sharding) {
+      return false;
+    }
+    if (sharding.getMeshOrRef() != meshOrRef) {
+      meshOrRef = sharding.getMeshOrRef();
+      mesh = sharding.getMesh(symbolTable);
+    }
+    return isSaturated(sharding, mesh);
+  };
+  if (auto dataFlowEdgeOp = dyn_cast<DataFlowEdgeOp>(op)) {
+    return isValueSaturated(dataFlowEdgeOp.getResult()) &&
+           llvm::all_of(dataFlowEdgeOp.getSources(), isValueSaturated);
+  }
+  return llvm::all_of(op->getOperands(), isValueSaturated) &&
+         llvm::all_of(op->getResults(), isValueSaturated);
+}
+
 // Propagates the sharding of an operation (between operands and results) that
 // has a registered or custom `OpShardingRuleAttr`.
+//
+// If `factorShardingCache` is specified, only the factors that may have changed
+// since the previous visit of an op are recomputed.
 class PropagateRegisteredOp : public RewritePattern {
  public:
   explicit PropagateRegisteredOp(
       MLIRContext* context, const SymbolTable& symbolTable,
-      GetDirectionToPropagateFn getDirectionToPropagate,
+      FactorDirectionCache& directionCache,
       const FactorPropagation& factorPropagation, bool conservativePropagation,
-      const ShardingGroupMap& shardingGroupMap)
+      const ShardingGroupMap& shardingGroupMap,
+      FactorShardingCache* factorShardingCache,
+      ShardingRuleLayoutCache& layoutCache)
       : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/1, context),
         symbolTable(symbolTable),
-        getDirectionToPropagate(getDirectionToPropagate),
+        directionCache(directionCache),
         factorPropagation(factorPropagation),
         conservativePropagation(conservativePropagation),
-        shardingGroupMap(shardingGroupMap) {}
+        shardingGroupMap(shardingGroupMap),
+        factorShardingCache(factorShardingCache),
+        layoutCache(layoutCache) {}
 
   LogicalResult matchAndRewrite(Operation* op,
                                 PatternRewriter& rewriter) const override {
@@ -440,20 +675,22 @@ class PropagateRegisteredOp : public RewritePattern {
       });
     }
 
-    PropagationDirectionAlongFactor directionAlongFactor =
-        std::bind(getDirectionToPropagate, op, std::placeholders::_1);
-    return propagateTensorShardings(op->getOperands(), op->getResults(),
-                                    shardingRule, op, symbolTable, rewriter,
-                                    directionAlongFactor, factorPropagation,
-                                    shardingGroupMap, conservativePropagation);
+    PropagationDirectionAlongFactor directionAlongFactor(
+        directionCache.getDirections(op, shardingRule.getNumFactors()));
+    return propagateTensorShardings(
+        op->getOperands(), op->getResults(), shardingRule, op, symbolTable,
+        rewriter, directionAlongFactor, factorPropagation, shardingGroupMap,
+        conservativePropagation, factorShardingCache, &layoutCache);
   }
 
  private:
   const SymbolTable& symbolTable;
-  GetDirectionToPropagateFn getDirectionToPropagate;
+  FactorDirectionCache& directionCache;
   const FactorPropagation& factorPropagation;
   bool conservativePropagation;
   const ShardingGroupMap& shardingGroupMap;
+  FactorShardingCache* factorShardingCache;
+  ShardingRuleLayoutCache& layoutCache;
 };
 
 // Propagates shardings between the sources and targets of an
@@ -464,14 +701,16 @@ class PropagateDataFlowEdgeOp : public OpRewritePattern<DataFlowEdgeOp> {
  public:
   explicit PropagateDataFlowEdgeOp(
       MLIRContext* context, const SymbolTable& symbolTable,
-      GetDirectionToPropagateFn getDirectionToPropagate,
+      FactorDirectionCache& directionCache,
       const FactorPropagation& factorPropagation,
-      const ShardingGroupMap& shardingGroupMap)
+      const ShardingGroupMap& shardingGroupMap,
+      ShardingRuleLayoutCache& layoutCache)
       : OpRewritePattern<DataFlowEdgeOp>(context),
         symbolTable(symbolTable),
-        getDirectionToPropagate(getDirectionToPropagate),
+        directionCache(directionCache),
         factorPropagation(factorPropagation),
-        shardingGroupMap(shardingGroupMap) {}
+        shardingGroupMap(shardingGroupMap),
+        layoutCache(layoutCache) {}
 
   LogicalResult matchAndRewrite(DataFlowEdgeOp dataFlowEdgeOp,
                                 PatternRewriter& rewriter) const override {
@@ -500,22 +739,24 @@ class PropagateDataFlowEdgeOp : public OpRewritePattern<DataFlowEdgeOp> {
               sharding, DataFlowShardingTransformType::kAfterEdgePropagation));
         });
 
-    PropagationDirectionAlongFactor directionAlongFactor = std::bind(
-        getDirectionToPropagate, dataFlowEdgeOp, std::placeholders::_1);
+    OpShardingRuleAttr shardingRule = createIdentityShardingRule(
+        cast<ShapedType>(dataFlowEdgeOp.getType()), sources.size());
+    PropagationDirectionAlongFactor directionAlongFactor(
+        directionCache.getDirections(dataFlowEdgeOp,
+                                     shardingRule.getNumFactors()));
     return propagateTensorShardings(
-        operandsParams, resultsParams,
-        createIdentityShardingRule(cast<ShapedType>(dataFlowEdgeOp.getType()),
-                                   sources.size()),
-        directionAlongFactor, factorPropagation,
-        /*conservativePropagation=*/false, dataFlowEdgeOp, symbolTable,
-        &rewriter, shardingGroupMap);
+        operandsParams, resultsParams, shardingRule, directionAlongFactor,
+        factorPropagation, /*conservativePropagation=*/false, dataFlowEdgeOp,
+        symbolTable, &rewriter, shardingGroupMap,
+        /*factorShardingCache=*/nullptr, &layoutCache);
   }
 
  private:
   const SymbolTable& symbolTable;
-  GetDirectionToPropagateFn getDirectionToPropagate;
+  FactorDirectionCache& directionCache;
   const FactorPropagation& factorPropagation;
   const ShardingGroupMap& shardingGroupMap;
+  ShardingRuleLayoutCache& layoutCache;
 };
 
 // Propagates through a `PropagationBarrierOp` accounting for the direction in
@@ -560,6 +801,24 @@ struct BasicPropagationPass
   }
 };
 
+// A rewriter that marks ops that are notified as modified (see
+// `notifyShardingModified`) as dirty in a `PropagationScheduler`.
+class SchedulerRewriter : public PatternRewriter,
+                          public RewriterBase::Listener {
+ public:
+  SchedulerRewriter(MLIRContext* context, PropagationScheduler& scheduler)
+      : PatternRewriter(context), scheduler(scheduler) {
+    setListener(this);
+  }
+
+  void notifyOperationModified(Operation* op) override {
+    scheduler.markDirty(op);
+  }
+
+ private:
+  PropagationScheduler& scheduler;
+};
+
 // Verifies that all shapes are static and there aren't any tuple types.
 bool allValidShapes(ModuleOp moduleOp) {
   return !moduleOp
@@ -585,56 +844,232 @@ bool allValidShapes(ModuleOp moduleOp) {
               .wasInterrupted();
 }
 
+// Returns the config of the greedy rewrite driver for propagation.
+GreedyRewriteConfig getGreedyRewriteConfig() {
+  // We only need a single iteration (and another to confirm convergence),
+  // since we make sure ops whose sharding changes are added back to the
+  // worklist.
+  GreedyRewriteConfig config;
+  config.useTopDownTraversal = true;
+  config.enableRegionSimplification = mlir::GreedySimplifyRegionLevel::Disabled;
+  config.fold = false;
+  config.cseConstants = false;
+  return config;
+}
+
+// Propagates through the ops of `scheduler` with `patterns`, and adds the
+// number of visited ops to `numOpVisits`.
+//
+// An op that is saturated after it was propagated through (see
+// `isOpSaturated`) is dropped from the schedule, and counted in
+// `numSaturatedOps`.
+LogicalResult runScheduler(PropagationScheduler& scheduler,
+                           const FrozenRewritePatternSet& patterns,
+                           const SymbolTable& symbolTable,
+                           Pass::Statistic& numOpVisits,
+                           Pass::Statistic& numSaturatedOps,
+                           Operation* errorOp) {
+  SchedulerRewriter rewriter(errorOp->getContext(), scheduler);
+  PatternApplicator applicator(patterns);
+  applicator.applyDefaultCostModel();
+  LogicalResult result = scheduler.run([&](Operation* op) {
+    rewriter.setInsertionPoint(op);
+    (void)applicator.matchAndRewrite(op, rewriter);
+    if (isOpSaturated(op, symbolTable)) {
+      scheduler.markSaturated(op);
+      ++numSaturatedOps;
+    }
+  });
+  numOpVisits += scheduler.getNumVisits();
+  if (failed(result)) {
+    errorOp->emitError("Failed to converge after ")
+        << PropagationScheduler::kMaxIterations
+        << " sweeps. please contact the Shardy team.";
+  }
+  return result;
+}
+
+// Propagates through the bodies of the functions in `unit` until a fixed point
+// is reached, with the `PropagationScheduler` if `sccScheduling` is true, or
+// the greedy rewrite driver otherwise.
+LogicalResult propagateThroughFunctionUnit(
+    const FunctionUnit& unit, const FrozenRewritePatternSet& patterns,
+    const SymbolTable& symbolTable, bool sccScheduling,
+    Pass::Statistic& numOpVisits, Pass::Statistic& numSaturatedOps) {
+  if (sccScheduling) {
+    PropagationScheduler scheduler(unit);
+    return runScheduler(scheduler, patterns, symbolTable, numOpVisits,
+                        numSaturatedOps, unit.front());
+  }
+  GreedyRewriteConfig config = getGreedyRewriteConfig();
+  // The greedy rewrite driver is scoped to the body of a single function, so
+  // ops in other functions of the unit whose shardings are updated (through a
+  // sharding group) aren't added back to its worklist. Therefore, we repeat
+  // until no function in the unit changed.
+  for (int64_t iteration = 0; iteration < config.maxIterations; ++iteration) {
+    bool anyChanged = false;
+    for (FuncOp funcOp : unit) {
+      bool changed = false;
+      if (failed(applyPatternsGreedily(funcOp.getBody(), patterns, config,
+                                       &changed))) {
+        funcOp->emitError("Failed to converge after ")
+            << config.maxIterations
+            << " iterations. please contact the Shardy team.";
+        return failure();
+      }
+      anyChanged |= changed;
+    }
+    if (unit.size() == 1 || !anyChanged) {
+      return success();
+    }
+  }
+  unit.front()->emitError("Failed to converge after ")
+      << config.maxIterations
+      << " iterations. please contact the Shardy team.";
+  return failure();
+}
+
 }  // namespace
 
 PropagationDirection propagateAny(Operation*, int64_t) {
   return PropagationDirection::BOTH;
 }
 
-LogicalResult BasicPropagationPassImpl::propagate(
+LogicalResult BasicPropagationPassImpl::propagateWithinFunctions(
     ModuleOp moduleOp, const SymbolTable& symbolTable,
     const ShardingGroupMap& shardingGroupMap,
     const FactorPropagation& factorPropagation,
-    GetDirectionToPropagateFn getDirectionToPropagate) {
+    GetDirectionToPropagateFn getDirectionToPropagate,
+    std::optional<ArrayRef<FuncOp>> funcOps) {
+  auto propagateAllFuncResults = [&]() -> LogicalResult {
+    if (!funcOps) {
+      return propagateFuncResults(moduleOp, symbolTable, factorPropagation,
+                                  shardingGroupMap);
+    }
+    for (FuncOp funcOp : *funcOps) {
+      if (failed(propagateFuncResults(funcOp, symbolTable, factorPropagation,
+                                      shardingGroupMap))) {
+        return failure();
+      }
+    }
+    return success();
+  };
+
   // Pushes any shardings that exist on the `funcOp` result type attrs to the
   // corresponding values returned in the terminator of the body of `funcOp`.
-  if (failed(propagateFuncResults(moduleOp, symbolTable, factorPropagation,
-                                  shardingGroupMap))) {
+  if (failed(propagateAllFuncResults())) {
     return failure();
   }
   MLIRContext* context = moduleOp.getContext();
+  // The sharding origins and edges that are saved for debugging are tracked
+  // through actions, which can't be executed concurrently. Regions are only
+  // propagated through concurrently if shardings can flow in any direction and
+  // aren't prioritized, since otherwise a region may commit a sharding that the
+  // sequential order of the prioritized steps would have rejected.
+  if (!funcOps && parallelPropagationRegions != 0 &&
+      !context->hasActionHandler() && !prioritizedPropagation &&
+      isPropagateAny(getDirectionToPropagate)) {
+    int64_t numRegions = parallelPropagationRegions < 0
+                             ? context->getNumThreads()
+                             : parallelPropagationRegions;
+    numParallelRounds +=
+        ParallelPropagation(symbolTable, shardingGroupMap, factorPropagation,
+                            getDirectionToPropagate, conservativePropagation)
+            .propagate(moduleOp, numRegions);
+  }
+
+  // Actions can't be executed concurrently, see above.
+  const bool propagatePerFunction =
+      !funcOps && perFunctionPropagation && !context->hasActionHandler();
+  // The caches are only accessed concurrently if independent functions are
+  // propagated through on multiple threads, so they only take a lock then.
+  const bool threadSafeCaches =
+      propagatePerFunction && context->isMultithreadingEnabled();
+
+  // The caches are scoped to this call, since the direction to propagate and
+  // the factor propagation strategy may differ between calls.
+  std::optional<FactorShardingCache> factorShardingCache;
+  if (incrementalFactorPropagation) {
+    factorShardingCache.emplace(threadSafeCaches);
+  }
+  FactorDirectionCache directionCache(getDirectionToPropagate,
+                                      threadSafeCaches);
+  ShardingRuleLayoutCache layoutCache(threadSafeCaches);
   RewritePatternSet patterns(context);
   patterns.add<PropagatePropagationBarrier>(
       context, symbolTable, factorPropagation, shardingGroupMap);
-  patterns.add<PropagateDataFlowEdgeOp>(context, symbolTable,
-                                        getDirectionToPropagate,
-                                        factorPropagation, shardingGroupMap);
+  patterns.add<PropagateDataFlowEdgeOp>(context, symbolTable, directionCache,
+                                        factorPropagation, shardingGroupMap,
+                                        layoutCache);
   patterns.add<PropagateRegisteredOp>(
-      context, symbolTable, getDirectionToPropagate, factorPropagation,
-      conservativePropagation, shardingGroupMap);
-  // We only need a single iteration (and another to confirm convergence), since
-  // we make sure ops whose sharding changes are added back to the worklist.
-  GreedyRewriteConfig config;
-  config.useTopDownTraversal = true;
-  config.enableRegionSimplification = mlir::GreedySimplifyRegionLevel::Disabled;
-  config.fold = false;
-  config.cseConstants = false;
-  if (failed(applyPatternsGreedily(moduleOp, std::move(patterns), config))) {
-    // We should always converge in 2 iterations, if we don't, something is
-    // wrong.
-    moduleOp->emitError("Failed to converge after ")
-        << config.maxIterations
-        << " iterations. please contact the Shardy team.";
-    return failure();
+      context, symbolTable, directionCache, factorPropagation,
+      conservativePropagation, shardingGroupMap,
+      factorShardingCache ? &*factorShardingCache : nullptr, layoutCache);
+  FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+  if (funcOps) {
+    // The given functions are usually few, so they're propagated through as a
+    // single unit.
+    if (failed(propagateThroughFunctionUnit(
+            FunctionUnit(funcOps->begin(), funcOps->end()), frozenPatterns,
+            symbolTable, sccScheduling, numOpVisits, numSaturatedOps))) {
+      return failure();
+    }
+  } else if (propagatePerFunction) {
+    for (const FunctionWavefront& wavefront :
+         getFunctionWavefronts(moduleOp, symbolTable)) {
+      if (failed(failableParallelForEach(
+              context, wavefront, [&](const FunctionUnit& unit) {
+                return propagateThroughFunctionUnit(
+                    unit, frozenPatterns, symbolTable, sccScheduling,
+                    numOpVisits, numSaturatedOps);
+              }))) {
+        return failure();
+      }
+    }
+  } else if (sccScheduling) {
+    PropagationScheduler scheduler(moduleOp);
+    if (failed(runScheduler(scheduler, frozenPatterns, symbolTable,
+                            numOpVisits, numSaturatedOps, moduleOp))) {
+      return failure();
+    }
+  } else {
+    GreedyRewriteConfig config = getGreedyRewriteConfig();
+    if (failed(applyPatternsGreedily(moduleOp, frozenPatterns, config))) {
+      // We should always converge in 2 iterations, if we don't, something is
+      // wrong.
+      moduleOp->emitError("Failed to converge after ")
+          << config.maxIterations
+          << " iterations. please contact the Shardy team.";
+      return failure();
+    }
   }
 
   // Pushes any shardings from the values returned in the terminator of the body
   // of `funcOp` to the corresponding `funcOp` result type attrs.
-  if (failed(propagateFuncResults(moduleOp, symbolTable, factorPropagation,
-                                  shardingGroupMap))) {
-    return failure();
+  return propagateAllFuncResults();
+}
+
+LogicalResult BasicPropagationPassImpl::propagate(
+    ModuleOp moduleOp, const SymbolTable& symbolTable,
+    const ShardingGroupMap& shardingGroupMap,
+    const FactorPropagation& factorPropagation,
+    GetDirectionToPropagateFn getDirectionToPropagate) {
+  if (interprocedural) {
+    // Specializations are added to the module during interprocedural
+    // propagation, which therefore provides its own symbol table and sharding
+    // group map that include them.
+    return interprocedural->propagate(
+        moduleOp, factorPropagation,
+        [&](const SymbolTable& moduleSymbolTable,
+            const ShardingGroupMap& moduleShardingGroupMap,
+            std::optional<ArrayRef<FuncOp>> funcOps) {
+          return propagateWithinFunctions(
+              moduleOp, moduleSymbolTable, moduleShardingGroupMap,
+              factorPropagation, getDirectionToPropagate, funcOps);
+        });
   }
-  return success();
+  return propagateWithinFunctions(moduleOp, symbolTable, shardingGroupMap,
+                                  factorPropagation, getDirectionToPropagate);
 }
 
 LogicalResult BasicPropagationPassImpl::propagate(
@@ -665,10 +1100,18 @@ void BasicPropagationPassImpl::runOnOperation() {
   // group. These maps are passed through the propagation methods so that
   // `updateTensorShardings` can enforce the sharding group constraints.
   ShardingGroupMap shardingGroupMap(moduleOp);
+  interprocedural.reset();
+  if (interproceduralPropagation) {
+    interprocedural = std::make_unique<InterproceduralPropagation>(moduleOp);
+  }
   if (failed(propagate(moduleOp, symbolTable, shardingGroupMap))) {
     signalPassFailure();
     return;
   }
+  if (interprocedural) {
+    interprocedural->eraseUnusedSpecializations(moduleOp);
+    interprocedural.reset();
+  }
   if (!keepShardingRules) {
     removeShardingRules(moduleOp);
   }
@@ -686,6 +1129,11 @@ void BasicPropagationPassImpl::setPropagationOptions(
   conservativePropagation = options.conservativePropagation;
   debugShardingOrigins = options.debugShardingOrigins;
   debugPropagationEdgeSharding = options.debugPropagationEdgeSharding;
+  interproceduralPropagation = options.interproceduralPropagation;
+  sccScheduling = options.sccScheduling;
+  perFunctionPropagation = options.perFunctionPropagation;
+  parallelPropagationRegions = options.parallelPropagationRegions;
+  incrementalFactorPropagation = options.incrementalFactorPropagation;
 }
 
 std::unique_ptr<Pass> createBasicPropagationPass(
@@ -21,9 +21,11 @@ limitations under the License.
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "llvm/Support/CommandLine.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/SymbolTable.h"
@@ -33,6 +35,7 @@ limitations under the License.
 #include "shardy/dialect/sdy/ir/dialect.h"
 #include "shardy/dialect/sdy/transforms/propagation/basic_factor_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/interprocedural_propagation.h"
 #include "shardy/dialect/sdy/transforms/propagation/passes.h"
 #include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
 
@@ -75,7 +78,8 @@ class BasicPropagationPassImpl : public OperationPass<ModuleOp> {
   //
   // NOTE: there is no propagation between call ops and their called functions
   // (e.g. pushing the sharding of an operand in a call op to the function's
-  // argument) as we assume the inliner pass was called.
+  // argument) as we assume the inliner pass was called, unless
+  // `interproceduralPropagation` is set (see `InterproceduralPropagation`).
   LogicalResult propagate(
       ModuleOp moduleOp, const SymbolTable& symbolTable,
       const ShardingGroupMap& shardingGroupMap,
@@ -134,9 +138,94 @@ class BasicPropagationPassImpl : public OperationPass<ModuleOp> {
           "operand/result a sharding was propagated to a given op."),
       llvm::cl::init(false)};
 
+  Option<bool> interproceduralPropagation{
+      *this, "interprocedural-propagation",
+      llvm::cl::desc(
+          "whether to propagate across call ops by specializing each callee "
+          "once per distinct call signature, instead of assuming the module "
+          "was inlined"),
+      llvm::cl::init(false)};
+
+  Option<bool> sccScheduling{
+      *this, "scc-scheduling",
+      llvm::cl::desc(
+          "whether to propagate through ops in alternating forward and "
+          "backward sweeps over the strongly connected components of the "
+          "def-use graph, instead of using the greedy rewrite driver"),
+      llvm::cl::init(false)};
+
+  Option<bool> perFunctionPropagation{
+      *this, "per-function-propagation",
+      llvm::cl::desc(
+          "whether to propagate through independent functions concurrently, "
+          "in wavefronts where callees are propagated through before their "
+          "callers, instead of through the whole module at once"),
+      llvm::cl::init(false)};
+
+  Option<int64_t> parallelPropagationRegions{
+      *this, "parallel-propagation-regions",
+      llvm::cl::desc(
+          "the number of regions to partition the ops of the module into, "
+          "which are propagated through concurrently before the sequential "
+          "propagation confirms the fixed point. 0 disables parallel "
+          "propagation, and -1 uses the number of threads of the context. "
+          "Ignored with op or user priorities"),
+      llvm::cl::init(0)};
+
+  Option<bool> incrementalFactorPropagation{
+      *this, "incremental-factor-propagation",
+      llvm::cl::desc(
+          "whether to cache the axes propagated along each factor of an op "
+          "between visits, and only recompute the factors mapped to a tensor "
+          "whose sharding changed since the previous visit"),
+      llvm::cl::init(false)};
+
+  Statistic numOpVisits{this, "scc-op-visits",
+                        "number of times an op was propagated through with "
+                        "`scc-scheduling`"};
+
+  Statistic numSaturatedOps{
+      this, "saturated-ops",
+      "number of ops dropped from `scc-scheduling` since none of their "
+      "shardings can be updated anymore"};
+
+  Statistic numParallelRounds{
+      this, "parallel-propagation-rounds",
+      "number of rounds of exchanging shardings between regions with "
+      "`parallel-propagation-regions`"};
+
+  // Whether shardings are propagated in several prioritized steps (e.g., by
+  // user priority). If so, ops aren't propagated through concurrently (see
+  // `parallelPropagationRegions`).
+  bool prioritizedPropagation = false;
+
  private:
+  // Propagates shardings through the body of every function in `moduleOp`,
+  // see `propagate` above.
+  //
+  // If `parallelPropagationRegions` is set, ops are first propagated through
+  // concurrently (see `ParallelPropagation`), unless `getDirectionToPropagate`
+  // isn't `propagateAny` (e.g., with op priorities) or `prioritizedPropagation`
+  // is set. Then, if `sccScheduling` is set,
+  // ops are propagated through in the order given by `PropagationScheduler`,
+  // otherwise the greedy rewrite driver is used. If `perFunctionPropagation`
+  // is set, the latter is done concurrently for independent functions (see
+  // `getFunctionWavefronts`).
+  //
+  // If `funcOps` is set, only the bodies of those functions are propagated
+  // through, as a single unit and without parallel propagation.
+  LogicalResult propagateWithinFunctions(
+      ModuleOp moduleOp, const SymbolTable& symbolTable,
+      const ShardingGroupMap& shardingGroupMap,
+      const FactorPropagation& factorPropagation,
+      GetDirectionToPropagateFn getDirectionToPropagate,
+      std::optional<ArrayRef<func::FuncOp>> funcOps = std::nullopt);
+
   // This class owns the basic factor propagation strategy.
   BasicFactorPropagation basicFactorPropagation;
+  // Holds the specializations of called functions during `runOnOperation`, if
+  // `interproceduralPropagation` is set.
+  std::unique_ptr<InterproceduralPropagation> interprocedural;
 };
 
 // Runs the basic sharding propagation algorithm (see
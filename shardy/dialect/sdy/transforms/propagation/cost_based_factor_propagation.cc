@@ -0,0 +1,80 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/cost_based_factor_propagation.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+#include "shardy/dialect/sdy/transforms/propagation/reshard_cost_model.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+CostBasedFactorPropagation::CostBasedFactorPropagation(
+    std::shared_ptr<const ReshardCostModel> costModel)
+    : costModel(costModel ? std::move(costModel)
+                          : std::make_shared<BytesReshardCostModel>()) {}
+
+SmallVector<int64_t> CostBasedFactorPropagation::getFactorPreferenceOrder(
+    const ShardingProjection& projection, ArrayRef<int64_t> factorSizes,
+    AxesPerFactorRef axesPerFactor, MeshAttr mesh, Operation* op) const {
+  SmallVector<int64_t> sortedFactorIndices =
+      AggressiveFactorPropagation::getFactorPreferenceOrder(
+          projection, factorSizes, axesPerFactor, mesh, op);
+  if (!mesh) {
+    return sortedFactorIndices;
+  }
+
+  SmallVector<int64_t> elementBitWidths = getTensorElementBitWidths(
+      op, projection.getNumOperands(), projection.getNumResults());
+  SmallVector<int64_t> losingCosts(factorSizes.size(), 0);
+  for (const auto& [tensorIndex, tensor] :
+       llvm::enumerate(llvm::concat<const TensorFactorShardings>(
+           projection.getOperands(), projection.getResults()))) {
+    for (const auto& [factorIndex, factorSharding] :
+         tensor.factorIndexToSharding) {
+      ArrayRef<AxisRefAttr> axes = axesPerFactor[factorIndex];
+      if (axes.empty() ||
+          isAxisListPrefixOf(axes, factorSharding.axisRefs) ==
+              PrefixStatus::NOT_A_PREFIX) {
+        continue;
+      }
+      losingCosts[factorIndex] += costModel->getReshardCost(
+          {tensor, factorIndex, axes, factorSizes,
+           elementBitWidths[tensorIndex]},
+          mesh);
+    }
+  }
+
+  // A stable sort keeps the order of `AggressiveFactorPropagation` for factors
+  // with the same cost.
+  llvm::stable_sort(sortedFactorIndices, [&](int64_t i, int64_t j) {
+    return losingCosts[i] > losingCosts[j];
+  });
+  return sortedFactorIndices;
+}
+
+}  // namespace sdy
+}  // namespace mlir
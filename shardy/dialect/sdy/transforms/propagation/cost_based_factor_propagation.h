@@ -0,0 +1,84 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_COST_BASED_FACTOR_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_COST_BASED_FACTOR_PROPAGATION_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/reshard_cost_model.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+// A strategy that extends `AggressiveFactorPropagation` by resolving conflicts
+// across factors w.r.t. the estimated cost of the reshards on the losing side,
+// instead of the size of the source tensor.
+//
+// For each factor, the cost of losing a conflict is the sum of the reshard
+// costs (given by a `ReshardCostModel`) of all source tensors of that factor,
+// i.e., the tensors whose sharding along the factor isn't propagated. Factors
+// with a higher cost are preferred, and ties are broken by the order of
+// `AggressiveFactorPropagation`.
+//
+// Unlike the source tensor size, which is the product of factor sizes, the
+// default `BytesReshardCostModel` takes into account the element type and the
+// local (sharded) shape of each source tensor.
+//
+// For example, given C = dot(A, B), where A is a tensor<8x32xbf16>, B is a
+// tensor<32x6xf32>, and the mesh is ["a"=2].
+//
+//     F0    F1    F2
+// A  "a"    -
+// B   -    "a"
+// C               -
+//
+// The aggressive strategy prefers F0, since A has more elements than B. This
+// strategy prefers F1, since losing F1 requires all-gathering B, which has a
+// local size of 384 bytes, while losing F0 requires all-gathering A, which has
+// a local size of 256 bytes.
+class CostBasedFactorPropagation : public AggressiveFactorPropagation {
+ public:
+  // If `costModel` is null, `BytesReshardCostModel` is used.
+  explicit CostBasedFactorPropagation(
+      std::shared_ptr<const ReshardCostModel> costModel = nullptr);
+
+  const ReshardCostModel& getCostModel() const { return *costModel; }
+
+ protected:
+  // Returns the factors sorted by decreasing cost of losing a conflict.
+  //
+  // Falls back to the order of `AggressiveFactorPropagation` if `mesh` is null,
+  // as the local shapes are unknown.
+  SmallVector<int64_t> getFactorPreferenceOrder(
+      const ShardingProjection& projection, ArrayRef<int64_t> factorSizes,
+      AxesPerFactorRef axesPerFactor, MeshAttr mesh,
+      Operation* op) const override;
+
+ private:
+  std::shared_ptr<const ReshardCostModel> costModel;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_COST_BASED_FACTOR_PROPAGATION_H_
@@ -0,0 +1,186 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/cost_based_factor_propagation.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/reshard_cost_model.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/utils.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+using ::testing::ElementsAre;
+
+PropagationDirectionAlongFactor propagateAnything() {
+  return [](int64_t) { return PropagationDirection::BOTH; };
+}
+
+// A cost model that only considers losing `preferredFactor` to be costly.
+class PreferFactorCostModel : public ReshardCostModel {
+ public:
+  explicit PreferFactorCostModel(int64_t preferredFactor)
+      : preferredFactor(preferredFactor) {}
+
+  int64_t getReshardCost(const LosingTensor& losingTensor,
+                         MeshAttr) const override {
+    return losingTensor.factorIndex == preferredFactor ? 1 : 0;
+  }
+
+ private:
+  int64_t preferredFactor;
+};
+
+class CostBasedFactorPropagationTest : public PropagationTestBase {
+ protected:
+  MeshAttr createMesh() {
+    return MeshAttr::get(&context, {MeshAxisAttr::get(&context, "a", 2),
+                                    MeshAxisAttr::get(&context, "b", 2)});
+  }
+
+  // Since `op` is null, all tensors are assumed to have 32-bit elements.
+  UpdateTensorShardings propagateFactorShardings(
+      const FactorPropagation& factorPropagation,
+      ShardingProjection& projection, ArrayRef<int64_t> factorSizes) {
+    return factorPropagation.propagateFactorShardings(
+        projection, propagateAnything(), factorSizes, createMesh(),
+        /*op=*/nullptr, /*conservativePropagation=*/false);
+  }
+
+  // Returns the projection of C = dot(A, B), where F0 and F1 are the
+  // non-contracting factors of A and B respectively, and F2 is the contracting
+  // factor.
+  //
+  //     F0    F1    F2
+  // A  "a"    -    "b"
+  // B   -    "a"
+  // C               -
+  ShardingProjection createDotProjection() {
+    return ShardingProjection(
+        /*operands=*/
+        {
+            {.factorIndexToSharding =
+                 {
+                     {0, {.axisRefs = {createAxis("a")}}},
+                     {2, {.axisRefs = {createAxis("b")}}},
+                 }},
+            {.factorIndexToSharding =
+                 {
+                     {1, {.axisRefs = {createAxis("a")}}},
+                     {2, {.axisRefs = {}}},
+                 }},
+        },
+        /*results=*/{
+            {.factorIndexToSharding =
+                 {
+                     {0, {.axisRefs = {}}},
+                     {1, {.axisRefs = {}}},
+                 }},
+        });
+  }
+
+  // Returns the expected projection of `createDotProjection` after
+  // propagation, where "a" is propagated to C along `preferredFactor`.
+  ShardingProjection createExpectedDotProjection(int64_t preferredFactor) {
+    SmallVector<AxisRefAttr> resultAxes[2];
+    resultAxes[preferredFactor].push_back(createAxis("a"));
+    ShardingProjection projection = createDotProjection();
+    return ShardingProjection(
+        /*operands=*/{projection.getOperand(0),
+                      {.factorIndexToSharding =
+                           {
+                               {1, {.axisRefs = {createAxis("a")}}},
+                               {2, {.axisRefs = {createAxis("b")}}},
+                           }}},
+        /*results=*/{
+            {.factorIndexToSharding =
+                 {
+                     {0, {.axisRefs = resultAxes[0]}},
+                     {1, {.axisRefs = resultAxes[1]}},
+                 }},
+        });
+  }
+};
+
+TEST_F(CostBasedFactorPropagationTest, PreferLargerLocalSourceTensor) {
+  // A has 8 * 32 = 256 elements, and a local size of 256 / 4 * 4 = 256 bytes.
+  // B has 32 * 6 = 192 elements, and a local size of 192 / 2 * 4 = 384 bytes.
+  SmallVector<int64_t> factorSizes = {8, 6, 32};
+
+  // The aggressive strategy prefers F0, since A has more elements than B.
+  ShardingProjection aggressiveProjection = createDotProjection();
+  auto [aggressiveUpdateOperands, aggressiveUpdateResults] =
+      propagateFactorShardings(AggressiveFactorPropagation(),
+                               aggressiveProjection, factorSizes);
+  EXPECT_THAT(toSetBitsVector(aggressiveUpdateOperands), ElementsAre(1));
+  EXPECT_THAT(toSetBitsVector(aggressiveUpdateResults), ElementsAre(0));
+  EXPECT_EQ(aggressiveProjection,
+            createExpectedDotProjection(/*preferredFactor=*/0));
+
+  // This strategy prefers F1, since losing F1 requires all-gathering B, which
+  // has a larger local size than A.
+  ShardingProjection projection = createDotProjection();
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      CostBasedFactorPropagation(), projection, factorSizes);
+  EXPECT_THAT(toSetBitsVector(updateOperands), ElementsAre(1));
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(projection, createExpectedDotProjection(/*preferredFactor=*/1));
+}
+
+TEST_F(CostBasedFactorPropagationTest, CustomCostModel) {
+  SmallVector<int64_t> factorSizes = {8, 6, 32};
+
+  ShardingProjection projection = createDotProjection();
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      CostBasedFactorPropagation(
+          std::make_shared<PreferFactorCostModel>(/*preferredFactor=*/0)),
+      projection, factorSizes);
+  EXPECT_THAT(toSetBitsVector(updateOperands), ElementsAre(1));
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(projection, createExpectedDotProjection(/*preferredFactor=*/0));
+}
+
+TEST_F(CostBasedFactorPropagationTest, BytesReshardCost) {
+  TensorFactorShardings tensor = {
+      .factorIndexToSharding = {
+          {0, {.axisRefs = {createAxis("a"), createAxis("b")}}},
+          {1, {.axisRefs = {}}},
+      }};
+  SmallVector<int64_t> factorSizes = {8, 4};
+  SmallVector<AxisRefAttr> axes = {createAxis("a")};
+
+  // The local size is 8 * 4 / 4 * 2 = 16 bytes, and gathering along "a"
+  // requires receiving another 16 bytes.
+  EXPECT_EQ(BytesReshardCostModel().getReshardCost(
+                {tensor, /*factorIndex=*/0, axes, factorSizes,
+                 /*elementBitWidth=*/16},
+                createMesh()),
+            16);
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,67 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>  // IWYU pragma: keep
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"  // IWYU pragma: keep
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+#include "shardy/dialect/sdy/transforms/propagation/passes.h"  // IWYU pragma: keep
+
+namespace mlir {
+namespace sdy {
+
+#define GEN_PASS_DEF_ESTIMATEPEAKMEMORYPASS
+#include "shardy/dialect/sdy/transforms/propagation/passes.h.inc"
+
+namespace {
+
+using func::FuncOp;
+
+struct EstimatePeakMemoryPass
+    : public impl::EstimatePeakMemoryPassBase<EstimatePeakMemoryPass> {
+  using EstimatePeakMemoryPassBase::EstimatePeakMemoryPassBase;
+
+  void runOnOperation() final {
+    ModuleOp moduleOp = getOperation();
+    SymbolTable symbolTable(moduleOp);
+    for (FuncOp funcOp : moduleOp.getOps<FuncOp>()) {
+      if (funcOp.isExternal()) {
+        continue;
+      }
+      PeakMemoryEstimate estimate =
+          estimatePeakMemory(funcOp, symbolTable, topN);
+      InFlightDiagnostic diag = funcOp.emitRemark();
+      diag << "estimated peak per-device memory of "
+           << estimate.peakSizeInBytes << " bytes";
+      for (const LiveValueInfo& info : estimate.topContributors) {
+        Diagnostic& note = diag.attachNote(info.value.getLoc());
+        note << info.localSizeInBytes << " bytes live at peak";
+        if (info.sharding) {
+          note << " with sharding " << info.sharding;
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+}  // namespace sdy
+}  // namespace mlir
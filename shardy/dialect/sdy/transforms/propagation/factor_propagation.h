@@ -18,7 +18,12 @@ limitations under the License.
 
 #include <cstdint>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
@@ -27,10 +32,42 @@ limitations under the License.
 namespace mlir {
 namespace sdy {
 
-// A predicate taking a factor index and returning the propagation direction
-// along that factor.
-using PropagationDirectionAlongFactor =
-    std::function<PropagationDirection(int64_t)>;
+// Returns the propagation direction along a factor given its index.
+//
+// The directions are either precomputed for every factor of an op, in which
+// case this is a lookup into an array, or computed on every call by a
+// predicate taking a factor index.
+class PropagationDirectionAlongFactor {
+ public:
+  // Uses the precomputed direction of each factor in `directions`, which must
+  // outlive this object.
+  PropagationDirectionAlongFactor(ArrayRef<PropagationDirection> directions)
+      : directions(directions) {}
+
+  // Uses `predicate` to compute the direction along each factor.
+  template <typename PredicateT,
+            typename = std::enable_if_t<std::is_invocable_r_v<
+                PropagationDirection, PredicateT, int64_t>>>
+  PropagationDirectionAlongFactor(PredicateT predicate)
+      : predicate(std::move(predicate)) {}
+
+  PropagationDirection operator()(int64_t factorIndex) const {
+    return predicate ? predicate(factorIndex) : directions[factorIndex];
+  }
+
+ private:
+  ArrayRef<PropagationDirection> directions;
+  std::function<PropagationDirection(int64_t)> predicate;
+};
+
+// The axes that were propagated along a factor of an op in a previous visit,
+// and the direction they were propagated in.
+struct CachedFactorAxes {
+  SmallVector<AxisRefAttr> axes;
+  PropagationDirection direction = PropagationDirection::NONE;
+  // Whether `axes` were computed, i.e., the op was visited before.
+  bool valid = false;
+};
 
 // An interface for propagating factor shardings.
 class FactorPropagation {
@@ -54,6 +91,27 @@ class FactorPropagation {
       PropagationDirectionAlongFactor directionAlongFactor,
       ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
       bool conservativePropagation) const = 0;
+
+  // Same as `propagateFactorShardings`, but may reuse the axes propagated along
+  // each factor in a previous visit of `op`, which are stored in
+  // `cachedFactorAxes` (one per factor), instead of recomputing them.
+  //
+  // `dirtyFactors` are the factors that must be recomputed, i.e., the factors
+  // mapped to a dimension of a tensor whose sharding changed since the
+  // previous visit. The axes of any recomputed factor are stored back in
+  // `cachedFactorAxes`.
+  //
+  // The default implementation ignores the cache and propagates all factors.
+  virtual UpdateTensorShardings propagateDirtyFactorShardings(
+      ShardingProjection& projection, const BitVector& dirtyFactors,
+      MutableArrayRef<CachedFactorAxes> cachedFactorAxes,
+      PropagationDirectionAlongFactor directionAlongFactor,
+      ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+      bool conservativePropagation) const {
+    return propagateFactorShardings(projection, directionAlongFactor,
+                                    factorSizes, mesh, op,
+                                    conservativePropagation);
+  }
 };
 
 }  // namespace sdy
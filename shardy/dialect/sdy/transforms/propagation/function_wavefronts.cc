@@ -0,0 +1,124 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/function_wavefronts.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+
+namespace mlir {
+namespace sdy {
+
+using func::CallOp;
+using func::FuncOp;
+
+SmallVector<FunctionWavefront> getFunctionWavefronts(
+    ModuleOp moduleOp, const SymbolTable& symbolTable) {
+  SmallVector<FuncOp> funcOps = llvm::to_vector(moduleOp.getOps<FuncOp>());
+  llvm::DenseMap<Operation*, int64_t> funcToIndex;
+  for (auto [index, funcOp] : llvm::enumerate(funcOps)) {
+    funcToIndex[funcOp] = index;
+  }
+
+  // Merge functions with values in the same sharding group, and collect the
+  // call edges between functions.
+  llvm::EquivalenceClasses<int64_t> funcEquivalences;
+  llvm::DenseMap<int64_t, int64_t> groupIdToFunc;
+  SmallVector<std::pair<int64_t, int64_t>> callerAndCallee;
+  for (auto [index, funcOp] : llvm::enumerate(funcOps)) {
+    funcEquivalences.insert(index);
+    funcOp.walk([&, index = index](Operation* op) {
+      if (auto shardingGroupOp = dyn_cast<ShardingGroupOp>(op)) {
+        auto [it, inserted] =
+            groupIdToFunc.try_emplace(shardingGroupOp.getGroupId(), index);
+        funcEquivalences.unionSets(it->second, index);
+      } else if (auto callOp = dyn_cast<CallOp>(op)) {
+        if (auto callee = symbolTable.lookup<FuncOp>(callOp.getCallee())) {
+          callerAndCallee.push_back({index, funcToIndex[callee]});
+        }
+      }
+    });
+  }
+
+  // Each unit is identified by the leader of its functions, and units are
+  // numbered by the program order of their first function.
+  SmallVector<FunctionUnit> units;
+  SmallVector<int64_t> funcToUnit(funcOps.size());
+  llvm::DenseMap<int64_t, int64_t> leaderToUnit;
+  for (auto [index, funcOp] : llvm::enumerate(funcOps)) {
+    auto [it, inserted] = leaderToUnit.try_emplace(
+        funcEquivalences.getLeaderValue(index), units.size());
+    if (inserted) {
+      units.emplace_back();
+    }
+    units[it->second].push_back(funcOp);
+    funcToUnit[index] = it->second;
+  }
+
+  SmallVector<SmallVector<int64_t>> unitToCallees(units.size());
+  for (auto [caller, callee] : callerAndCallee) {
+    int64_t callerUnit = funcToUnit[caller];
+    int64_t calleeUnit = funcToUnit[callee];
+    if (callerUnit != calleeUnit) {
+      unitToCallees[callerUnit].push_back(calleeUnit);
+    }
+  }
+
+  // Peel off the units whose callees are all in earlier wavefronts.
+  SmallVector<FunctionWavefront> wavefronts;
+  llvm::BitVector done(units.size());
+  while (!done.all()) {
+    SmallVector<int64_t> ready;
+    for (int64_t unit = 0; unit < static_cast<int64_t>(units.size()); ++unit) {
+      if (!done.test(unit) &&
+          llvm::all_of(unitToCallees[unit],
+                       [&](int64_t callee) { return done.test(callee); })) {
+        ready.push_back(unit);
+      }
+    }
+    FunctionWavefront& wavefront = wavefronts.emplace_back();
+    if (ready.empty()) {
+      // The remaining units call each other recursively, or call units that
+      // do.
+      FunctionUnit& remaining = wavefront.emplace_back();
+      for (auto [index, funcOp] : llvm::enumerate(funcOps)) {
+        if (!done.test(funcToUnit[index])) {
+          remaining.push_back(funcOp);
+        }
+      }
+      break;
+    }
+    for (int64_t unit : ready) {
+      wavefront.push_back(std::move(units[unit]));
+      done.set(unit);
+    }
+  }
+  return wavefronts;
+}
+
+}  // namespace sdy
+}  // namespace mlir
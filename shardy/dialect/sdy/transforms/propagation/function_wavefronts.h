@@ -0,0 +1,54 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_FUNCTION_WAVEFRONTS_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_FUNCTION_WAVEFRONTS_H_
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Support/LLVM.h"
+
+namespace mlir {
+namespace sdy {
+
+// Functions that are propagated through together, since propagating through
+// one of them can update the shardings in another, in program order.
+using FunctionUnit = SmallVector<func::FuncOp>;
+
+// Units of functions that can be propagated through concurrently.
+using FunctionWavefront = SmallVector<FunctionUnit>;
+
+// Partitions the functions in `moduleOp` into units that can be propagated
+// through independently of each other, and orders them in wavefronts, such that
+// the callees of the functions in a wavefront (via `func.call`) are all in
+// earlier wavefronts.
+//
+// Functions with values in the same sharding group are in the same unit.
+// Functions that call each other recursively, and the functions that call
+// them, are all put in a single unit of the last wavefront. Units are in the
+// program order of their first function within each wavefront.
+//
+// Propagating callees before their callers only helps when
+// `interproceduralPropagation` is set, since call ops are otherwise opaque to
+// propagation and the order of functions doesn't affect the result.
+SmallVector<FunctionWavefront> getFunctionWavefronts(
+    ModuleOp moduleOp, const SymbolTable& symbolTable);
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_FUNCTION_WAVEFRONTS_H_
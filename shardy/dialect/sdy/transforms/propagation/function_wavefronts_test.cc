@@ -0,0 +1,144 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/function_wavefronts.h"
+
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+using ::testing::ElementsAre;
+
+class FunctionWavefrontsTest : public PropagationTestBase {};
+
+// Returns the names of the functions in each unit of each wavefront.
+SmallVector<SmallVector<SmallVector<std::string>>> getWavefrontNames(
+    ModuleOp module) {
+  SymbolTable symbolTable(module);
+  return llvm::map_to_vector(
+      getFunctionWavefronts(module, symbolTable),
+      [](const FunctionWavefront& wavefront) {
+        return llvm::map_to_vector(wavefront, [](const FunctionUnit& unit) {
+          return llvm::map_to_vector(unit, [](func::FuncOp funcOp) {
+            return funcOp.getSymName().str();
+          });
+        });
+      });
+}
+
+TEST_F(FunctionWavefrontsTest, CalleesBeforeCallers) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = call @a(%arg0) : (tensor<8xf32>) -> tensor<8xf32>
+      %1 = call @b(%0) : (tensor<8xf32>) -> tensor<8xf32>
+      return %1 : tensor<8xf32>
+    }
+
+    func.func private @a(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = call @c(%arg0) : (tensor<8xf32>) -> tensor<8xf32>
+      return %0 : tensor<8xf32>
+    }
+
+    func.func private @b(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      return %arg0 : tensor<8xf32>
+    }
+
+    func.func private @c(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      return %arg0 : tensor<8xf32>
+    }
+
+    func.func @independent(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      return %arg0 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  EXPECT_THAT(
+      getWavefrontNames(*module),
+      ElementsAre(
+          ElementsAre(ElementsAre("b"), ElementsAre("c"),
+                      ElementsAre("independent")),
+          ElementsAre(ElementsAre("a")), ElementsAre(ElementsAre("main"))));
+}
+
+TEST_F(FunctionWavefrontsTest, ShardingGroupMergesFunctions) {
+  const std::string program = R"mlir(
+    func.func @f(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      sdy.sharding_group %arg0 group_id=0 : tensor<8xf32>
+      return %arg0 : tensor<8xf32>
+    }
+
+    func.func @g(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      return %arg0 : tensor<8xf32>
+    }
+
+    func.func @h(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      sdy.sharding_group %arg0 group_id=0 : tensor<8xf32>
+      return %arg0 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  EXPECT_THAT(getWavefrontNames(*module),
+              ElementsAre(ElementsAre(ElementsAre("f", "h"),
+                                      ElementsAre("g"))));
+}
+
+TEST_F(FunctionWavefrontsTest, RecursiveCallsInLastWavefront) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = call @ping(%arg0) : (tensor<8xf32>) -> tensor<8xf32>
+      %1 = call @leaf(%0) : (tensor<8xf32>) -> tensor<8xf32>
+      return %1 : tensor<8xf32>
+    }
+
+    func.func private @ping(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = call @pong(%arg0) : (tensor<8xf32>) -> tensor<8xf32>
+      return %0 : tensor<8xf32>
+    }
+
+    func.func private @pong(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = call @ping(%arg0) : (tensor<8xf32>) -> tensor<8xf32>
+      return %0 : tensor<8xf32>
+    }
+
+    func.func private @leaf(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      return %arg0 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  EXPECT_THAT(getWavefrontNames(*module),
+              ElementsAre(ElementsAre(ElementsAre("leaf")),
+                          ElementsAre(ElementsAre("main", "ping", "pong"))));
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,382 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/incremental_propagation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/Visitors.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_priority_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+using func::FuncOp;
+
+// Merges the sorted `other` into the sorted `ids`.
+void mergeInto(SmallVector<int64_t, 2>& ids, ArrayRef<int64_t> other) {
+  if (other.empty()) {
+    return;
+  }
+  SmallVector<int64_t, 2> merged;
+  std::set_union(ids.begin(), ids.end(), other.begin(), other.end(),
+                 std::back_inserter(merged));
+  ids = std::move(merged);
+}
+
+// Returns true if the sorted `lhs` and `rhs` have a common element.
+bool intersects(ArrayRef<int64_t> lhs, ArrayRef<int64_t> rhs) {
+  const int64_t* lhsIt = lhs.begin();
+  const int64_t* rhsIt = rhs.begin();
+  while (lhsIt != lhs.end() && rhsIt != rhs.end()) {
+    if (*lhsIt == *rhsIt) {
+      return true;
+    }
+    *lhsIt < *rhsIt ? ++lhsIt : ++rhsIt;
+  }
+  return false;
+}
+
+// Returns the values whose shardings are read when propagating through `op`.
+SmallVector<Value> getPropagatedValues(Operation* op) {
+  if (auto dataFlowEdgeOp = dyn_cast<DataFlowEdgeOp>(op)) {
+    SmallVector<Value> values = dataFlowEdgeOp.getSources();
+    values.push_back(dataFlowEdgeOp.getResult());
+    return values;
+  }
+  SmallVector<Value> values = llvm::to_vector(op->getOperands());
+  llvm::append_range(values, op->getResults());
+  return values;
+}
+
+// Returns failure if any dimension of `sharding` has a user priority, which
+// would require propagating in several steps (see
+// `UserPriorityPropagationPassImpl`).
+LogicalResult checkNoUserPriority(TensorShardingAttr sharding, Location loc) {
+  if (sharding && llvm::any_of(sharding.getDimShardings(),
+                               [](DimensionShardingAttr dimSharding) {
+                                 return dimSharding.getPriorityOrDefault() > 0;
+                               })) {
+    return emitError(loc)
+           << "incremental propagation doesn't support user priorities";
+  }
+  return success();
+}
+
+}  // namespace
+
+IncrementalPropagation::IncrementalPropagation(ModuleOp moduleOp)
+    : moduleOp(moduleOp),
+      symbolTable(moduleOp),
+      shardingGroupMap(moduleOp),
+      stageDirections(getOpPriorityStageDirections()) {}
+
+IncrementalPropagation::Provenance IncrementalPropagation::addSource(
+    Value value) {
+  TensorShardingAttr sharding = getSharding(value);
+  if (!sharding) {
+    sources.erase(value);
+    return {};
+  }
+  int64_t sourceId = nextSourceId++;
+  sources[value] = {sourceId, sharding};
+  return {sourceId};
+}
+
+void IncrementalPropagation::propagateOps(ArrayRef<Operation*> ops) {
+  auto recordProvenance = [&](Operation* op, Value value) {
+    Provenance merged;
+    for (Value propagatedValue : getPropagatedValues(op)) {
+      if (Value shardableValue = getShardableValue(propagatedValue)) {
+        if (auto it = provenance.find(shardableValue);
+            it != provenance.end()) {
+          mergeInto(merged, it->second);
+        }
+      }
+    }
+    mergeInto(provenance[value], merged);
+  };
+
+  // Same as `OpPriorityPropagationPassImpl::propagate`, each stage propagates
+  // until a fixed point is reached before the next one starts.
+  for (const GetDirectionToPropagateFn& direction : stageDirections) {
+    ShardingSideTable sideTable;
+    SideTablePropagation sideTablePropagation(symbolTable, shardingGroupMap,
+                                              factorPropagation, direction);
+    SmallVector<Operation*> worklist(ops);
+    auto addToWorklist = [&](Operation* op) { worklist.push_back(op); };
+    for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+      sideTablePropagation.propagateFuncResults(funcOp, sideTable,
+                                                addToWorklist);
+    }
+    // Propagating to the return values may affect other ops, e.g., the ones
+    // using a value in the same sharding group, so we repeat until no return
+    // value is updated.
+    while (!worklist.empty()) {
+      sideTablePropagation.propagateOps(
+          worklist, sideTable, [](Operation*) { return true; },
+          recordProvenance);
+      worklist.clear();
+      for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+        sideTablePropagation.propagateFuncResults(funcOp, sideTable,
+                                                  addToWorklist);
+      }
+    }
+    sideTable.commit();
+  }
+}
+
+LogicalResult IncrementalPropagation::propagate() {
+  sources.clear();
+  funcResultSources.clear();
+  provenance.clear();
+  erasedSources.clear();
+
+  auto addValueSource = [&](Value value) {
+    if (Value shardableValue = getShardableValue(value)) {
+      if (Provenance ids = addSource(shardableValue); !ids.empty()) {
+        provenance[shardableValue] = std::move(ids);
+      }
+    }
+  };
+  SmallVector<Operation*> ops;
+  moduleOp.walk<WalkOrder::PreOrder>([&](Operation* op) {
+    if (op == moduleOp) {
+      return;
+    }
+    ops.push_back(op);
+    llvm::for_each(op->getResults(), addValueSource);
+    for (Region& region : op->getRegions()) {
+      for (Block& block : region) {
+        llvm::for_each(block.getArguments(), addValueSource);
+      }
+    }
+  });
+
+  for (auto& [value, source] : sources) {
+    if (failed(checkNoUserPriority(source.second, value.getLoc()))) {
+      return failure();
+    }
+  }
+
+  // A function result sharding is propagated to its return value, which
+  // therefore derives from it.
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    for (OpOperand& returnOperand : getBodyTerminatorOpOperands(funcOp)) {
+      int64_t resNum = returnOperand.getOperandNumber();
+      if (TensorShardingAttr sharding = getFuncResultSharding(funcOp, resNum)) {
+        if (failed(checkNoUserPriority(sharding, funcOp.getLoc()))) {
+          return failure();
+        }
+        funcResultSources[{funcOp, resNum}] = sharding;
+        if (Value returnValue = getShardableValue(returnOperand.get())) {
+          mergeInto(provenance[returnValue], {nextSourceId++});
+        }
+      }
+    }
+  }
+
+  propagateOps(ops);
+  return success();
+}
+
+LogicalResult IncrementalPropagation::repropagate(
+    ArrayRef<int64_t> changedSources, ArrayRef<Value> seeds) {
+  numResetShardings = 0;
+  if (shardingGroupsChanged) {
+    shardingGroupMap = ShardingGroupMap(moduleOp);
+    shardingGroupsChanged = false;
+  }
+  Provenance resetSources(changedSources.begin(), changedSources.end());
+  mergeInto(resetSources, erasedSources);
+  erasedSources.clear();
+  llvm::DenseSet<Value> seedSet(seeds.begin(), seeds.end());
+  llvm::DenseSet<Operation*> affectedOps;
+  auto addAffectedOp = [&](Operation* op) { affectedOps.insert(op); };
+
+  // Resets every sharding in the affected cone, other than the seeds, to its
+  // source sharding if it's a source, or to a fully open sharding otherwise.
+  SmallVector<Value> cone;
+  for (auto& [value, ids] : provenance) {
+    if (!seedSet.contains(value) && intersects(ids, resetSources)) {
+      cone.push_back(value);
+    }
+  }
+  for (Value value : cone) {
+    if (auto it = sources.find(value); it != sources.end()) {
+      setSharding(value, it->second.second);
+      provenance[value] = {it->second.first};
+    } else {
+      if (TensorShardingAttr sharding = getSharding(value)) {
+        setSharding(value, TensorShardingAttr::getFullyOpenLike(sharding));
+      }
+      provenance.erase(value);
+    }
+    ++numResetShardings;
+    forEachOpAffectedBySharding(value, addAffectedOp);
+  }
+  llvm::DenseSet<Value> coneSet(cone.begin(), cone.end());
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    for (OpOperand& returnOperand : getBodyTerminatorOpOperands(funcOp)) {
+      Value returnValue = getShardableValue(returnOperand.get());
+      int64_t resNum = returnOperand.getOperandNumber();
+      TensorShardingAttr sharding = getFuncResultSharding(funcOp, resNum);
+      if (!sharding || !coneSet.contains(returnValue)) {
+        continue;
+      }
+      auto it = funcResultSources.find({funcOp, resNum});
+      setFuncResultSharding(
+          funcOp, resNum,
+          it != funcResultSources.end()
+              ? it->second
+              : TensorShardingAttr::getFullyOpenLike(sharding));
+      ++numResetShardings;
+    }
+  }
+  for (Value seed : seeds) {
+    forEachOpAffectedBySharding(seed, addAffectedOp);
+  }
+
+  // Propagates through the affected ops in program order.
+  SmallVector<Operation*> ops;
+  moduleOp.walk<WalkOrder::PreOrder>([&](Operation* op) {
+    if (affectedOps.contains(op)) {
+      ops.push_back(op);
+    }
+  });
+  propagateOps(ops);
+  return success();
+}
+
+LogicalResult IncrementalPropagation::propagateFromValues(
+    ArrayRef<Value> changedValues) {
+  for (Value value : changedValues) {
+    if (failed(checkNoUserPriority(getSharding(value), value.getLoc()))) {
+      return failure();
+    }
+  }
+  Provenance changedSources;
+  SmallVector<Value> seeds;
+  for (Value value : changedValues) {
+    value = getShardableValue(value);
+    if (!value) {
+      continue;
+    }
+    if (auto it = provenance.find(value); it != provenance.end()) {
+      mergeInto(changedSources, it->second);
+      provenance.erase(it);
+    }
+    if (Provenance ids = addSource(value); !ids.empty()) {
+      provenance[value] = std::move(ids);
+    }
+    seeds.push_back(value);
+  }
+  return repropagate(changedSources, seeds);
+}
+
+LogicalResult IncrementalPropagation::propagateFromOps(
+    ArrayRef<Operation*> changedOps) {
+  for (Operation* op : changedOps) {
+    for (Value result : op->getResults()) {
+      if (failed(checkNoUserPriority(getSharding(result), result.getLoc()))) {
+        return failure();
+      }
+    }
+  }
+  // Inserted ops may have been added to sharding groups.
+  shardingGroupsChanged = true;
+
+  Provenance changedSources;
+  SmallVector<Value> seeds;
+  for (Operation* op : changedOps) {
+    for (Value value : getPropagatedValues(op)) {
+      Value shardableValue = getShardableValue(value);
+      if (!shardableValue) {
+        continue;
+      }
+      if (auto it = provenance.find(shardableValue); it != provenance.end()) {
+        mergeInto(changedSources, it->second);
+      }
+    }
+    for (Value result : op->getResults()) {
+      Value shardableValue = getShardableValue(result);
+      if (!shardableValue) {
+        continue;
+      }
+      provenance.erase(shardableValue);
+      if (Provenance ids = addSource(shardableValue); !ids.empty()) {
+        provenance[shardableValue] = std::move(ids);
+      }
+      seeds.push_back(shardableValue);
+    }
+  }
+  // The sources of the changed results were collected above, so they are reset
+  // as well, except for the seeds themselves.
+  return repropagate(changedSources, seeds);
+}
+
+void IncrementalPropagation::notifyOpErased(Operation* op) {
+  // Erased ops may have been in sharding groups.
+  shardingGroupsChanged = true;
+  // The values of `op` are removed from the maps before they are erased, so
+  // that a value allocated at the same address later doesn't inherit them.
+  auto removeValue = [&](Value value) {
+    if (auto it = provenance.find(value); it != provenance.end()) {
+      mergeInto(erasedSources, it->second);
+      provenance.erase(it);
+    }
+    if (auto it = sources.find(value); it != sources.end()) {
+      mergeInto(erasedSources, {it->second.first});
+      sources.erase(it);
+    }
+  };
+  op->walk([&](Operation* nestedOp) {
+    llvm::for_each(nestedOp->getResults(), removeValue);
+    for (Region& region : nestedOp->getRegions()) {
+      for (Block& block : region) {
+        llvm::for_each(block.getArguments(), removeValue);
+      }
+    }
+    if (auto funcOp = dyn_cast<FuncOp>(nestedOp)) {
+      for (int64_t resNum : llvm::seq<int64_t>(funcOp.getNumResults())) {
+        funcResultSources.erase({funcOp, resNum});
+      }
+    }
+  });
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,142 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INCREMENTAL_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INCREMENTAL_PROPAGATION_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/basic_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+
+namespace mlir {
+namespace sdy {
+
+// A propagation session that re-propagates a module after some of its
+// shardings were edited, without propagating through the entire module again.
+//
+// Shardings are propagated the same way as by the propagation pass with its
+// default options (see `UserPriorityPropagationPassImpl`), i.e., with the
+// aggressive factor propagation strategy in each op-priority stage, but the
+// shardings are read and written with a `SideTablePropagation`. User priorities
+// aren't supported, since they require propagating in several steps.
+//
+// The session records the provenance of every sharding, i.e., the sources it
+// was derived from. A source is a value (or function result) that had a
+// sharding before propagation, or whose sharding was edited since. The
+// provenance of a sharding updated by propagating through an op is the union of
+// the provenance of all tensors of that op.
+//
+// When sources are edited or erased, only the shardings derived from them (the
+// affected cone) are reset to what they were before propagation, and
+// propagation restarts from the ops that are affected by the cone. All other
+// shardings are kept as they are.
+//
+// The module must first be propagated through with `propagate`, which records
+// the provenance, and must not be propagated through by anything else while
+// the session is alive.
+class IncrementalPropagation {
+ public:
+  explicit IncrementalPropagation(ModuleOp moduleOp);
+
+  // Propagates shardings through the entire module, and records the provenance
+  // of all shardings.
+  //
+  // Returns failure if any sharding has a user priority.
+  LogicalResult propagate();
+
+  // Re-propagates after the shardings of `changedValues` were set, replaced or
+  // removed in the IR since the last propagation.
+  LogicalResult propagateFromValues(ArrayRef<Value> changedValues);
+
+  // Re-propagates after `changedOps` were added to the module or modified,
+  // e.g. a new `sdy.sharding_constraint` was inserted. The shardings of the
+  // results of these ops become sources, and all shardings that were derived
+  // from the same sources as their operands are reset.
+  //
+  // Ops that were erased since the last propagation must have been passed to
+  // `notifyOpErased` before they were erased.
+  LogicalResult propagateFromOps(ArrayRef<Operation*> changedOps);
+
+  // Stops tracking the shardings of `op` and of the ops nested in it, which
+  // must be called before `op` is erased. All shardings that were derived from
+  // the same sources as the results of these ops are reset by the next call to
+  // `propagateFromValues` or `propagateFromOps`.
+  void notifyOpErased(Operation* op);
+
+  // Returns the number of shardings that were reset by the last call to
+  // `propagateFromValues` or `propagateFromOps`.
+  int64_t getNumResetShardings() const { return numResetShardings; }
+
+ private:
+  // The ids of the sources a sharding was derived from, sorted and unique.
+  using Provenance = SmallVector<int64_t, 2>;
+
+  // Records `value` as a source with its current sharding, if it has one, and
+  // returns its provenance.
+  Provenance addSource(Value value);
+
+  // Resets all shardings derived from any of `changedSources` or
+  // `erasedSources`, and propagates from the ops affected by them and by
+  // `seeds`. Rebuilds `shardingGroupMap` first if `shardingGroupsChanged`.
+  LogicalResult repropagate(ArrayRef<int64_t> changedSources,
+                            ArrayRef<Value> seeds);
+
+  // Propagates through `ops` (and all ops affected by updated shardings) until
+  // a fixed point is reached in each op-priority stage, and records the
+  // provenance of updated shardings.
+  void propagateOps(ArrayRef<Operation*> ops);
+
+  ModuleOp moduleOp;
+  SymbolTable symbolTable;
+  ShardingGroupMap shardingGroupMap;
+  AggressiveFactorPropagation factorPropagation;
+  // The direction to propagate in each op-priority stage.
+  SmallVector<GetDirectionToPropagateFn> stageDirections;
+  int64_t nextSourceId = 0;
+  // The source id and sharding of each source value (keyed by its shardable
+  // value).
+  llvm::DenseMap<Value, std::pair<int64_t, TensorShardingAttr>> sources;
+  // The sharding of each function result that had one before propagation.
+  llvm::DenseMap<std::pair<Operation*, int64_t>, TensorShardingAttr>
+      funcResultSources;
+  // The provenance of each value with a sharding (keyed by its shardable
+  // value).
+  llvm::DenseMap<Value, Provenance> provenance;
+  // The provenance of all values passed to `notifyOpErased` since the last
+  // propagation.
+  Provenance erasedSources;
+  // Whether ops were inserted or erased since `shardingGroupMap` was built.
+  bool shardingGroupsChanged = false;
+  int64_t numResetShardings = 0;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INCREMENTAL_PROPAGATION_H_
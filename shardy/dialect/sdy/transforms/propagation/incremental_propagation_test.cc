@@ -0,0 +1,230 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/incremental_propagation.h"
+
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/AsmParser/AsmParser.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/passes.h"
+#include "shardy/dialect/sdy/transforms/propagation/user_priority_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+class IncrementalPropagationTest : public PropagationTestBase {
+ protected:
+  OwningOpRef<ModuleOp> parse(const std::string& program) {
+    return parseSourceString<ModuleOp>(program, &context);
+  }
+
+  TensorShardingAttr parseSharding(const std::string& sharding) {
+    return cast<TensorShardingAttr>(parseAttribute(sharding, &context));
+  }
+
+  // Propagates through `module` with the propagation pass that is run by the
+  // propagation pipeline, which the session should match.
+  LogicalResult runPropagationPass(ModuleOp module) {
+    PassManager pm(&context);
+    pm.addPass(createUserPriorityPropagationPass(PropagationOptions()));
+    return pm.run(module);
+  }
+};
+
+std::string print(ModuleOp module) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  module.print(os);
+  return str;
+}
+
+func::FuncOp getMain(ModuleOp module) {
+  return cast<func::FuncOp>(module.lookupSymbol("main"));
+}
+
+constexpr char kChains[] = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+                    %arg1: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"b"}]>})
+        -> (tensor<8x8xf32>, tensor<8x8xf32>) {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = stablehlo.abs %0 : tensor<8x8xf32>
+      %2 = stablehlo.negate %arg1 : tensor<8x8xf32>
+      %3 = stablehlo.abs %2 : tensor<8x8xf32>
+      return %1, %3 : tensor<8x8xf32>, tensor<8x8xf32>
+    })mlir";
+
+TEST_F(IncrementalPropagationTest, EditedArgMatchesFullPropagation) {
+  OwningOpRef<ModuleOp> module = parse(kChains);
+  ASSERT_TRUE(module);
+  IncrementalPropagation session(*module);
+  ASSERT_TRUE(succeeded(session.propagate()));
+
+  TensorShardingAttr newSharding =
+      parseSharding(R"(#sdy.sharding<@mesh, [{"b"}, {}]>)");
+  BlockArgument arg0 = getMain(*module).getArgument(0);
+  setSharding(arg0, newSharding);
+  ASSERT_TRUE(succeeded(session.propagateFromValues({arg0})));
+  // Only the shardings of %0, %1 and the first function result are reset.
+  EXPECT_EQ(session.getNumResetShardings(), 3);
+
+  OwningOpRef<ModuleOp> expected = parse(kChains);
+  ASSERT_TRUE(expected);
+  setSharding(getMain(*expected).getArgument(0), newSharding);
+  ASSERT_TRUE(succeeded(runPropagationPass(*expected)));
+  EXPECT_EQ(print(*module), print(*expected));
+}
+
+TEST_F(IncrementalPropagationTest, InsertedConstraintMatchesFullPropagation) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32>) -> tensor<8x8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = stablehlo.abs %0 : tensor<8x8xf32>
+      return %1 : tensor<8x8xf32>
+    })mlir";
+  const std::string programWithConstraint = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32>) -> tensor<8x8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = sdy.sharding_constraint %0 <@mesh, [{"a"}, {"b"}]> : tensor<8x8xf32>
+      %2 = stablehlo.abs %1 : tensor<8x8xf32>
+      return %2 : tensor<8x8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parse(program);
+  ASSERT_TRUE(module);
+  IncrementalPropagation session(*module);
+  ASSERT_TRUE(succeeded(session.propagate()));
+
+  func::FuncOp main = getMain(*module);
+  SmallVector<Operation*> ops = llvm::map_to_vector(
+      main.getBody().front().without_terminator(),
+      [](Operation& op) { return &op; });
+  OpBuilder builder(ops[1]);
+  auto constraint = builder.create<ShardingConstraintOp>(
+      ops[0]->getLoc(), ops[0]->getResult(0),
+      parseSharding(R"(#sdy.sharding<@mesh, [{"a"}, {"b"}]>)"));
+  ops[1]->setOperand(0, constraint.getResult());
+  ASSERT_TRUE(succeeded(session.propagateFromOps({constraint})));
+
+  OwningOpRef<ModuleOp> expected = parse(programWithConstraint);
+  ASSERT_TRUE(expected);
+  ASSERT_TRUE(succeeded(runPropagationPass(*expected)));
+  EXPECT_EQ(print(*module), print(*expected));
+}
+
+TEST_F(IncrementalPropagationTest, ErasedConstraintMatchesFullPropagation) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"b"}]>})
+        -> tensor<8x8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = stablehlo.abs %0 : tensor<8x8xf32>
+      return %1 : tensor<8x8xf32>
+    })mlir";
+  const std::string programWithConstraint = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"b"}]>})
+        -> tensor<8x8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = sdy.sharding_constraint %0 <@mesh, [{"a"}, {"b"}]> : tensor<8x8xf32>
+      %2 = stablehlo.abs %1 : tensor<8x8xf32>
+      return %2 : tensor<8x8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parse(programWithConstraint);
+  ASSERT_TRUE(module);
+  IncrementalPropagation session(*module);
+  ASSERT_TRUE(succeeded(session.propagate()));
+
+  // The shardings derived from the constraint are reset, even though it no
+  // longer exists when re-propagating.
+  auto constraint = cast<ShardingConstraintOp>(
+      *getMain(*module).getArgument(0).getUsers().begin()->getUsers().begin());
+  constraint.getResult().replaceAllUsesWith(constraint.getInput());
+  session.notifyOpErased(constraint);
+  constraint.erase();
+  ASSERT_TRUE(succeeded(session.propagateFromOps({})));
+
+  OwningOpRef<ModuleOp> expected = parse(program);
+  ASSERT_TRUE(expected);
+  ASSERT_TRUE(succeeded(runPropagationPass(*expected)));
+  EXPECT_EQ(print(*module), print(*expected));
+}
+
+TEST_F(IncrementalPropagationTest, UserPrioritiesAreNotSupported) {
+  OwningOpRef<ModuleOp> module = parse(R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}p1, {}]>})
+        -> tensor<8x8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      return %0 : tensor<8x8xf32>
+    })mlir");
+  ASSERT_TRUE(module);
+  IncrementalPropagation session(*module);
+  ScopedDiagnosticHandler diagnosticHandler(
+      &context, [](Diagnostic&) { return success(); });
+  EXPECT_TRUE(failed(session.propagate()));
+}
+
+TEST_F(IncrementalPropagationTest, ReturnValueShardingIsPropagatedToGroup) {
+  OwningOpRef<ModuleOp> module = parse(R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32>, %arg1: tensor<8x8xf32>)
+        -> (tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+            tensor<8x8xf32>) {
+      %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+      %1 = stablehlo.abs %arg1 : tensor<8x8xf32>
+      sdy.sharding_group %0 group_id=0 : tensor<8x8xf32>
+      sdy.sharding_group %1 group_id=0 : tensor<8x8xf32>
+      return %0, %1 : tensor<8x8xf32>, tensor<8x8xf32>
+    })mlir");
+  ASSERT_TRUE(module);
+  IncrementalPropagation session(*module);
+  ASSERT_TRUE(succeeded(session.propagate()));
+
+  // The sharding propagated from the first function result to %0 is also
+  // propagated to %1, which is in the same group, and from there to %arg1.
+  TensorShardingAttr expectedSharding =
+      parseSharding(R"(#sdy.sharding<@mesh, [{"a", ?}, {?}]>)");
+  func::FuncOp main = getMain(*module);
+  Operation* absOp = *main.getArgument(1).getUsers().begin();
+  EXPECT_EQ(getSharding(absOp->getResult(0)), expectedSharding);
+  EXPECT_EQ(getSharding(main.getArgument(1)), expectedSharding);
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
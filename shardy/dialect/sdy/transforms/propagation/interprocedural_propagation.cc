@@ -0,0 +1,398 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/interprocedural_propagation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/Visitors.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_builder.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+using func::CallOp;
+using func::FuncOp;
+
+CallSignature getCallSignature(CallOp callOp) {
+  CallSignature signature = getShardings(callOp.getOperands());
+  signature.append(getShardings(callOp.getResults()));
+  return signature;
+}
+
+CallSignature getFuncSignature(FuncOp funcOp) {
+  CallSignature signature = getShardings(funcOp.getArguments());
+  for (int64_t resNum = 0; resNum < funcOp.getNumResults(); ++resNum) {
+    signature.push_back(getFuncResultSharding(funcOp, resNum));
+  }
+  return signature;
+}
+
+// Propagates `sourceSharding` to a tensor of type `type` whose sharding is
+// `targetSharding`, as if they were the operand and result of an identity op.
+//
+// Returns the updated target sharding, or null if it can't be updated.
+TensorShardingAttr propagateToTarget(TensorShardingAttr sourceSharding,
+                                     TensorShardingAttr targetSharding,
+                                     Type type, Operation* op,
+                                     const SymbolTable& symbolTable,
+                                     const FactorPropagation& factorPropagation) {
+  auto tensorType = dynCastStaticShapedType(type);
+  if (!sourceSharding || !tensorType) {
+    return nullptr;
+  }
+  std::optional<StringRef> meshName =
+      getCommonMeshName(sourceSharding, targetSharding, symbolTable);
+  if (!meshName.has_value()) {
+    return nullptr;
+  }
+  MeshAttr mesh = getMeshAttr(symbolTable, *meshName);
+  OpShardingRuleAttr shardingRule = createIdentityShardingRule(tensorType);
+  ShardingProjection projection = ShardingProjection::build(
+      sourceSharding, targetSharding, shardingRule, mesh);
+  auto [_, updateResults] = factorPropagation.propagateFactorShardings(
+      projection,
+      [](int64_t) { return PropagationDirection::FORWARD; },
+      shardingRule.getFactorSizes(), mesh, op,
+      /*conservativePropagation=*/false);
+  if (!updateResults.test(0)) {
+    return nullptr;
+  }
+  TensorShardingAttr newSharding =
+      projection.getResult(0).createTensorShardingAttr(
+          op->getContext(), shardingRule.getResultMapping(0),
+          shardingRule.getFactorSizes(), *meshName, mesh);
+  if ((!targetSharding && newSharding.emptyAxes()) ||
+      newSharding == targetSharding) {
+    return nullptr;
+  }
+  return newSharding;
+}
+
+// Returns true if propagating the shardings of `callOp` to `specialization`
+// wouldn't update any of its arguments or results, i.e., the specialization
+// already captures the signature of the call site.
+bool isCapturedBy(CallOp callOp, FuncOp specialization,
+                  const SymbolTable& symbolTable,
+                  const FactorPropagation& factorPropagation) {
+  for (auto [callSharding, funcSharding, type] : llvm::zip_equal(
+           getCallSignature(callOp), getFuncSignature(specialization),
+           llvm::concat<const Type>(specialization.getArgumentTypes(),
+                                    specialization.getResultTypes()))) {
+    if (propagateToTarget(callSharding, funcSharding, type, callOp,
+                          symbolTable, factorPropagation)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Adds to `funcOps` every function with a value in the same sharding group as
+// a value in one of `funcOps`, since propagating through the latter may update
+// the shardings of the former.
+void addFuncsInSameShardingGroups(llvm::DenseSet<FuncOp>& funcOps,
+                                  const ShardingGroupMap& shardingGroupMap) {
+  SmallVector<FuncOp> worklist(funcOps.begin(), funcOps.end());
+  while (!worklist.empty()) {
+    FuncOp funcOp = worklist.pop_back_val();
+    funcOp.walk([&](ShardingGroupOp shardingGroupOp) {
+      for (Value groupValue :
+           shardingGroupMap.getGroupMembers(shardingGroupOp.getInput())) {
+        auto groupFuncOp =
+            groupValue.getParentRegion()->getParentOfType<FuncOp>();
+        if (groupFuncOp && funcOps.insert(groupFuncOp).second) {
+          worklist.push_back(groupFuncOp);
+        }
+      }
+    });
+  }
+}
+
+}  // namespace
+
+InterproceduralPropagation::InterproceduralPropagation(ModuleOp moduleOp) {
+  // The functions with a value in each sharding group.
+  llvm::DenseMap<uint64_t, llvm::SmallDenseSet<FuncOp, 2>> groupIdToFuncs;
+  moduleOp.walk([&](ShardingGroupOp shardingGroupOp) {
+    nextGroupId = std::max(nextGroupId, shardingGroupOp.getGroupId() + 1);
+    groupIdToFuncs[shardingGroupOp.getGroupId()].insert(
+        shardingGroupOp->getParentOfType<FuncOp>());
+  });
+  // Returns true if `funcOp` has a sharding group that spans other functions,
+  // which the copies of `funcOp` would split.
+  auto hasEscapingShardingGroup = [&](FuncOp funcOp) {
+    return funcOp
+        .walk([&](ShardingGroupOp shardingGroupOp) {
+          return groupIdToFuncs[shardingGroupOp.getGroupId()].size() > 1
+                     ? WalkResult::interrupt()
+                     : WalkResult::advance();
+        })
+        .wasInterrupted();
+  };
+  SymbolTable symbolTable(moduleOp);
+  moduleOp.walk([&](CallOp callOp) {
+    StringAttr calleeName = callOp.getCalleeAttr().getAttr();
+    if (originalCallees.contains(calleeName)) {
+      return;
+    }
+    if (auto callee = symbolTable.lookup<FuncOp>(calleeName);
+        callee && !callee.isExternal() && !hasEscapingShardingGroup(callee)) {
+      originalCallees.try_emplace(calleeName, callee.clone());
+    }
+  });
+}
+
+FuncOp InterproceduralPropagation::getOrCreateSpecialization(
+    StringAttr origin, const CallSignature& signature, CallOp callOp,
+    SymbolTable& moduleSymbolTable,
+    const FactorPropagation& factorPropagation) {
+  SmallVector<FunctionSummary>& summaries = originToSummaries[origin];
+  for (const FunctionSummary& summary : summaries) {
+    if (summary.signature == signature) {
+      return summary.specialization;
+    }
+  }
+
+  // A private original callee that hasn't been specialized yet is still as it
+  // was before propagation, so we can specialize it in place and keep its name.
+  FuncOp specialization = moduleSymbolTable.lookup<FuncOp>(origin);
+  if (!specialization || !specialization.isPrivate() ||
+      specializationToOrigin.contains(origin)) {
+    specialization = originalCallees.find(origin)->second->clone();
+    specialization.setPrivate();
+    moduleSymbolTable.insert(specialization);
+    llvm::SmallDenseMap<uint64_t, uint64_t> oldToNewGroupId;
+    specialization.walk([&](ShardingGroupOp shardingGroupOp) {
+      auto [it, inserted] = oldToNewGroupId.try_emplace(
+          shardingGroupOp.getGroupId(), nextGroupId);
+      if (inserted) {
+        ++nextGroupId;
+      }
+      shardingGroupOp.setGroupId(it->second);
+    });
+  }
+
+  int64_t numArgs = specialization.getNumArguments();
+  for (auto [index, sharding] : llvm::enumerate(signature)) {
+    if (index < numArgs) {
+      BlockArgument arg = specialization.getArgument(index);
+      if (TensorShardingAttr newSharding = propagateToTarget(
+              sharding, getSharding(arg), arg.getType(), callOp,
+              moduleSymbolTable, factorPropagation)) {
+        setSharding(arg, newSharding);
+      }
+      continue;
+    }
+    int64_t resNum = index - numArgs;
+    if (TensorShardingAttr newSharding = propagateToTarget(
+            sharding, getFuncResultSharding(specialization, resNum),
+            specialization.getResultTypes()[resNum], callOp,
+            moduleSymbolTable, factorPropagation)) {
+      setFuncResultSharding(specialization, resNum, newSharding);
+    }
+  }
+
+  specializationToOrigin.try_emplace(specialization.getSymNameAttr(), origin);
+  summaries.push_back({signature, specialization});
+  return specialization;
+}
+
+bool InterproceduralPropagation::specializeCallSites(
+    ModuleOp moduleOp, SymbolTable& moduleSymbolTable,
+    const FactorPropagation& factorPropagation,
+    llvm::DenseSet<FuncOp>& dirtyFuncs) {
+  SmallVector<CallOp> callOps;
+  moduleOp.walk([&](CallOp callOp) { callOps.push_back(callOp); });
+
+  bool anySpecialized = false;
+  for (CallOp callOp : callOps) {
+    StringAttr calleeName = callOp.getCalleeAttr().getAttr();
+    StringAttr origin = calleeName;
+    if (auto it = specializationToOrigin.find(calleeName);
+        it != specializationToOrigin.end()) {
+      origin = it->second;
+      if (isCapturedBy(callOp, moduleSymbolTable.lookup<FuncOp>(calleeName),
+                       moduleSymbolTable, factorPropagation)) {
+        continue;
+      }
+    } else if (!originalCallees.contains(origin)) {
+      // External callee, or one with a sharding group spanning other
+      // functions.
+      continue;
+    }
+    int64_t numSpecializations = originToSummaries[origin].size();
+    FuncOp specialization =
+        getOrCreateSpecialization(origin, getCallSignature(callOp), callOp,
+                                  moduleSymbolTable, factorPropagation);
+    if (originToSummaries[origin].size() != numSpecializations) {
+      dirtyFuncs.insert(specialization);
+      anySpecialized = true;
+    }
+    if (specialization.getSymNameAttr() != calleeName) {
+      callOp.setCalleeAttr(
+          FlatSymbolRefAttr::get(specialization.getSymNameAttr()));
+      anySpecialized = true;
+    }
+  }
+  return anySpecialized;
+}
+
+void InterproceduralPropagation::applySummaries(
+    ModuleOp moduleOp, const SymbolTable& symbolTable,
+    const ShardingGroupMap& shardingGroupMap,
+    const FactorPropagation& factorPropagation,
+    llvm::DenseSet<FuncOp>& dirtyFuncs) {
+  auto updateSharding = [&](Value value, TensorShardingAttr sourceSharding,
+                            CallOp callOp) {
+    Value shardableValue = getShardableValue(value);
+    TensorShardingAttr newSharding = propagateToTarget(
+        sourceSharding, getSharding(shardableValue), value.getType(), callOp,
+        symbolTable, factorPropagation);
+    if (!newSharding) {
+      return;
+    }
+    setSharding(shardableValue, newSharding);
+    for (Value groupValue : shardingGroupMap.getGroupMembers(shardableValue)) {
+      if (groupValue != shardableValue) {
+        setSharding(groupValue, newSharding);
+      }
+    }
+    dirtyFuncs.insert(callOp->getParentOfType<FuncOp>());
+  };
+
+  moduleOp.walk([&](CallOp callOp) {
+    StringAttr calleeName = callOp.getCalleeAttr().getAttr();
+    if (!specializationToOrigin.contains(calleeName)) {
+      return;
+    }
+    auto specialization = symbolTable.lookup<FuncOp>(calleeName);
+    for (auto [operand, arg] :
+         llvm::zip_equal(callOp.getOperands(), specialization.getArguments())) {
+      updateSharding(operand, getSharding(arg), callOp);
+    }
+    for (auto [resNum, result] : llvm::enumerate(callOp.getResults())) {
+      updateSharding(result, getFuncResultSharding(specialization, resNum),
+                     callOp);
+    }
+  });
+}
+
+LogicalResult InterproceduralPropagation::propagate(
+    ModuleOp moduleOp, const FactorPropagation& factorPropagation,
+    PropagateWithinFunctionsFn propagateWithinFunctions) {
+  // Specializations are added to the module during propagation, so we keep our
+  // own symbol table and sharding group map.
+  SymbolTable moduleSymbolTable(moduleOp);
+  ShardingGroupMap shardingGroupMap(moduleOp);
+  // The functions that need to be propagated through in the next iteration.
+  llvm::DenseSet<FuncOp> dirtyFuncs;
+  for (int64_t iteration = 0; iteration < kMaxIterations; ++iteration) {
+    int64_t numSpecializations = specializationToOrigin.size();
+    bool anySpecialized = specializeCallSites(
+        moduleOp, moduleSymbolTable, factorPropagation, dirtyFuncs);
+    if (static_cast<int64_t>(specializationToOrigin.size()) !=
+        numSpecializations) {
+      shardingGroupMap = ShardingGroupMap(moduleOp);
+    }
+    if (iteration == 0) {
+      // We always propagate through all functions once.
+      if (failed(propagateWithinFunctions(moduleSymbolTable, shardingGroupMap,
+                                          /*funcOps=*/std::nullopt))) {
+        return failure();
+      }
+    } else {
+      // After that, we only propagate through the functions that may have
+      // changed, and stop once no call site was re-specialized and no caller
+      // was updated by a summary.
+      if (!anySpecialized && dirtyFuncs.empty()) {
+        return success();
+      }
+      addFuncsInSameShardingGroups(dirtyFuncs, shardingGroupMap);
+      SmallVector<FuncOp> funcOps = llvm::to_vector(llvm::make_filter_range(
+          moduleOp.getOps<FuncOp>(),
+          [&](FuncOp funcOp) { return dirtyFuncs.contains(funcOp); }));
+      if (!funcOps.empty() &&
+          failed(propagateWithinFunctions(moduleSymbolTable, shardingGroupMap,
+                                          funcOps))) {
+        return failure();
+      }
+    }
+    dirtyFuncs.clear();
+    applySummaries(moduleOp, moduleSymbolTable, shardingGroupMap,
+                   factorPropagation, dirtyFuncs);
+  }
+  moduleOp->emitError(
+      "Interprocedural propagation failed to converge after ")
+      << kMaxIterations << " iterations.";
+  return failure();
+}
+
+void InterproceduralPropagation::eraseUnusedSpecializations(ModuleOp moduleOp) {
+  SymbolTable moduleSymbolTable(moduleOp);
+  // Erasing a specialization may remove the last call site of another, so we
+  // repeat until no specialization is erased.
+  bool anyErased = true;
+  while (anyErased) {
+    anyErased = false;
+    for (auto& [origin, summaries] : originToSummaries) {
+      llvm::erase_if(summaries, [&](const FunctionSummary& summary) {
+        FuncOp specialization = summary.specialization;
+        if (!specialization.isPrivate() ||
+            !SymbolTable::symbolKnownUseEmpty(specialization, moduleOp)) {
+          return false;
+        }
+        moduleSymbolTable.erase(specialization);
+        anyErased = true;
+        return true;
+      });
+    }
+  }
+
+  // If the original callee was erased and there is a single specialization
+  // left, it takes the name of the original callee.
+  for (auto& [origin, summaries] : originToSummaries) {
+    if (summaries.size() == 1 && !moduleSymbolTable.lookup(origin)) {
+      (void)moduleSymbolTable.rename(summaries.front().specialization, origin);
+    }
+  }
+  originToSummaries.clear();
+  specializationToOrigin.clear();
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,150 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INTERPROCEDURAL_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INTERPROCEDURAL_PROPAGATION_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+
+namespace mlir {
+namespace sdy {
+
+// The shardings of the operands followed by the results of a `func.call`, or
+// of the arguments followed by the results of a function. A null sharding
+// means the tensor isn't sharded (yet).
+using CallSignature = SmallVector<TensorShardingAttr>;
+
+// Propagates shardings across `func.call` ops without inlining the callees.
+//
+// Each callee is specialized once per distinct call signature: the first call
+// site with a new signature gets a copy of the callee (as it was before
+// propagation), whose arguments and results are annotated with the shardings
+// of the call site. Call sites with the same signature share the same
+// specialization, so the module grows with the number of distinct signatures
+// rather than the number of call sites.
+//
+// After propagating through all functions, the shardings of each
+// specialization (its summary) are applied back to the operands and results of
+// its call sites. If this changes the signature of a call site in a way that
+// isn't captured by its specialization, e.g., the caller propagated a new
+// sharding into a call operand, the call site is re-specialized. This repeats
+// until no call site changes, where each repetition only propagates through the
+// new specializations and the callers updated by a summary (and the functions
+// sharing a sharding group with them).
+//
+// The sharding groups in the body of a copy of a callee get new ids, so that
+// they only constrain the values of that specialization. A callee with a
+// sharding group that spans other functions isn't specialized, and shardings
+// aren't propagated across its call sites, since its copies would split the
+// group.
+//
+// For example, a layer function that is called 100 times with two distinct
+// shardings results in two specializations of the layer function, and each is
+// propagated through once per iteration, instead of 100 inlined copies.
+class InterproceduralPropagation {
+ public:
+  // The maximum number of rounds of specializing call sites, propagating
+  // within functions, and applying summaries.
+  static constexpr int64_t kMaxIterations = 100;
+
+  // Keeps a copy of every function in `moduleOp` that is called by a
+  // `func.call`, as it was before propagation, to specialize from, unless it
+  // has a sharding group that spans other functions.
+  explicit InterproceduralPropagation(ModuleOp moduleOp);
+
+  // Propagates through the body of every function in `funcOps`, or in the
+  // module if not set (including their results), w.r.t. a symbol table and
+  // sharding groups that include all specializations created so far.
+  using PropagateWithinFunctionsFn = llvm::function_ref<LogicalResult(
+      const SymbolTable& symbolTable, const ShardingGroupMap& shardingGroupMap,
+      std::optional<ArrayRef<func::FuncOp>> funcOps)>;
+
+  // Propagates shardings across all call sites in `moduleOp`, where
+  // `propagateWithinFunctions` propagates through the functions, e.g., see
+  // `BasicPropagationPassImpl::propagate`.
+  LogicalResult propagate(ModuleOp moduleOp,
+                          const FactorPropagation& factorPropagation,
+                          PropagateWithinFunctionsFn propagateWithinFunctions);
+
+  // Erases all private specializations (and original callees) that no longer
+  // have any call sites. A single remaining specialization of an erased
+  // original callee is renamed to the name of the original callee.
+  void eraseUnusedSpecializations(ModuleOp moduleOp);
+
+ private:
+  // A specialization of a callee for the call sites whose signature was
+  // `signature` before propagating through the specialization.
+  struct FunctionSummary {
+    CallSignature signature;
+    func::FuncOp specialization;
+  };
+
+  // Makes every call site in `moduleOp` call a specialization of its original
+  // callee for its current signature, creating new specializations if needed.
+  //
+  // Returns true if any specialization was created or any call site now calls
+  // a different specialization, and adds the created specializations to
+  // `dirtyFuncs`.
+  bool specializeCallSites(ModuleOp moduleOp, SymbolTable& moduleSymbolTable,
+                           const FactorPropagation& factorPropagation,
+                           llvm::DenseSet<func::FuncOp>& dirtyFuncs);
+
+  // Returns the specialization of `origin` for `signature`, creating it if it
+  // doesn't exist yet.
+  func::FuncOp getOrCreateSpecialization(
+      StringAttr origin, const CallSignature& signature,
+      func::CallOp callOp, SymbolTable& moduleSymbolTable,
+      const FactorPropagation& factorPropagation);
+
+  // Applies the summary of each specialization, i.e. the shardings of its
+  // arguments and results, to its call sites.
+  //
+  // Adds every function with a call site whose operand or result sharding was
+  // updated to `dirtyFuncs`.
+  void applySummaries(ModuleOp moduleOp, const SymbolTable& symbolTable,
+                      const ShardingGroupMap& shardingGroupMap,
+                      const FactorPropagation& factorPropagation,
+                      llvm::DenseSet<func::FuncOp>& dirtyFuncs);
+
+  // The functions called by a `func.call` as they were before propagation.
+  llvm::DenseMap<StringAttr, OwningOpRef<func::FuncOp>> originalCallees;
+  // The name of the original callee of each specialization.
+  llvm::DenseMap<StringAttr, StringAttr> specializationToOrigin;
+  // The specializations of each original callee.
+  llvm::DenseMap<StringAttr, SmallVector<FunctionSummary>> originToSummaries;
+  // The id of the next sharding group created for a specialization.
+  uint64_t nextGroupId = 0;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_INTERPROCEDURAL_PROPAGATION_H_
@@ -0,0 +1,194 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/memory_budget_factor_propagation.h"
+
+#include <cstdint>
+#include <tuple>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+// Returns true if the tensor at `tensorIndex` can be updated along a factor
+// that is propagated in the given `direction`.
+bool canUpdateTensor(int64_t tensorIndex, const ShardingProjection& projection,
+                     PropagationDirection direction) {
+  switch (direction) {
+    case PropagationDirection::BOTH:
+      return true;
+    case PropagationDirection::FORWARD:
+      return tensorIndex >= projection.getNumOperands();
+    case PropagationDirection::BACKWARD:
+      return tensorIndex < projection.getNumOperands();
+    case PropagationDirection::NONE:
+      return false;
+  }
+}
+
+// Returns the sharded size of `axes`.
+int64_t getShardedSize(ArrayRef<AxisRefAttr> axes, MeshAttr mesh) {
+  int64_t shardedSize = 1;
+  for (AxisRefAttr axis : axes) {
+    shardedSize *= axis.getSize(mesh);
+  }
+  return shardedSize;
+}
+
+}  // namespace
+
+UpdateTensorShardings MemoryBudgetFactorPropagation::propagateFactorShardings(
+    ShardingProjection& projection,
+    PropagationDirectionAlongFactor directionAlongFactor,
+    ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+    bool conservativePropagation) const {
+  UpdateTensorShardings result =
+      AggressiveFactorPropagation::propagateFactorShardings(
+          projection, directionAlongFactor, factorSizes, mesh, op,
+          conservativePropagation);
+  if (perDeviceMemoryBudget <= 0 || !mesh) {
+    return result;
+  }
+
+  int64_t numTensors = projection.getNumTensors();
+  SmallVector<int64_t> elementBitWidths = getTensorElementBitWidths(
+      op, projection.getNumOperands(), projection.getNumResults());
+  auto getTensorLocalSize = [&](int64_t tensorIndex) {
+    return getLocalSizeInBytes(projection.getTensor(tensorIndex), factorSizes,
+                               elementBitWidths[tensorIndex], mesh);
+  };
+
+  // We handle the largest tensors first, breaking ties by the tensor index.
+  SmallVector<int64_t> localSizes =
+      llvm::map_to_vector(llvm::seq<int64_t>(0, numTensors), getTensorLocalSize);
+  SmallVector<int64_t> sortedTensorIndices =
+      llvm::to_vector(llvm::seq<int64_t>(0, numTensors));
+  llvm::sort(sortedTensorIndices, [&](int64_t i, int64_t j) {
+    return std::make_tuple(-localSizes[i], i) <
+           std::make_tuple(-localSizes[j], j);
+  });
+
+  for (int64_t tensorIndex : sortedTensorIndices) {
+    if (localSizes[tensorIndex] <= perDeviceMemoryBudget) {
+      // All remaining tensors are within the budget.
+      break;
+    }
+    const TensorFactorShardings& tensor = projection.getTensor(tensorIndex);
+    const FactorIndexToSharding& factorIndexToSharding =
+        tensor.factorIndexToSharding;
+
+    // We try to expand larger factors first, breaking ties by the factor index.
+    SmallVector<int64_t> factorIndices = llvm::to_vector(
+        llvm::make_first_range(factorIndexToSharding));
+    llvm::sort(factorIndices, [&](int64_t i, int64_t j) {
+      return std::make_tuple(-factorSizes[i], i) <
+             std::make_tuple(-factorSizes[j], j);
+    });
+
+    bool tensorUpdated = false;
+    for (int64_t factorIndex : factorIndices) {
+      if (getTensorLocalSize(tensorIndex) <= perDeviceMemoryBudget) {
+        break;
+      }
+      PropagationDirection direction = directionAlongFactor(factorIndex);
+      if (!canUpdateTensor(tensorIndex, projection, direction)) {
+        continue;
+      }
+      const FactorSharding& factorSharding =
+          factorIndexToSharding.find(factorIndex)->second;
+      if (factorSharding.isClosed || !factorSharding.overflowAxes.empty()) {
+        continue;
+      }
+
+      // Take the axes of the tensor that would shard this factor the most,
+      // ignoring conflicts with any other tensor.
+      SmallVector<AxisRefAttr> newAxes;
+      int64_t newShardedSize = 0;
+      for (int64_t otherIndex : llvm::seq<int64_t>(0, numTensors)) {
+        if (otherIndex == tensorIndex ||
+            (direction != PropagationDirection::BOTH &&
+             canUpdateTensor(otherIndex, projection, direction))) {
+          // With a single direction, only tensors that can't be updated are
+          // sources of the propagation.
+          continue;
+        }
+        const FactorIndexToSharding& otherFactorIndexToSharding =
+            projection.getTensor(otherIndex).factorIndexToSharding;
+        auto otherShardingIt = otherFactorIndexToSharding.find(factorIndex);
+        if (otherShardingIt == otherFactorIndexToSharding.end()) {
+          continue;
+        }
+        ArrayRef<AxisRefAttr> otherAxes = otherShardingIt->second.axisRefs;
+        if (!isStrictPrefix(factorSharding.axisRefs, otherAxes)) {
+          continue;
+        }
+        if (int64_t shardedSize = getShardedSize(otherAxes, mesh);
+            shardedSize > newShardedSize) {
+          newAxes = llvm::to_vector(otherAxes);
+          newShardedSize = shardedSize;
+        }
+      }
+      if (newAxes.empty()) {
+        continue;
+      }
+
+      // Resolve conflicts within the factor and across factors of this tensor.
+      truncateAxesByRemovingConflicts(
+          newAxes,
+          [&](AxisRefAttr axisRef, int64_t prevShardedSize) {
+            return compatiblePrefixNoConflictsWithinFactor(
+                axisRef, tensor.replicatedAxes, factorSharding,
+                prevShardedSize, factorSizes[factorIndex], mesh);
+          },
+          mesh, conservativePropagation);
+      truncateAxesByRemovingConflicts(
+          newAxes,
+          [&](AxisRefAttr axisRef, int64_t) {
+            return compatiblePrefixNoConflictsAcrossFactors(
+                axisRef, factorIndexToSharding, factorIndex);
+          },
+          mesh, conservativePropagation);
+      tensorUpdated |=
+          projection.expandTensorSharding(tensorIndex, factorIndex, newAxes);
+    }
+
+    if (!tensorUpdated) {
+      continue;
+    }
+    if (tensorIndex < projection.getNumOperands()) {
+      result.updateOperands.set(tensorIndex);
+    } else {
+      result.updateResults.set(tensorIndex - projection.getNumOperands());
+    }
+  }
+
+  return result;
+}
+
+}  // namespace sdy
+}  // namespace mlir
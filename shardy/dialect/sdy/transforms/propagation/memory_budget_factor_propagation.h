@@ -0,0 +1,78 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_BUDGET_FACTOR_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_BUDGET_FACTOR_PROPAGATION_H_
+
+#include <cstdint>
+
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/aggressive_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+// A strategy that extends `AggressiveFactorPropagation` by taking a per-device
+// memory budget into account.
+//
+// After propagating with the aggressive strategy, each tensor whose local size
+// (w.r.t. its element type and factor shardings) exceeds the budget is further
+// sharded along its open factors, starting from the largest tensor.
+//
+// This is more aggressive than `getCompatibleMajorShardingAxes`, since a factor
+// of an over-budget tensor can take the sharding axes of any other tensor
+// along that factor (in the allowed direction), as long as the existing axes
+// are a strict prefix of them, even if the factor sharding of a third tensor is
+// conflicting. The expanded axes must still not conflict with the replicated
+// axes or other factors of the over-budget tensor itself.
+//
+// For example, given C = add(A, B), where all tensors are too large for the
+// budget if sharded along a single axis.
+//
+//     F0
+// A  "a", "b"
+// B  "a", "c"
+// C  "a"
+//
+// The aggressive strategy propagates nothing since ["a", "b"] and ["a", "c"]
+// are conflicting, while this strategy propagates ["a", "b"] to C, since A is
+// the first tensor that C can take the sharding from.
+class MemoryBudgetFactorPropagation : public AggressiveFactorPropagation {
+ public:
+  // The `perDeviceMemoryBudget` is in bytes, and a non-positive value disables
+  // the budget, i.e., this strategy is equivalent to the aggressive one.
+  explicit MemoryBudgetFactorPropagation(int64_t perDeviceMemoryBudget)
+      : perDeviceMemoryBudget(perDeviceMemoryBudget) {}
+
+  UpdateTensorShardings propagateFactorShardings(
+      ShardingProjection& projection,
+      PropagationDirectionAlongFactor directionAlongFactor,
+      ArrayRef<int64_t> factorSizes, MeshAttr mesh, Operation* op,
+      bool conservativePropagation) const override;
+
+  int64_t getPerDeviceMemoryBudget() const { return perDeviceMemoryBudget; }
+
+ private:
+  int64_t perDeviceMemoryBudget;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_BUDGET_FACTOR_PROPAGATION_H_
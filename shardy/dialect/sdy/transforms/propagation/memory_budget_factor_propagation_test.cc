@@ -0,0 +1,162 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/memory_budget_factor_propagation.h"
+
+#include <cstdint>
+
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/utils.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+PropagationDirectionAlongFactor propagateAnything() {
+  return [](int64_t) { return PropagationDirection::BOTH; };
+}
+
+class MemoryBudgetFactorPropagationTest : public PropagationTestBase {
+ protected:
+  MeshAttr createMesh() {
+    return MeshAttr::get(&context, {MeshAxisAttr::get(&context, "a", 2),
+                                    MeshAxisAttr::get(&context, "b", 2),
+                                    MeshAxisAttr::get(&context, "c", 2)});
+  }
+
+  // Since `op` is null, all tensors are assumed to have 32-bit elements.
+  UpdateTensorShardings propagateFactorShardings(
+      ShardingProjection& projection, int64_t perDeviceMemoryBudget,
+      ArrayRef<int64_t> factorSizes,
+      PropagationDirectionAlongFactor directionAlongFactor =
+          propagateAnything()) {
+    return MemoryBudgetFactorPropagation(perDeviceMemoryBudget)
+        .propagateFactorShardings(projection, directionAlongFactor,
+                                  factorSizes, createMesh(), /*op=*/nullptr,
+                                  /*conservativePropagation=*/false);
+  }
+
+  // Returns the projection of C = add(A, B) with a single factor, where the
+  // factor sharding of A and B are conflicting.
+  ShardingProjection createAddProjection(bool isResultClosed = false) {
+    return ShardingProjection(
+        /*operands=*/
+        {
+            {.factorIndexToSharding =
+                 {{0, {.axisRefs = {createAxis("a"), createAxis("b")}}}}},
+            {.factorIndexToSharding =
+                 {{0, {.axisRefs = {createAxis("a"), createAxis("c")}}}}},
+        },
+        /*results=*/{
+            {.factorIndexToSharding = {{0,
+                                        {.axisRefs = {createAxis("a")},
+                                         .isClosed = isResultClosed}}}},
+        });
+  }
+};
+
+TEST_F(MemoryBudgetFactorPropagationTest, OverBudgetTensorTakesConflicting) {
+  ShardingProjection projection = createAddProjection();
+  ShardingProjection projectionExpected(
+      /*operands=*/{projection.getOperand(0), projection.getOperand(1)},
+      /*results=*/{
+          {.factorIndexToSharding =
+               {{0, {.axisRefs = {createAxis("a"), createAxis("b")}}}}},
+      });
+
+  // The local size of the result is 8 / 2 * 4 = 16 bytes, which exceeds the
+  // budget, while the local size of both operands is 8 / 4 * 4 = 8 bytes. The
+  // result takes the sharding of the first operand, since both operands have
+  // the same sharded size along the factor.
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, /*perDeviceMemoryBudget=*/8, /*factorSizes=*/{8});
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), ElementsAre(0));
+  EXPECT_EQ(projection, projectionExpected);
+}
+
+TEST_F(MemoryBudgetFactorPropagationTest, WithinBudget) {
+  ShardingProjection projection = createAddProjection();
+  ShardingProjection projectionExpected = createAddProjection();
+
+  // All tensors are within the budget, so this is equivalent to the aggressive
+  // strategy, which doesn't propagate along the conflicting factor.
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, /*perDeviceMemoryBudget=*/16, /*factorSizes=*/{8});
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), IsEmpty());
+  EXPECT_EQ(projection, projectionExpected);
+}
+
+TEST_F(MemoryBudgetFactorPropagationTest, ZeroBudgetDisablesBudget) {
+  ShardingProjection projection = createAddProjection();
+  ShardingProjection projectionExpected = createAddProjection();
+
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, /*perDeviceMemoryBudget=*/0, /*factorSizes=*/{8});
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), IsEmpty());
+  EXPECT_EQ(projection, projectionExpected);
+}
+
+TEST_F(MemoryBudgetFactorPropagationTest, ClosedFactorNotExpanded) {
+  ShardingProjection projection =
+      createAddProjection(/*isResultClosed=*/true);
+  ShardingProjection projectionExpected =
+      createAddProjection(/*isResultClosed=*/true);
+
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, /*perDeviceMemoryBudget=*/8, /*factorSizes=*/{8});
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), IsEmpty());
+  EXPECT_EQ(projection, projectionExpected);
+}
+
+TEST_F(MemoryBudgetFactorPropagationTest, ForwardOnlyDoesNotUpdateOperands) {
+  ShardingProjection projection(
+      /*operands=*/
+      {
+          {.factorIndexToSharding = {{0, {.axisRefs = {createAxis("a")}}}}},
+      },
+      /*results=*/{
+          {.factorIndexToSharding =
+               {{0, {.axisRefs = {createAxis("a"), createAxis("b")}}}}},
+      });
+  ShardingProjection projectionExpected(
+      /*operands=*/{projection.getOperand(0)},
+      /*results=*/{projection.getResult(0)});
+
+  // The operand is over budget, but can only be a source of propagation.
+  auto [updateOperands, updateResults] = propagateFactorShardings(
+      projection, /*perDeviceMemoryBudget=*/8, /*factorSizes=*/{8},
+      [](int64_t) { return PropagationDirection::FORWARD; });
+  EXPECT_THAT(toSetBitsVector(updateOperands), IsEmpty());
+  EXPECT_THAT(toSetBitsVector(updateResults), IsEmpty());
+  EXPECT_EQ(projection, projectionExpected);
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,292 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Region.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Types.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+using func::FuncOp;
+
+namespace {
+
+// Returns true if `value` is a block argument of a `ManualComputationOp`,
+// whose type is already local w.r.t. the manual axes of its sharding.
+bool isManualComputationBlockArg(Value value) {
+  auto blockArg = dyn_cast<BlockArgument>(value);
+  return blockArg &&
+         isa<ManualComputationOp>(blockArg.getOwner()->getParentOp());
+}
+
+// Assigns increasing indices to all ops nested in a function in pre-order,
+// starting from 1 (0 stands for the function entry). An op with regions is
+// assigned an additional index after all of its nested ops, which stands for
+// the point at which its results become available.
+class OpNumbering {
+ public:
+  explicit OpNumbering(FuncOp funcOp) {
+    ops.push_back(nullptr);
+    for (Operation& op : funcOp.getBody().getOps()) {
+      number(&op);
+    }
+  }
+
+  // Returns the first index assigned to `op`.
+  int64_t getFirstIndex(Operation* op) const {
+    return opToFirstIndex.lookup(op);
+  }
+
+  // Returns the largest index assigned to `op`, i.e., the index at which `op`
+  // and all of its nested ops have been executed.
+  int64_t getLastIndex(Operation* op) const { return opToLastIndex.lookup(op); }
+
+  // Returns the op at the given `index`.
+  Operation* getOp(int64_t index) const { return ops[index]; }
+
+  int64_t getNumIndices() const { return ops.size() - 1; }
+
+ private:
+  void number(Operation* op) {
+    opToFirstIndex[op] = ops.size();
+    ops.push_back(op);
+    for (Region& region : op->getRegions()) {
+      for (Operation& nestedOp : region.getOps()) {
+        number(&nestedOp);
+      }
+    }
+    if (op->getNumRegions() > 0) {
+      ops.push_back(op);
+    }
+    opToLastIndex[op] = ops.size() - 1;
+  }
+
+  SmallVector<Operation*> ops;
+  llvm::DenseMap<Operation*, int64_t> opToFirstIndex;
+  llvm::DenseMap<Operation*, int64_t> opToLastIndex;
+};
+
+// The interval of op indices (inclusive) in which a value is live.
+struct LiveRange {
+  LiveValueInfo info;
+  int64_t start;
+  int64_t end;
+};
+
+// Returns the index of the last op that uses `value`, where a use in a nested
+// region extends the live range until the end of its ancestor in the block
+// that defines `value`.
+int64_t getLastUseIndex(Value value, int64_t start,
+                        const OpNumbering& numbering) {
+  int64_t end = start;
+  Block* definingBlock = value.getParentBlock();
+  for (Operation* user : value.getUsers()) {
+    if (Operation* ancestor = definingBlock->findAncestorOpInBlock(*user)) {
+      end = std::max(end, numbering.getLastIndex(ancestor));
+    }
+  }
+  return end;
+}
+
+}  // namespace
+
+int64_t getElementTypeBitWidth(Type elementType) {
+  if (auto complexType = dyn_cast<ComplexType>(elementType)) {
+    return 2 * getElementTypeBitWidth(complexType.getElementType());
+  }
+  if (elementType.isIntOrFloat()) {
+    return elementType.getIntOrFloatBitWidth();
+  }
+  if (elementType.isIndex()) {
+    return IndexType::kInternalStorageBitWidth;
+  }
+  return 0;
+}
+
+SmallVector<int64_t> getTensorElementBitWidths(Operation* op,
+                                               int64_t numOperands,
+                                               int64_t numResults) {
+  auto getBitWidth = [](Type type) -> int64_t {
+    if (auto shapedType = dyn_cast<ShapedType>(type)) {
+      if (int64_t bitWidth = getElementTypeBitWidth(shapedType.getElementType());
+          bitWidth > 0) {
+        return bitWidth;
+      }
+    }
+    return kDefaultElementBitWidth;
+  };
+
+  SmallVector<int64_t> bitWidths;
+  bitWidths.reserve(numOperands + numResults);
+  if (op && op->getNumOperands() == numOperands &&
+      op->getNumResults() == numResults) {
+    for (Type type : op->getOperandTypes()) {
+      bitWidths.push_back(getBitWidth(type));
+    }
+    for (Type type : op->getResultTypes()) {
+      bitWidths.push_back(getBitWidth(type));
+    }
+    return bitWidths;
+  }
+
+  int64_t commonBitWidth = kDefaultElementBitWidth;
+  if (op && op->getNumResults() > 0) {
+    commonBitWidth = getBitWidth(op->getResult(0).getType());
+  } else if (op && op->getNumOperands() > 0) {
+    commonBitWidth = getBitWidth(op->getOperand(0).getType());
+  }
+  bitWidths.assign(numOperands + numResults, commonBitWidth);
+  return bitWidths;
+}
+
+int64_t getLocalSizeInBytes(Value value, TensorShardingAttr sharding,
+                            const SymbolTable& symbolTable) {
+  auto tensorType = dyn_cast<RankedTensorType>(value.getType());
+  if (!tensorType || !tensorType.hasStaticShape()) {
+    return 0;
+  }
+  if (sharding && !isManualComputationBlockArg(value)) {
+    if (MeshAttr mesh = sharding.getMesh(symbolTable)) {
+      tensorType = sharding.getLocalTensorType(tensorType, mesh);
+    }
+  }
+  return llvm::divideCeil(
+      tensorType.getNumElements() *
+          getElementTypeBitWidth(tensorType.getElementType()),
+      8);
+}
+
+int64_t getLocalSizeInBytes(const TensorFactorShardings& tensor,
+                            ArrayRef<int64_t> factorSizes,
+                            int64_t elementBitWidth, MeshAttr mesh) {
+  int64_t numElements = 1;
+  for (const auto& [factorIndex, _] : tensor.factorIndexToSharding) {
+    numElements *= factorSizes[factorIndex];
+  }
+  int64_t localNumElements =
+      llvm::divideCeil(numElements, tensor.getShardingSize(mesh));
+  return llvm::divideCeil(localNumElements * elementBitWidth, 8);
+}
+
+PeakMemoryEstimate estimatePeakMemory(FuncOp funcOp,
+                                      const SymbolTable& symbolTable,
+                                      int64_t topN,
+                                      const GetShardingFn& getShardingFn) {
+  OpNumbering numbering(funcOp);
+  int64_t funcEnd = numbering.getNumIndices() + 1;
+
+  SmallVector<LiveRange> liveRanges;
+  auto addLiveRange = [&](Value value, int64_t start, int64_t end) {
+    TensorShardingAttr sharding = getShardingFn(value);
+    if (int64_t size = getLocalSizeInBytes(value, sharding, symbolTable);
+        size > 0) {
+      liveRanges.push_back({{value, sharding, size}, start, end});
+    }
+  };
+
+  for (BlockArgument arg : funcOp.getArguments()) {
+    addLiveRange(arg, 0, funcEnd);
+  }
+  for (int64_t index = 1; index <= numbering.getNumIndices(); ++index) {
+    Operation* op = numbering.getOp(index);
+    if (numbering.getFirstIndex(op) != index) {
+      continue;
+    }
+    for (Region& region : op->getRegions()) {
+      for (Block& block : region) {
+        // Block arguments become live when the block starts executing.
+        int64_t blockStart = index;
+        if (!block.empty()) {
+          blockStart = numbering.getFirstIndex(&block.front());
+        }
+        for (BlockArgument arg : block.getArguments()) {
+          addLiveRange(arg, blockStart,
+                       getLastUseIndex(arg, blockStart, numbering));
+        }
+      }
+    }
+    // Results of an op with regions are only available once all of its
+    // nested ops have been executed.
+    int64_t resultStart = numbering.getLastIndex(op);
+    for (Value result : op->getResults()) {
+      addLiveRange(result, resultStart,
+                   getLastUseIndex(result, resultStart, numbering));
+    }
+  }
+
+  // Sweep over the op indices, keeping track of the total size of the live
+  // values at each index.
+  SmallVector<int64_t> sizeDelta(funcEnd + 2, 0);
+  for (const LiveRange& liveRange : liveRanges) {
+    sizeDelta[liveRange.start] += liveRange.info.localSizeInBytes;
+    sizeDelta[liveRange.end + 1] -= liveRange.info.localSizeInBytes;
+  }
+  PeakMemoryEstimate estimate;
+  int64_t peakIndex = 0;
+  int64_t liveSize = 0;
+  for (int64_t index = 0; index <= funcEnd; ++index) {
+    liveSize += sizeDelta[index];
+    if (liveSize > estimate.peakSizeInBytes) {
+      estimate.peakSizeInBytes = liveSize;
+      peakIndex = index;
+    }
+  }
+  if (peakIndex > 0 && peakIndex <= numbering.getNumIndices()) {
+    estimate.peakOp = numbering.getOp(peakIndex);
+  }
+
+  for (const LiveRange& liveRange : liveRanges) {
+    if (liveRange.start <= peakIndex && peakIndex <= liveRange.end) {
+      estimate.topContributors.push_back(liveRange.info);
+    }
+  }
+  llvm::stable_sort(estimate.topContributors,
+                    [](const LiveValueInfo& a, const LiveValueInfo& b) {
+                      return a.localSizeInBytes > b.localSizeInBytes;
+                    });
+  if (static_cast<int64_t>(estimate.topContributors.size()) > topN) {
+    estimate.topContributors.truncate(topN);
+  }
+  return estimate;
+}
+
+PeakMemoryEstimate estimatePeakMemory(FuncOp funcOp,
+                                      const SymbolTable& symbolTable,
+                                      int64_t topN) {
+  return estimatePeakMemory(funcOp, symbolTable, topN,
+                            [](Value value) { return getSharding(value); });
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,118 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_ESTIMATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_ESTIMATION_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Types.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+// Returns the sharding of a value, which allows estimating memory w.r.t.
+// shardings that aren't (yet) stored in the IR.
+using GetShardingFn = std::function<TensorShardingAttr(Value)>;
+
+// A value that is live at the estimated peak, and its per-device size.
+struct LiveValueInfo {
+  Value value;
+  // The sharding of `value`, or null if it isn't sharded.
+  TensorShardingAttr sharding;
+  int64_t localSizeInBytes;
+};
+
+// The estimated peak per-device memory of a function.
+struct PeakMemoryEstimate {
+  int64_t peakSizeInBytes = 0;
+  // The op at which the peak is reached, or null if the peak is reached at the
+  // function entry (e.g., if the function has no ops besides the terminator).
+  Operation* peakOp = nullptr;
+  // The largest values that are live at the peak, sorted by decreasing size.
+  SmallVector<LiveValueInfo> topContributors;
+};
+
+// The element bit width assumed for tensors whose element type is unknown.
+inline constexpr int64_t kDefaultElementBitWidth = 32;
+
+// The default number of largest live values at the peak to report, shared by
+// `estimatePeakMemory` and the `sdy-estimate-peak-memory` pass.
+inline constexpr int64_t kDefaultPeakMemoryTopN = 5;
+
+// Returns the bit width of a single element of type `elementType`, or 0 if the
+// type has no known size (e.g. a token).
+int64_t getElementTypeBitWidth(Type elementType);
+
+// Returns the element bit width of each tensor that is propagated through by
+// `op`, where operands precede results.
+//
+// If `op` has exactly `numOperands` operands and `numResults` results, their
+// element types are used. Otherwise (e.g., the sources and targets of a data
+// flow edge), all tensors are assumed to have the element type of the first
+// result or operand of `op`. Falls back to `kDefaultElementBitWidth` if the
+// element type is unknown, e.g. if `op` is null.
+SmallVector<int64_t> getTensorElementBitWidths(Operation* op,
+                                               int64_t numOperands,
+                                               int64_t numResults);
+
+// Returns the per-device size in bytes of `value` w.r.t. `sharding`, or 0 if
+// `value` isn't a statically shaped tensor.
+//
+// If `sharding` is null, the full (replicated) size of `value` is returned.
+int64_t getLocalSizeInBytes(Value value, TensorShardingAttr sharding,
+                            const SymbolTable& symbolTable);
+
+// Returns the per-device size in bytes of a tensor with the given factor
+// shardings, whose elements are `elementBitWidth` bits wide, where the size of
+// each factor is given by `factorSizes`.
+int64_t getLocalSizeInBytes(const TensorFactorShardings& tensor,
+                            ArrayRef<int64_t> factorSizes,
+                            int64_t elementBitWidth, MeshAttr mesh);
+
+// Estimates the peak per-device memory of `funcOp` with a simple liveness walk
+// over its ops in program order, where the sharding of each value is given by
+// `getShardingFn`.
+//
+// A value is live from the op that defines it until the last op that uses it
+// (or its ancestor in the defining block, so values used inside a loop body
+// are live throughout the loop). Function arguments are live throughout the
+// function, since they are owned by the caller.
+//
+// The returned estimate holds at most `topN` of the largest values that are
+// live at the peak.
+PeakMemoryEstimate estimatePeakMemory(func::FuncOp funcOp,
+                                      const SymbolTable& symbolTable,
+                                      int64_t topN,
+                                      const GetShardingFn& getShardingFn);
+
+// Same as above, but uses the shardings stored in the IR.
+PeakMemoryEstimate estimatePeakMemory(func::FuncOp funcOp,
+                                      const SymbolTable& symbolTable,
+                                      int64_t topN = kDefaultPeakMemoryTopN);
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_MEMORY_ESTIMATION_H_
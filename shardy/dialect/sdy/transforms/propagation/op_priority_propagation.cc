@@ -19,8 +19,8 @@ limitations under the License.
 #include <cassert>
 #include <cstdint>
 #include <memory>
-#include <numeric>
 
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/SymbolTable.h"
@@ -50,39 +50,72 @@ namespace {
 using GetDirectionToPropagateFnPtr = PropagationDirection (*)(Operation*,
                                                               int64_t);
 
-PropagationDirection isPassThrough(Operation* op, int64_t) {
-  if (isElementwise(op) ||
-      isa<stablehlo::ReshapeOp, stablehlo::TransposeOp, DataFlowEdgeOp>(op)) {
+// A direction policy is a type with a static `getDirection` method, which
+// determines in which direction propagation should happen for a given op and
+// factor index. Policies are composed at compile time (see `UnionOfPolicies`),
+// so that each op-priority stage is a single direct call.
+
+// Propagates in both directions through ops that pass shardings through as is
+// (e.g. elementwise), and forward through dynamic slices.
+struct PassThroughPolicy {
+  static PropagationDirection getDirection(Operation* op, int64_t) {
+    if (isElementwise(op) ||
+        isa<stablehlo::ReshapeOp, stablehlo::TransposeOp, DataFlowEdgeOp>(op)) {
+      return PropagationDirection::BOTH;
+    }
+    if (isa<stablehlo::DynamicSliceOp, stablehlo::DynamicUpdateSliceOp>(op)) {
+      return PropagationDirection::FORWARD;
+    }
+    return PropagationDirection::NONE;
+  }
+};
+
+// Propagates in both directions through any op.
+struct AnyDirectionPolicy {
+  static PropagationDirection getDirection(Operation*, int64_t) {
     return PropagationDirection::BOTH;
   }
-  if (isa<stablehlo::DynamicSliceOp, stablehlo::DynamicUpdateSliceOp>(op)) {
-    return PropagationDirection::FORWARD;
+};
+
+// The union of the directions of all `Policies`.
+template <class... Policies>
+struct UnionOfPolicies {
+  static PropagationDirection getDirection(Operation* op, int64_t factorIndex) {
+    PropagationDirection direction = PropagationDirection::NONE;
+    ((direction = unionOfPropagationDirections(
+          direction, Policies::getDirection(op, factorIndex))),
+     ...);
+    return direction;
   }
-  return PropagationDirection::NONE;
-}
+};
 
+// The direction policy of each op-priority stage. Each stage propagates in the
+// union of the directions of its own policy and those of all previous stages.
 constexpr std::array<GetDirectionToPropagateFnPtr, 2> opPropagationSchedule = {
-    isPassThrough, propagateAny};
+    &UnionOfPolicies<PassThroughPolicy>::getDirection,
+    &UnionOfPolicies<PassThroughPolicy, AnyDirectionPolicy>::getDirection};
 
 // Returns the direction in which the given operation should be propagated.
 //
 // This will also take into account any `getDirectionToPropagate` passed through
 // a caller. It will return the intersection of the passed in
-// `getDirectionToPropagate` and the op based direction.
+// `getDirectionToPropagate` and the op based direction, unless the former is
+// `propagateAny`, in which case the op based direction is returned as is.
 GetDirectionToPropagateFn getOpBasedDirectionToPropagate(
     int64_t currentPriority,
     GetDirectionToPropagateFn getDirectionToPropagate) {
-  return [currentPriority, getDirectionToPropagate](Operation* op,
-                                                    int64_t factorIndex) {
-    PropagationDirection opBasedDirection = std::accumulate(
-        opPropagationSchedule.begin(),
-        opPropagationSchedule.begin() + currentPriority + 1,
-        PropagationDirection::NONE,
-        [&](PropagationDirection acc, GetDirectionToPropagateFnPtr dirFn) {
-          return unionOfPropagationDirections(acc, dirFn(op, factorIndex));
-        });
+  GetDirectionToPropagateFnPtr opBasedDirection =
+      opPropagationSchedule[currentPriority];
+  if (auto* fnPtr = getDirectionToPropagate
+                        .target<GetDirectionToPropagateFnPtr>();
+      fnPtr && *fnPtr == propagateAny) {
+    return opBasedDirection;
+  }
+  return [opBasedDirection, getDirectionToPropagate](Operation* op,
+                                                     int64_t factorIndex) {
     return intersectionOfPropagationDirections(
-        opBasedDirection, getDirectionToPropagate(op, factorIndex));
+        opBasedDirection(op, factorIndex),
+        getDirectionToPropagate(op, factorIndex));
   };
 }
 
@@ -122,6 +155,11 @@ LogicalResult OpPriorityPropagationPassImpl::propagate(
   return success();
 }
 
+SmallVector<GetDirectionToPropagateFn> getOpPriorityStageDirections() {
+  return SmallVector<GetDirectionToPropagateFn>(opPropagationSchedule.begin(),
+                                                opPropagationSchedule.end());
+}
+
 std::unique_ptr<Pass> createOpPriorityPropagationPass(
     const PropagationOptions& options) {
   return std::make_unique<OpPriorityPropagationPass>(options);
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <memory>
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/CommandLine.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/SymbolTable.h"
@@ -57,6 +58,11 @@ class OpPriorityPropagationPassImpl : public AggressivePropagationPassImpl {
       llvm::cl::init(true)};
 };
 
+// Returns the direction to propagate in each op-priority stage, in the order
+// the stages are run by `OpPriorityPropagationPassImpl::propagate` when the
+// caller propagates in any direction.
+SmallVector<GetDirectionToPropagateFn> getOpPriorityStageDirections();
+
 // Runs op based sharding propagation (see `OpPriorityPropagationPass`).
 std::unique_ptr<Pass> createOpPriorityPropagationPass(
     const PropagationOptions& options);
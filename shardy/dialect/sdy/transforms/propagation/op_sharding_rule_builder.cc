@@ -129,6 +129,30 @@ OpShardingRuleAttr OpShardingRuleBuilder::buildPointwise(Operation* op) {
   // All results should have the same shape, so we look at the first.
   ArrayRef<int64_t> shape =
       cast<ShapedType>(op->getResultTypes().front()).getShape();
+  MLIRContext* context = op->getContext();
+
+  auto hasSameRank = [&](Type type) {
+    return cast<ShapedType>(type).getRank() ==
+           static_cast<int64_t>(shape.size());
+  };
+  if (llvm::all_of(op->getOperandTypes(), hasSameRank) &&
+      llvm::all_of(op->getResultTypes(), hasSameRank)) {
+    // All operands and results map dimension `i` to factor `i`, so they can
+    // share the same `TensorMappingAttr` instead of building a `TensorMapping`
+    // per tensor.
+    SmallVector<DimMappingAttr> dimMappings;
+    dimMappings.reserve(shape.size());
+    for (int64_t dim = 0; dim < static_cast<int64_t>(shape.size()); ++dim) {
+      dimMappings.push_back(DimMappingAttr::get(context, dim));
+    }
+    auto tensorMapping = TensorMappingAttr::get(context, dimMappings);
+    return OpShardingRuleAttr::get(
+        context, shape,
+        SmallVector<TensorMappingAttr>(op->getNumOperands(), tensorMapping),
+        SmallVector<TensorMappingAttr>(op->getNumResults(), tensorMapping),
+        /*reductionFactors=*/{}, /*needReplicationFactors=*/{},
+        /*permutationFactors=*/{});
+  }
 
   OpShardingRuleBuilder builder(op);
 
@@ -20,12 +20,20 @@ limitations under the License.
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/RWMutex.h"
 #include "llvm/Support/Threading.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -35,6 +43,7 @@ limitations under the License.
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Value.h"
 #include "mlir/Support/LLVM.h"
+#include "mlir/Support/TypeID.h"
 #include "shardy/dialect/sdy/ir/constants.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
 #include "shardy/dialect/sdy/ir/utils.h"
@@ -143,8 +152,444 @@ void addGatherScatterFactors(RankedTensorType inputType,
   }
 }
 
+OpShardingRuleAttr createPointwiseCustomCallRule(Operation* op, bool) {
+  return OpShardingRuleBuilder::buildPointwise(op);
+}
+
+OpShardingRuleAttr createEighRule(Operation* op, bool) {
+  auto customCall = cast<stablehlo::CustomCallOp>(op);
+  assert(customCall.getNumOperands() == 1 && customCall.getNumResults() == 2);
+  // See `jax.lax.linalg.eigh` for more information.
+  //
+  // All but the last two dimensions of the input are batch dimensions, but we
+  // can also propagate through the non-batch dimensions as they correspond
+  // between input and results, even though that would require communication.
+  // The 2nd result (eigenvalues) has a single non-batch dimension that
+  // corresponds to the last dimension of the input and 1st result
+  // (eigenvectors).
+  ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
+  int64_t nonBatchDim1 = inShape.size() - 2;
+  int64_t nonBatchDim2 = inShape.size() - 1;
+  return OpShardingRuleBuilder(customCall)
+      .addPointwise(inShape.drop_back(2))
+      .addFactor(nonBatchDim1, {nonBatchDim1, kNullDim}, inShape[nonBatchDim1])
+      .addFactor(nonBatchDim2, {nonBatchDim2, nonBatchDim1},
+                 inShape[nonBatchDim2])
+      .build();
+}
+
+OpShardingRuleAttr createQrRule(Operation* op, bool) {
+  auto customCall = cast<stablehlo::CustomCallOp>(op);
+  assert(customCall.getNumOperands() == 1 && customCall.getNumResults() == 2);
+  // See `jax.lax.linalg.qr` for more information.
+  //
+  // All but the last two dimensions of the input are batch dimensions, but we
+  // can also propagate through the non-batch dimensions as they correspond
+  // between input and 1st result, even though that would require
+  // communication. The 2nd result has a single non-batch dimension that has
+  // size equal to the minimum between the two non-batch dimensions of the
+  // input, but we wouldn't benefit from sharding it in the same way, given how
+  // QR decomposition is computed.
+  ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
+  int64_t nonBatchDim1 = inShape.size() - 2;
+  int64_t nonBatchDim2 = inShape.size() - 1;
+  return OpShardingRuleBuilder(customCall)
+      .addPointwise(inShape.drop_back(2))
+      .addFactor(nonBatchDim1, {nonBatchDim1, kNullDim}, inShape[nonBatchDim1])
+      .addFactor(nonBatchDim2, {nonBatchDim2, kNullDim}, inShape[nonBatchDim2])
+      .build();
+}
+
+OpShardingRuleAttr createHouseholderProductRule(Operation* op, bool) {
+  auto customCall = cast<stablehlo::CustomCallOp>(op);
+  // See `jax.lax.linalg.householder_product` for more information.
+  //
+  // All but the last two dimensions of the input are batch dimensions, but we
+  // can also propagate through the non-batch dimensions as they correspond
+  // between the 1st input and result, even though that would require
+  // communication. The 2nd input (taus) has a single non-batch dimension that
+  // doesn't correspond to any dimension in the other tensors.
+  ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
+  int64_t nonBatchDim1 = inShape.size() - 2;
+  int64_t nonBatchDim2 = inShape.size() - 1;
+  return OpShardingRuleBuilder(customCall)
+      .addPointwise(inShape.drop_back(2))
+      .addFactor({nonBatchDim1, kNullDim}, nonBatchDim1, inShape[nonBatchDim1])
+      .addFactor({nonBatchDim2, kNullDim}, nonBatchDim2, inShape[nonBatchDim2])
+      .build();
+}
+
+OpShardingRuleAttr createTopKRule(Operation* op, bool) {
+  auto customCall = cast<stablehlo::CustomCallOp>(op);
+  assert(customCall.getNumOperands() == 1 && customCall.getNumResults() == 2);
+  // See `jax.lax.top_k` for more information.
+  //
+  // Operands: [operand (array like)]
+  // Results: [values, indices]
+  return OpShardingRuleBuilder(customCall)
+      .addPointwiseIfDimSizesMatch(getTensorShape(customCall.getOperand(0)),
+                                   getTensorShape(customCall.getResult(0)))
+      .build();
+}
+
+OpShardingRuleAttr createApproxTopKRule(Operation* op, bool) {
+  auto customCall = cast<stablehlo::CustomCallOp>(op);
+  assert(customCall.getNumOperands() == 4 && customCall.getNumResults() == 2);
+  // See `jax.lax.approx_max_k` for more information.
+  //
+  // Operands: [operand, iota, init_val (scalar), init_arg (scalar)]
+  // Results: [values, indices]
+  return OpShardingRuleBuilder(customCall)
+      .addPointwiseIfDimSizesMatch(getTensorShape(customCall.getOperand(0)),
+                                   getTensorShape(customCall.getResult(0)),
+                                   /*alwaysAddFactor=*/false)
+      .build();
+}
+
+OpShardingRuleAttr createBroadcastInDimRule(
+    stablehlo::BroadcastInDimOp broadcast) {
+  OpShardingRuleBuilder builder(broadcast);
+
+  RankedTensorType inType = broadcast.getOperand().getType();
+  RankedTensorType outType = broadcast.getType();
+
+  // We can shard any dimension of the output, and the dimension map tells us
+  // how.
+  SmallVector<int64_t> outDimToInDim(outType.getRank(), kNullDim);
+  for (auto [inDim, outDim] :
+       llvm::enumerate(broadcast.getBroadcastDimensions())) {
+    outDimToInDim[outDim] = inDim;
+  }
+
+  for (auto [outDim, outDimSize] : llvm::enumerate(outType.getShape())) {
+    int64_t inDim = outDimToInDim[outDim];
+    if (inDim != kNullDim) {
+      int64_t inDimSize = inType.getDimSize(inDim);
+      if (inDimSize == 1 && outDimSize != 1) {
+        // `inDim` is expanded in-place in `outDim`.
+        builder.addFactor(inDim, kNullDim, 1);
+        inDim = kNullDim;
+      } else {
+        // `inDim` and `outDim` are identical, thus they should be sharded in
+        // the same way.
+        assert(outDimSize == inDimSize);
+      }
+    }
+    // Otherwise, `inDim == kNullDim`, which means `outDim` is broadcasted.
+
+    builder.addFactor(inDim, outDim, outDimSize);
+  }
+  return builder.build();
+}
+
+OpShardingRuleAttr createDotGeneralRule(stablehlo::DotGeneralOp dotGeneral) {
+  stablehlo::DotDimensionNumbersAttr dimNums =
+      dotGeneral.getDotDimensionNumbers();
+  ArrayRef<int64_t> lhsBatchingDims = dimNums.getLhsBatchingDimensions();
+  ArrayRef<int64_t> rhsBatchingDims = dimNums.getRhsBatchingDimensions();
+  ArrayRef<int64_t> lhsContractingDims = dimNums.getLhsContractingDimensions();
+  ArrayRef<int64_t> rhsContractingDims = dimNums.getRhsContractingDimensions();
+
+  RankedTensorType lhsType = dotGeneral.getLhs().getType();
+  RankedTensorType rhsType = dotGeneral.getRhs().getType();
+
+  const int64_t lhsRank = lhsType.getRank();
+  const int64_t rhsRank = rhsType.getRank();
+
+  OpShardingRuleBuilder builder(
+      dotGeneral, /*reserveNumFactors=*/lhsRank + rhsRank -
+                      lhsBatchingDims.size() - lhsContractingDims.size());
+
+  int64_t outputDim = 0;
+
+  for (auto [lhsDim, rhsDim] :
+       llvm::zip_equal(lhsBatchingDims, rhsBatchingDims)) {
+    builder.addFactor({lhsDim, rhsDim}, outputDim++,
+                      lhsType.getDimSize(lhsDim));
+  }
+
+  for (int64_t i = 0; i < lhsRank; i++) {
+    if (!llvm::is_contained(lhsContractingDims, i) &&
+        !llvm::is_contained(lhsBatchingDims, i)) {
+      builder.addFactor({i, kNullDim}, outputDim++, lhsType.getDimSize(i));
+    }
+  }
+  for (int64_t i = 0; i < rhsRank; i++) {
+    if (!llvm::is_contained(rhsContractingDims, i) &&
+        !llvm::is_contained(rhsBatchingDims, i)) {
+      builder.addFactor({kNullDim, i}, outputDim++, rhsType.getDimSize(i));
+    }
+  }
+  for (auto [lhsDim, rhsDim] :
+       llvm::zip_equal(lhsContractingDims, rhsContractingDims)) {
+    builder.addFactor({lhsDim, rhsDim}, kNullDim, lhsType.getDimSize(lhsDim),
+                      FactorType::kReduction);
+  }
+
+  return builder.build();
+}
+
+OpShardingRuleAttr createDotRule(stablehlo::DotOp dot) {
+  OpShardingRuleBuilder builder(dot);
+  RankedTensorType lhsType = dot.getLhs().getType();
+  RankedTensorType rhsType = dot.getRhs().getType();
+
+  bool isLhsMatrix = lhsType.getRank() == 2;
+  bool isRhsMatrix = rhsType.getRank() == 2;
+
+  // LHS non-contracting.
+  if (isLhsMatrix) {
+    builder.addFactor({0, kNullDim}, 0, lhsType.getDimSize(0));
+  }
+
+  // RHS non-contracting.
+  if (isRhsMatrix) {
+    builder.addFactor({kNullDim, 1}, isLhsMatrix ? 1 : 0,
+                      rhsType.getDimSize(1));
+  }
+
+  // Contracting dimension.
+  builder.addFactor({isLhsMatrix ? 1 : 0, 0}, kNullDim, rhsType.getDimSize(0),
+                    FactorType::kReduction);
+
+  return builder.build();
+}
+
+OpShardingRuleAttr createReduceRule(stablehlo::ReduceOp reduce) {
+  OpShardingRuleBuilder builder(reduce);
+  // Since all inputs and results have compatible shapes, we can look at the
+  // first.
+  ArrayRef<int64_t> inputShape = getTensorShape(reduce.getInputs().front());
+  auto resultType = cast<RankedTensorType>(reduce.getResultTypes().front());
+  // NOTE: resultType is only used by vanilla C++ asserts, so during opt builds
+  // it will be marked as unused.
+  // TODO(bartchr): define our own asserts that are kept during opt builds.
+  (void)resultType;
+
+  ArrayRef<int64_t> dimensions = reduce.getDimensions();
+  size_t numInputs = reduce.getInputs().size();
+
+  int64_t outDim = 0;
+  SmallVector<int64_t> operandDims(reduce->getNumOperands(), kNullDim);
+  SmallVector<int64_t> resultDims(numInputs, kNullDim);
+  for (auto [inDim, dimSize] : llvm::enumerate(inputShape)) {
+    // The first `numInputs` operands are the inputs and the next `numInputs`
+    // operands are the init values.
+    std::fill_n(operandDims.begin(), numInputs, inDim);
+
+    if (llvm::is_contained(dimensions, inDim)) {
+      // Dimension that is being reduced. Can have a mapping for the inputs.
+      resultDims.assign(numInputs, kNullDim);
+      builder.addFactor(operandDims, resultDims, dimSize,
+                        FactorType::kReduction);
+    } else {
+      // Not a reduced dimension. So have a mapping b/w the operand and result.
+      assert(resultType.getDimSize(outDim) == dimSize);
+      resultDims.assign(numInputs, outDim++);
+      builder.addFactor(operandDims, resultDims, dimSize);
+    }
+  }
+  assert(outDim == resultType.getRank());
+  return builder.build();
+}
+
+OpShardingRuleAttr createTransposeRule(stablehlo::TransposeOp transpose) {
+  OpShardingRuleBuilder builder(transpose);
+  RankedTensorType inType = transpose.getOperand().getType();
+  for (auto [outDim, inDim] : llvm::enumerate(transpose.getPermutation())) {
+    builder.addFactor(inDim, outDim, inType.getDimSize(inDim));
+  }
+  return builder.build();
+}
+
+// Adds `createRule` as the sharding rule of all `OpTys`.
+template <typename... OpTys>
+void addShardingRules(
+    llvm::DenseMap<TypeID, OpShardingRuleAttr (*)(Operation*)>& rules,
+    OpShardingRuleAttr (*createRule)(Operation*)) {
+  (rules.try_emplace(TypeID::get<OpTys>(), createRule), ...);
+}
+
+// Calls `createRule` on `op` cast to `OpTy`.
+template <typename OpTy, OpShardingRuleAttr (*createRule)(OpTy)>
+OpShardingRuleAttr createRuleForOp(Operation* op) {
+  return createRule(cast<OpTy>(op));
+}
+
+// Adds `createRule` as the sharding rule of `OpTy`.
+template <typename OpTy, OpShardingRuleAttr (*createRule)(OpTy)>
+void addShardingRule(
+    llvm::DenseMap<TypeID, OpShardingRuleAttr (*)(Operation*)>& rules) {
+  rules.try_emplace(TypeID::get<OpTy>(), &createRuleForOp<OpTy, createRule>);
+}
+
+// Returns the sharding rules of ops whose rule doesn't depend on
+// `conservativePropagation`, keyed by op type, so that they are found with a
+// single lookup instead of going through the `TypeSwitch` in
+// `createOpShardingRule`. This covers pointwise ops, and the most common
+// structural ops (e.g., broadcast, dot, reduce and transpose).
+const llvm::DenseMap<TypeID, OpShardingRuleAttr (*)(Operation*)>&
+getShardingRulesByOpType() {
+  static const auto* rules = [] {
+    auto* rules =
+        new llvm::DenseMap<TypeID, OpShardingRuleAttr (*)(Operation*)>();
+    addShardingRules<
+        ShardingConstraintOp, stablehlo::AbsOp, stablehlo::AddOp,
+        stablehlo::AllGatherOp, stablehlo::AllReduceOp, stablehlo::AllToAllOp,
+        stablehlo::AndOp, stablehlo::Atan2Op, stablehlo::CbrtOp,
+        stablehlo::CeilOp, stablehlo::ClzOp, stablehlo::CollectivePermuteOp,
+        stablehlo::CompareOp, stablehlo::ComplexOp, stablehlo::ConvertOp,
+        stablehlo::CosineOp, stablehlo::CrossReplicaSumOp, stablehlo::DivOp,
+        stablehlo::ExpOp, stablehlo::Expm1Op, stablehlo::FloorOp,
+        stablehlo::ImagOp, stablehlo::IsFiniteOp, stablehlo::Log1pOp,
+        stablehlo::LogOp, stablehlo::LogisticOp, stablehlo::MaxOp,
+        stablehlo::MinOp, stablehlo::MulOp, stablehlo::NegOp,
+        stablehlo::NotOp, stablehlo::OrOp, stablehlo::PopulationCountOp,
+        stablehlo::PowOp, stablehlo::RealOp, stablehlo::ReducePrecisionOp,
+        stablehlo::ReduceScatterOp, stablehlo::RemOp,
+        stablehlo::RoundNearestEvenOp, stablehlo::RoundOp, stablehlo::RsqrtOp,
+        stablehlo::ShiftLeftOp, stablehlo::ShiftRightArithmeticOp,
+        stablehlo::ShiftRightLogicalOp, stablehlo::SignOp, stablehlo::SineOp,
+        stablehlo::SqrtOp, stablehlo::SubtractOp, stablehlo::TanOp,
+        stablehlo::TanhOp, stablehlo::XorOp>(
+        *rules, OpShardingRuleBuilder::buildPointwise);
+    // The following ops are only pointwise for the sake of propagation, but
+    // would require communication for the result to be sharded like the
+    // operand along a specific dimensions. For example, if the operand of an
+    // `stablehlo::ReverseOp` is sharded along the reverse dimension, we would
+    // want to propagate that sharding to the corresponding dimension of the
+    // result, even though that would require communication as all elements are
+    // needed for sorting.
+    addShardingRules<stablehlo::ReverseOp>(
+        *rules, OpShardingRuleBuilder::buildPointwise);
+    addShardingRule<stablehlo::BroadcastInDimOp, createBroadcastInDimRule>(
+        *rules);
+    addShardingRule<stablehlo::DotGeneralOp, createDotGeneralRule>(*rules);
+    addShardingRule<stablehlo::DotOp, createDotRule>(*rules);
+    addShardingRule<stablehlo::ReduceOp, createReduceRule>(*rules);
+    addShardingRule<stablehlo::TransposeOp, createTransposeRule>(*rules);
+    return rules;
+  }();
+  return *rules;
+}
+
+// Custom calls that are known to the registry but don't have a sharding rule.
+OpShardingRuleAttr createNoShardingRule(Operation*, bool) {
+  return OpShardingRuleAttr();
+}
+
+using CustomCallShardingRuleCallbackPtr =
+    std::shared_ptr<const CustomCallShardingRuleCallback>;
+
+llvm::StringMap<CustomCallShardingRuleCallbackPtr>
+createBuiltinCustomCallShardingRules() {
+  llvm::StringMap<CustomCallShardingRuleCallbackPtr> callbacks;
+  auto add = [&](ArrayRef<StringRef> callTargetNames,
+                 CustomCallShardingRuleCallback callback) {
+    auto callbackPtr = std::make_shared<const CustomCallShardingRuleCallback>(
+        std::move(callback));
+    for (StringRef callTargetName : callTargetNames) {
+      callbacks[callTargetName] = callbackPtr;
+    }
+  };
+  add({"sdy_testonly", "tpu_custom_call"}, createNoShardingRule);
+  add({"annotate_device_placement", "Cholesky", "CompactWyHelper",
+       "InvertDiagBlocksLowerTriangular", "InvertDiagBlocksUpperTriangular",
+       "LayoutConstraint", "MoveToDevice", "MoveToHost", "mhlo.erf",
+       "xla.gpu.send", "xla.gpu.recv", "xla.gpu.zeros", "X64Combine"},
+      createPointwiseCustomCallRule);
+  add({"Eigh"}, createEighRule);
+  add({"Qr", "QrDecompositionBlock"}, createQrRule);
+  add({"ProductOfElementaryHouseholderReflectors"},
+      createHouseholderProductRule);
+  add({"mhlo.topk"}, createTopKRule);
+  add({"ApproxTopK", "PartialReduce"}, createApproxTopKRule);
+  return callbacks;
+}
+
+struct CustomCallShardingRules {
+  llvm::sys::SmartRWMutex<true> mutex;
+  llvm::StringMap<CustomCallShardingRuleCallbackPtr> callbacks =
+      createBuiltinCustomCallShardingRules();
+};
+
+CustomCallShardingRules& getCustomCallShardingRules() {
+  // Intentionally leaked, since callbacks registered through the C API may own
+  // objects (e.g., Python callables) that can't be destroyed at exit.
+  static auto* rules = new CustomCallShardingRules();
+  return *rules;
+}
+
+// Replaces the callback registered for `callTargetName` with `callbackPtr`, or
+// erases it if `callbackPtr` is null, and returns the replaced callback (null
+// if there was none).
+//
+// The returned callback should be destroyed outside the lock, since it may own
+// objects that take other locks (e.g., the Python GIL).
+CustomCallShardingRuleCallbackPtr exchangeCallback(
+    StringRef callTargetName, CustomCallShardingRuleCallbackPtr callbackPtr) {
+  CustomCallShardingRules& rules = getCustomCallShardingRules();
+  llvm::sys::SmartScopedWriter<true> scopedLock(rules.mutex);
+  if (callbackPtr) {
+    return std::exchange(rules.callbacks[callTargetName],
+                         std::move(callbackPtr));
+  }
+  auto it = rules.callbacks.find(callTargetName);
+  if (it == rules.callbacks.end()) {
+    return nullptr;
+  }
+  CustomCallShardingRuleCallbackPtr erasedCallback = std::move(it->second);
+  rules.callbacks.erase(it);
+  return erasedCallback;
+}
+
 }  // namespace
 
+void CustomCallShardingRuleRegistry::setCallback(
+    StringRef callTargetName, CustomCallShardingRuleCallback callback) {
+  exchangeCallback(callTargetName,
+                   std::make_shared<const CustomCallShardingRuleCallback>(
+                       std::move(callback)));
+}
+
+void CustomCallShardingRuleRegistry::erase(StringRef callTargetName) {
+  exchangeCallback(callTargetName, nullptr);
+}
+
+bool CustomCallShardingRuleRegistry::isRegistered(StringRef callTargetName) {
+  CustomCallShardingRules& rules = getCustomCallShardingRules();
+  llvm::sys::SmartScopedReader<true> scopedLock(rules.mutex);
+  return rules.callbacks.contains(callTargetName);
+}
+
+std::optional<OpShardingRuleAttr> CustomCallShardingRuleRegistry::createRule(
+    stablehlo::CustomCallOp customCall, bool conservativePropagation) {
+  CustomCallShardingRules& rules = getCustomCallShardingRules();
+  CustomCallShardingRuleCallbackPtr callback;
+  {
+    llvm::sys::SmartScopedReader<true> scopedLock(rules.mutex);
+    callback = rules.callbacks.lookup(customCall.getCallTargetName());
+  }
+  if (!callback) {
+    return std::nullopt;
+  }
+  // The callback is invoked outside the lock, so it can register other
+  // callbacks, or take other locks without risking a deadlock.
+  return (*callback)(customCall, conservativePropagation);
+}
+
+ScopedCustomCallShardingRule::ScopedCustomCallShardingRule(
+    StringRef callTargetName, CustomCallShardingRuleCallback callback)
+    : callTargetName(callTargetName.str()),
+      replacedCallback(exchangeCallback(
+          callTargetName,
+          std::make_shared<const CustomCallShardingRuleCallback>(
+              std::move(callback)))) {}
+
+ScopedCustomCallShardingRule::~ScopedCustomCallShardingRule() {
+  exchangeCallback(callTargetName, std::move(replacedCallback));
+}
+
 OpShardingRuleAttr getOrCreateShardingRule(Operation* op,
                                            bool conservativePropagation,
                                            bool setShardingRuleOnOp) {
@@ -162,40 +607,14 @@ OpShardingRuleAttr getOrCreateShardingRule(Operation* op,
 
 OpShardingRuleAttr createOpShardingRule(Operation* op,
                                         const bool conservativePropagation) {
+  if (OpShardingRuleAttr (*createRule)(Operation*) =
+          getShardingRulesByOpType().lookup(op->getName().getTypeID())) {
+    return createRule(op);
+  }
   return TypeSwitch<Operation*, OpShardingRuleAttr>(op)
-      .Case<
-          ShardingConstraintOp, stablehlo::AbsOp, stablehlo::AddOp,
-          stablehlo::AllGatherOp, stablehlo::AllReduceOp, stablehlo::AllToAllOp,
-          stablehlo::AndOp, stablehlo::Atan2Op, stablehlo::CbrtOp,
-          stablehlo::CeilOp, stablehlo::ClzOp, stablehlo::CollectivePermuteOp,
-          stablehlo::CompareOp, stablehlo::ComplexOp, stablehlo::ConvertOp,
-          stablehlo::CosineOp, stablehlo::CrossReplicaSumOp, stablehlo::DivOp,
-          stablehlo::ExpOp, stablehlo::Expm1Op, stablehlo::FloorOp,
-          stablehlo::ImagOp, stablehlo::IsFiniteOp, stablehlo::Log1pOp,
-          stablehlo::LogOp, stablehlo::LogisticOp, stablehlo::MaxOp,
-          stablehlo::MinOp, stablehlo::MulOp, stablehlo::NegOp,
-          stablehlo::NotOp, stablehlo::OrOp, stablehlo::PopulationCountOp,
-          stablehlo::PowOp, stablehlo::RealOp, stablehlo::ReducePrecisionOp,
-          stablehlo::ReduceScatterOp, stablehlo::RemOp,
-          stablehlo::RoundNearestEvenOp, stablehlo::RoundOp, stablehlo::RsqrtOp,
-          stablehlo::ShiftLeftOp, stablehlo::ShiftRightArithmeticOp,
-          stablehlo::ShiftRightLogicalOp, stablehlo::SignOp, stablehlo::SineOp,
-          stablehlo::SqrtOp, stablehlo::SubtractOp, stablehlo::TanOp,
-          stablehlo::TanhOp, stablehlo::XorOp>([](Operation* pointwiseOp) {
-        return OpShardingRuleBuilder::buildPointwise(pointwiseOp);
-      })
-      // The following case is for ops that are only pointwise for the sake of
-      // propagation, but would require communication for the result to be
-      // sharded like the operand along a specific dimensions. For example, if
-      // the operand of an `stablehlo::ReverseOp` is sharded along the reverse
-      // dimension, we would want to propagate that sharding to the
-      // corresponding dimension of the result, even though that would require
-      // communication as all elements are needed for sorting.
-      .Case<stablehlo::ReverseOp>([](Operation* pointwiseOp) {
-        return OpShardingRuleBuilder::buildPointwise(pointwiseOp);
-      })
       //===----------------------------------------------------------------===//
-      // NOTE: Please keep the order of cases alphabetical.
+      // NOTE: Please keep the order of cases alphabetical. Ops whose rule is
+      // in `getShardingRulesByOpType` never reach this switch.
       //===----------------------------------------------------------------===//
       .Case<stablehlo::BitcastConvertOp>(
           [](stablehlo::BitcastConvertOp bitcastConvert) {
@@ -219,43 +638,6 @@ OpShardingRuleAttr createOpShardingRule(Operation* op,
             }
             return builder.build();
           })
-      .Case<stablehlo::BroadcastInDimOp>(
-          [](stablehlo::BroadcastInDimOp broadcast) {
-            OpShardingRuleBuilder builder(broadcast);
-
-            RankedTensorType inType = broadcast.getOperand().getType();
-            RankedTensorType outType = broadcast.getType();
-
-            // We can shard any dimension of the output, and the dimension map
-            // tells us how.
-            SmallVector<int64_t> outDimToInDim(outType.getRank(), kNullDim);
-            for (auto [inDim, outDim] :
-                 llvm::enumerate(broadcast.getBroadcastDimensions())) {
-              outDimToInDim[outDim] = inDim;
-            }
-
-            for (auto [outDim, outDimSize] :
-                 llvm::enumerate(outType.getShape())) {
-              int64_t inDim = outDimToInDim[outDim];
-              if (inDim != kNullDim) {
-                int64_t inDimSize = inType.getDimSize(inDim);
-                if (inDimSize == 1 && outDimSize != 1) {
-                  // `inDim` is expanded in-place in `outDim`.
-                  builder.addFactor(inDim, kNullDim, 1);
-                  inDim = kNullDim;
-                } else {
-                  // `inDim` and `outDim` are identical, thus they should be
-                  // sharded in the same way.
-                  assert(outDimSize == inDimSize);
-                }
-              }
-              // Otherwise, `inDim == kNullDim`, which means `outDim` is
-              // broadcasted.
-
-              builder.addFactor(inDim, outDim, outDimSize);
-            }
-            return builder.build();
-          })
       .Case<stablehlo::CholeskyOp>([](stablehlo::CholeskyOp cholesky) {
         ArrayRef<int64_t> shape = getTensorShape(cholesky.getOperand());
         // The first (n - 2) dimensions are batch dimensions. The last 2
@@ -395,121 +777,11 @@ OpShardingRuleAttr createOpShardingRule(Operation* op,
 
         return builder.build();
       })
-      .Case<stablehlo::CustomCallOp>([](stablehlo::CustomCallOp customCall) {
-        StringRef callTargetName = customCall.getCallTargetName();
-        // TODO(b/327191011): output unregistered op stats instead.
-        if (callTargetName == "sdy_testonly" ||
-            callTargetName == "tpu_custom_call") {
-          return OpShardingRuleAttr();
-        }
-        if (callTargetName == "annotate_device_placement" ||
-            callTargetName == "Cholesky" ||
-            callTargetName == "CompactWyHelper" ||
-            callTargetName == "InvertDiagBlocksLowerTriangular" ||
-            callTargetName == "InvertDiagBlocksUpperTriangular" ||
-            callTargetName == "LayoutConstraint" ||
-            callTargetName == "MoveToDevice" ||
-            callTargetName == "MoveToHost" || callTargetName == "mhlo.erf" ||
-            callTargetName == "xla.gpu.send" ||
-            callTargetName == "xla.gpu.recv" ||
-            callTargetName == "xla.gpu.zeros" ||
-            callTargetName == "X64Combine") {
-          return OpShardingRuleBuilder::buildPointwise(customCall);
-        }
-        if (callTargetName == "Eigh") {
-          assert(customCall.getNumOperands() == 1 &&
-                 customCall.getNumResults() == 2);
-          // See `jax.lax.linalg.eigh` for more information.
-          //
-          // All but the last two dimensions of the input are batch dimensions,
-          // but we can also propagate through the non-batch dimensions as they
-          // correspond between input and results, even though that would
-          // require communication. The 2nd result (eigenvalues) has a single
-          // non-batch dimension that corresponds to the last dimension of the
-          // input and 1st result (eigenvectors).
-          ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
-          int64_t nonBatchDim1 = inShape.size() - 2;
-          int64_t nonBatchDim2 = inShape.size() - 1;
-          return OpShardingRuleBuilder(customCall)
-              .addPointwise(inShape.drop_back(2))
-              .addFactor(nonBatchDim1, {nonBatchDim1, kNullDim},
-                         inShape[nonBatchDim1])
-              .addFactor(nonBatchDim2, {nonBatchDim2, nonBatchDim1},
-                         inShape[nonBatchDim2])
-              .build();
-        }
-        if (callTargetName == "Qr" ||
-            callTargetName == "QrDecompositionBlock") {
-          assert(customCall.getNumOperands() == 1 &&
-                 customCall.getNumResults() == 2);
-          // See `jax.lax.linalg.qr` for more information.
-          //
-          // All but the last two dimensions of the input are batch dimensions,
-          // but we can also propagate through the non-batch dimensions as they
-          // correspond between input and 1st result, even though that would
-          // require communication. The 2nd result has a single non-batch
-          // dimension that has size equal to the minimum between the two
-          // non-batch dimensions of the input, but we wouldn't benefit from
-          // sharding it in the same way, given how QR decomposition is
-          // computed.
-          ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
-          int64_t nonBatchDim1 = inShape.size() - 2;
-          int64_t nonBatchDim2 = inShape.size() - 1;
-          return OpShardingRuleBuilder(customCall)
-              .addPointwise(inShape.drop_back(2))
-              .addFactor(nonBatchDim1, {nonBatchDim1, kNullDim},
-                         inShape[nonBatchDim1])
-              .addFactor(nonBatchDim2, {nonBatchDim2, kNullDim},
-                         inShape[nonBatchDim2])
-              .build();
-        }
-        if (callTargetName == "ProductOfElementaryHouseholderReflectors") {
-          // See `jax.lax.linalg.householder_product` for more information.
-          //
-          // All but the last two dimensions of the input are batch dimensions,
-          // but we can also propagate through the non-batch dimensions as they
-          // correspond between the 1st input and result, even though that
-          // would require communication. The 2nd input (taus) has a single
-          // non-batch dimension that doesn't correspond to any dimension in the
-          // other tensors.
-          ArrayRef<int64_t> inShape = getTensorShape(customCall.getOperand(0));
-          int64_t nonBatchDim1 = inShape.size() - 2;
-          int64_t nonBatchDim2 = inShape.size() - 1;
-          return OpShardingRuleBuilder(customCall)
-              .addPointwise(inShape.drop_back(2))
-              .addFactor({nonBatchDim1, kNullDim}, nonBatchDim1,
-                         inShape[nonBatchDim1])
-              .addFactor({nonBatchDim2, kNullDim}, nonBatchDim2,
-                         inShape[nonBatchDim2])
-              .build();
-        }
-        if (callTargetName == "mhlo.topk") {
-          assert(customCall.getNumOperands() == 1 &&
-                 customCall.getNumResults() == 2);
-          // See `jax.lax.top_k` for more information.
-          //
-          // Operands: [operand (array like)]
-          // Results: [values, indices]
-          return OpShardingRuleBuilder(customCall)
-              .addPointwiseIfDimSizesMatch(
-                  getTensorShape(customCall.getOperand(0)),
-                  getTensorShape(customCall.getResult(0)))
-              .build();
-        }
-        if (callTargetName == "ApproxTopK" ||
-            callTargetName == "PartialReduce") {
-          assert(customCall.getNumOperands() == 4 &&
-                 customCall.getNumResults() == 2);
-          // See `jax.lax.approx_max_k` for more information.
-          //
-          // Operands: [operand, iota, init_val (scalar), init_arg (scalar)]
-          // Results: [values, indices]
-          return OpShardingRuleBuilder(customCall)
-              .addPointwiseIfDimSizesMatch(
-                  getTensorShape(customCall.getOperand(0)),
-                  getTensorShape(customCall.getResult(0)),
-                  /*alwaysAddFactor=*/false)
-              .build();
+      .Case<stablehlo::CustomCallOp>([&](stablehlo::CustomCallOp customCall) {
+        if (std::optional<OpShardingRuleAttr> rule =
+                CustomCallShardingRuleRegistry::createRule(
+                    customCall, conservativePropagation)) {
+          return *rule;
         }
         // TODO(b/327191011): output unregistered op stats instead.
         static llvm::once_flag onceFlag;
@@ -521,82 +793,6 @@ OpShardingRuleAttr createOpShardingRule(Operation* op,
                 .str());
         return OpShardingRuleAttr();
       })
-      .Case<stablehlo::DotGeneralOp>([](stablehlo::DotGeneralOp dotGeneral) {
-        stablehlo::DotDimensionNumbersAttr dimNums =
-            dotGeneral.getDotDimensionNumbers();
-        ArrayRef<int64_t> lhsBatchingDims = dimNums.getLhsBatchingDimensions();
-        ArrayRef<int64_t> rhsBatchingDims = dimNums.getRhsBatchingDimensions();
-        ArrayRef<int64_t> lhsContractingDims =
-            dimNums.getLhsContractingDimensions();
-        ArrayRef<int64_t> rhsContractingDims =
-            dimNums.getRhsContractingDimensions();
-
-        RankedTensorType lhsType = dotGeneral.getLhs().getType();
-        RankedTensorType rhsType = dotGeneral.getRhs().getType();
-
-        const int64_t lhsRank = lhsType.getRank();
-        const int64_t rhsRank = rhsType.getRank();
-
-        OpShardingRuleBuilder builder(dotGeneral,
-                                      /*reserveNumFactors=*/lhsRank + rhsRank -
-                                          lhsBatchingDims.size() -
-                                          lhsContractingDims.size());
-
-        int64_t outputDim = 0;
-
-        for (auto [lhsDim, rhsDim] :
-             llvm::zip_equal(lhsBatchingDims, rhsBatchingDims)) {
-          builder.addFactor({lhsDim, rhsDim}, outputDim++,
-                            lhsType.getDimSize(lhsDim));
-        }
-
-        for (int64_t i = 0; i < lhsRank; i++) {
-          if (!llvm::is_contained(lhsContractingDims, i) &&
-              !llvm::is_contained(lhsBatchingDims, i)) {
-            builder.addFactor({i, kNullDim}, outputDim++,
-                              lhsType.getDimSize(i));
-          }
-        }
-        for (int64_t i = 0; i < rhsRank; i++) {
-          if (!llvm::is_contained(rhsContractingDims, i) &&
-              !llvm::is_contained(rhsBatchingDims, i)) {
-            builder.addFactor({kNullDim, i}, outputDim++,
-                              rhsType.getDimSize(i));
-          }
-        }
-        for (auto [lhsDim, rhsDim] :
-             llvm::zip_equal(lhsContractingDims, rhsContractingDims)) {
-          builder.addFactor({lhsDim, rhsDim}, kNullDim,
-                            lhsType.getDimSize(lhsDim), FactorType::kReduction);
-        }
-
-        return builder.build();
-      })
-      .Case<stablehlo::DotOp>([](stablehlo::DotOp dot) {
-        OpShardingRuleBuilder builder(dot);
-        RankedTensorType lhsType = dot.getLhs().getType();
-        RankedTensorType rhsType = dot.getRhs().getType();
-
-        bool isLhsMatrix = lhsType.getRank() == 2;
-        bool isRhsMatrix = rhsType.getRank() == 2;
-
-        // LHS non-contracting.
-        if (isLhsMatrix) {
-          builder.addFactor({0, kNullDim}, 0, lhsType.getDimSize(0));
-        }
-
-        // RHS non-contracting.
-        if (isRhsMatrix) {
-          builder.addFactor({kNullDim, 1}, isLhsMatrix ? 1 : 0,
-                            rhsType.getDimSize(1));
-        }
-
-        // Contracting dimension.
-        builder.addFactor({isLhsMatrix ? 1 : 0, 0}, kNullDim,
-                          rhsType.getDimSize(0), FactorType::kReduction);
-
-        return builder.build();
-      })
       .Case<stablehlo::DynamicSliceOp>(
           [](stablehlo::DynamicSliceOp dynamicSlice) {
             return OpShardingRuleBuilder(dynamicSlice)
@@ -668,48 +864,6 @@ OpShardingRuleAttr createOpShardingRule(Operation* op,
                 /*alwaysAddFactor=*/!conservativePropagation)
             .build();
       })
-      .Case<stablehlo::ReduceOp>([](stablehlo::ReduceOp reduce) {
-        OpShardingRuleBuilder builder(reduce);
-        // Since all inputs and results have compatible shapes, we can look at
-        // the first.
-        ArrayRef<int64_t> inputShape =
-            getTensorShape(reduce.getInputs().front());
-        auto resultType =
-            cast<RankedTensorType>(reduce.getResultTypes().front());
-        // NOTE: resultType is only used by vanilla C++ asserts, so during opt
-        // builds it will be marked as unused.
-        // TODO(bartchr): define our own asserts that are kept during opt
-        // builds.
-        (void)resultType;
-
-        ArrayRef<int64_t> dimensions = reduce.getDimensions();
-        size_t numInputs = reduce.getInputs().size();
-
-        int64_t outDim = 0;
-        SmallVector<int64_t> operandDims(reduce->getNumOperands(), kNullDim);
-        SmallVector<int64_t> resultDims(numInputs, kNullDim);
-        for (auto [inDim, dimSize] : llvm::enumerate(inputShape)) {
-          // The first `numInputs` operands are the inputs and the next
-          // `numInputs` operands are the init values.
-          std::fill_n(operandDims.begin(), numInputs, inDim);
-
-          if (llvm::is_contained(dimensions, inDim)) {
-            // Dimension that is being reduced. Can have a mapping for the
-            // inputs.
-            resultDims.assign(numInputs, kNullDim);
-            builder.addFactor(operandDims, resultDims, dimSize,
-                              FactorType::kReduction);
-          } else {
-            // Not a reduced dimension. So have a mapping b/w the operand and
-            // result.
-            assert(resultType.getDimSize(outDim) == dimSize);
-            resultDims.assign(numInputs, outDim++);
-            builder.addFactor(operandDims, resultDims, dimSize);
-          }
-        }
-        assert(outDim == resultType.getRank());
-        return builder.build();
-      })
       .Case<stablehlo::ReduceWindowOp>(
           [conservativePropagation](stablehlo::ReduceWindowOp reduceWindow) {
             // Since all results have compatible shapes, we can look at the
@@ -941,15 +1095,6 @@ OpShardingRuleAttr createOpShardingRule(Operation* op,
             .addPointwiseIf(shape, pred, getFactorType)
             .build();
       })
-      .Case<stablehlo::TransposeOp>([](stablehlo::TransposeOp transpose) {
-        OpShardingRuleBuilder builder(transpose);
-        RankedTensorType inType = transpose.getOperand().getType();
-        for (auto [outDim, inDim] :
-             llvm::enumerate(transpose.getPermutation())) {
-          builder.addFactor(inDim, outDim, inType.getDimSize(inDim));
-        }
-        return builder.build();
-      })
       .Case<stablehlo::TriangularSolveOp>(
           [](stablehlo::TriangularSolveOp triangularSolve) {
             OpShardingRuleBuilder builder(triangularSolve);
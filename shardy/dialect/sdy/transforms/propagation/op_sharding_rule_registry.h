@@ -16,8 +16,15 @@ limitations under the License.
 #ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_OP_SHARDING_RULE_REGISTRY_H_
 #define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_OP_SHARDING_RULE_REGISTRY_H_
 
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
 #include "mlir/IR/Operation.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
+#include "stablehlo/dialect/StablehloOps.h"
 
 namespace mlir {
 namespace sdy {
@@ -43,6 +50,61 @@ OpShardingRuleAttr getOrCreateShardingRule(Operation* op,
                                            bool conservativePropagation = false,
                                            bool setShardingRuleOnOp = true);
 
+// A callback that creates the sharding rule of a `stablehlo.custom_call` op.
+//
+// Returning a null attribute means the op has no sharding rule, in which case
+// propagation doesn't go through it.
+using CustomCallShardingRuleCallback = std::function<OpShardingRuleAttr(
+    Operation* customCall, bool conservativePropagation)>;
+
+// A registry of sharding rule callbacks for `stablehlo.custom_call` ops, keyed
+// by call target name, so that `createOpShardingRule` can find the rule of a
+// custom call with a single lookup.
+//
+// The built-in call targets (e.g., "Cholesky", "Eigh", "mhlo.topk") are
+// registered on first use. Registering a callback for a call target that
+// already has one replaces it.
+//
+// The registry is thread-safe, and callbacks are invoked outside of its lock,
+// but they may be invoked concurrently from multiple threads.
+class CustomCallShardingRuleRegistry {
+ public:
+  // Registers `callback` for custom calls with the given `callTargetName`.
+  static void setCallback(StringRef callTargetName,
+                          CustomCallShardingRuleCallback callback);
+
+  // Removes the callback registered for `callTargetName`, if any.
+  static void erase(StringRef callTargetName);
+
+  // Returns true if a callback has been registered for `callTargetName`.
+  static bool isRegistered(StringRef callTargetName);
+
+  // Creates the sharding rule of `customCall` using the callback registered for
+  // its call target name.
+  //
+  // Returns std::nullopt if no callback has been registered.
+  static std::optional<OpShardingRuleAttr> createRule(
+      stablehlo::CustomCallOp customCall, bool conservativePropagation);
+};
+
+// Overrides the callback registered for a call target for the lifetime of this
+// object, and then restores the callback it replaced (e.g., a built-in one), or
+// erases the call target if it had none.
+class ScopedCustomCallShardingRule {
+ public:
+  ScopedCustomCallShardingRule(StringRef callTargetName,
+                               CustomCallShardingRuleCallback callback);
+  ~ScopedCustomCallShardingRule();
+
+  ScopedCustomCallShardingRule(const ScopedCustomCallShardingRule&) = delete;
+  ScopedCustomCallShardingRule& operator=(const ScopedCustomCallShardingRule&) =
+      delete;
+
+ private:
+  std::string callTargetName;
+  std::shared_ptr<const CustomCallShardingRuleCallback> replacedCallback;
+};
+
 }  // namespace sdy
 }  // namespace mlir
 
@@ -0,0 +1,181 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_registry.h"
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_builder.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+stablehlo::CustomCallOp getFirstCustomCall(ModuleOp module) {
+  auto mainFn = cast<func::FuncOp>(module.lookupSymbol("main"));
+  auto ops = mainFn.getBody().front().getOps<stablehlo::CustomCallOp>();
+  assert(!ops.empty());
+  return *ops.begin();
+}
+
+class CustomCallShardingRuleRegistryTest : public PropagationTestBase {
+ protected:
+  OwningOpRef<ModuleOp> parseCustomCall(StringRef callTargetName) {
+    std::string program = R"mlir(
+      func.func @main(%arg0: tensor<8x16xf32>) -> tensor<8x16xf32> {
+        %0 = stablehlo.custom_call @)mlir" +
+                          callTargetName.str() + R"mlir((%arg0)
+          : (tensor<8x16xf32>) -> tensor<8x16xf32>
+        return %0 : tensor<8x16xf32>
+      })mlir";
+    return parseSourceString<ModuleOp>(program, &context);
+  }
+};
+
+TEST_F(CustomCallShardingRuleRegistryTest, BuiltinCallTargets) {
+  EXPECT_TRUE(CustomCallShardingRuleRegistry::isRegistered("Cholesky"));
+  EXPECT_TRUE(CustomCallShardingRuleRegistry::isRegistered("tpu_custom_call"));
+  EXPECT_FALSE(CustomCallShardingRuleRegistry::isRegistered("my_kernel"));
+
+  OwningOpRef<ModuleOp> module = parseCustomCall("Cholesky");
+  ASSERT_TRUE(module);
+  EXPECT_EQ(createOpShardingRule(getFirstCustomCall(module.get())),
+            OpShardingRuleBuilder::buildPointwise(
+                getFirstCustomCall(module.get())));
+}
+
+TEST_F(CustomCallShardingRuleRegistryTest, RegisterAndEraseCallback) {
+  OwningOpRef<ModuleOp> module = parseCustomCall("my_kernel");
+  ASSERT_TRUE(module);
+  stablehlo::CustomCallOp customCall = getFirstCustomCall(module.get());
+  EXPECT_FALSE(createOpShardingRule(customCall));
+
+  bool conservativePropagationSeen = false;
+  {
+    // Erases "my_kernel" when the scope ends, even if an assertion fails, so
+    // the callback doesn't outlive `conservativePropagationSeen`.
+    ScopedCustomCallShardingRule scopedRule(
+        "my_kernel", [&](Operation* op, bool conservativePropagation) {
+          conservativePropagationSeen = conservativePropagation;
+          return OpShardingRuleBuilder::buildPointwise(op);
+        });
+    EXPECT_TRUE(CustomCallShardingRuleRegistry::isRegistered("my_kernel"));
+    EXPECT_EQ(
+        createOpShardingRule(customCall, /*conservativePropagation=*/true),
+        OpShardingRuleBuilder::buildPointwise(customCall));
+    EXPECT_TRUE(conservativePropagationSeen);
+
+    CustomCallShardingRuleRegistry::erase("my_kernel");
+    EXPECT_FALSE(CustomCallShardingRuleRegistry::isRegistered("my_kernel"));
+    EXPECT_FALSE(createOpShardingRule(customCall));
+
+    CustomCallShardingRuleRegistry::setCallback(
+        "my_kernel", [](Operation* op, bool) {
+          return OpShardingRuleBuilder::buildPointwise(op);
+        });
+  }
+  EXPECT_FALSE(CustomCallShardingRuleRegistry::isRegistered("my_kernel"));
+}
+
+TEST_F(CustomCallShardingRuleRegistryTest, OverrideBuiltinCallTarget) {
+  OwningOpRef<ModuleOp> module = parseCustomCall("tpu_custom_call");
+  ASSERT_TRUE(module);
+  stablehlo::CustomCallOp customCall = getFirstCustomCall(module.get());
+  EXPECT_FALSE(createOpShardingRule(customCall));
+
+  {
+    ScopedCustomCallShardingRule scopedRule(
+        "tpu_custom_call", [](Operation* op, bool) {
+          return OpShardingRuleBuilder::buildPointwise(op);
+        });
+    EXPECT_EQ(createOpShardingRule(customCall),
+              OpShardingRuleBuilder::buildPointwise(customCall));
+  }
+
+  // The built-in rule is restored.
+  EXPECT_TRUE(CustomCallShardingRuleRegistry::isRegistered("tpu_custom_call"));
+  EXPECT_FALSE(createOpShardingRule(customCall));
+}
+
+class OpShardingRuleRegistryTest : public PropagationTestBase {};
+
+TEST_F(OpShardingRuleRegistryTest, PointwiseRuleMatchesBuilder) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8x1x16xf32>, %arg1: tensor<8x1x16xf32>)
+        -> tensor<8x1x16xf32> {
+      %0 = stablehlo.add %arg0, %arg1 : tensor<8x1x16xf32>
+      return %0 : tensor<8x1x16xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto mainFn = cast<func::FuncOp>(module->lookupSymbol("main"));
+  Operation* add = &mainFn.getBody().front().front();
+  auto type = cast<ShapedType>(add->getResult(0).getType());
+
+  EXPECT_EQ(createOpShardingRule(add),
+            createIdentityShardingRule(type, /*numOperands=*/2,
+                                       /*numResults=*/1));
+}
+
+TEST_F(OpShardingRuleRegistryTest, StructuralRulesByOpType) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8x16xf32>, %arg1: tensor<16x32xf32>)
+        -> tensor<32x8xf32> {
+      %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0]
+          : (tensor<8x16xf32>, tensor<16x32xf32>) -> tensor<8x32xf32>
+      %1 = stablehlo.transpose %0, dims = [1, 0]
+          : (tensor<8x32xf32>) -> tensor<32x8xf32>
+      return %1 : tensor<32x8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto mainFn = cast<func::FuncOp>(module->lookupSymbol("main"));
+  Operation* dotGeneral = &mainFn.getBody().front().front();
+  Operation* transpose = dotGeneral->getNextNode();
+
+  OpShardingRuleAttr dotGeneralRule = createOpShardingRule(dotGeneral);
+  ASSERT_TRUE(dotGeneralRule);
+  EXPECT_EQ(dotGeneralRule.getFactorSizes(), ArrayRef<int64_t>({8, 32, 16}));
+  EXPECT_FALSE(dotGeneralRule.isReductionFactor(0));
+  EXPECT_FALSE(dotGeneralRule.isReductionFactor(1));
+  EXPECT_TRUE(dotGeneralRule.isReductionFactor(2));
+
+  OpShardingRuleAttr transposeRule = createOpShardingRule(transpose);
+  ASSERT_TRUE(transposeRule);
+  EXPECT_EQ(transposeRule.getFactorSizes(), ArrayRef<int64_t>({32, 8}));
+  ArrayRef<DimMappingAttr> operandDims =
+      transposeRule.getOperandMapping(0).getDimMappings();
+  EXPECT_EQ(operandDims[0].getFactorIndices(), ArrayRef<int64_t>({1}));
+  EXPECT_EQ(operandDims[1].getFactorIndices(), ArrayRef<int64_t>({0}));
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
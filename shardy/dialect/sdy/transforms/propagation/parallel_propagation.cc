@@ -0,0 +1,186 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/parallel_propagation.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/Visitors.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+
+namespace mlir {
+namespace sdy {
+
+using func::FuncOp;
+
+namespace {
+
+// The updates to the sharding of a value by all regions in a single round.
+struct ValueUpdate {
+  TensorShardingAttr sharding;
+  // The regions that updated the sharding.
+  SmallVector<int64_t> regions;
+  // Whether any two regions updated the sharding differently.
+  bool conflicting = false;
+};
+
+}  // namespace
+
+SmallVector<SmallVector<Operation*>> ParallelPropagation::partitionIntoRegions(
+    ModuleOp moduleOp, int64_t numRegions) {
+  SmallVector<Operation*> topLevelOps;
+  int64_t numOps = 0;
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    for (Operation& op : funcOp.getBody().getOps()) {
+      topLevelOps.push_back(&op);
+      op.walk([&](Operation*) { ++numOps; });
+    }
+  }
+
+  SmallVector<SmallVector<Operation*>> regions;
+  if (numOps == 0) {
+    return regions;
+  }
+  // Every region but the last has at least `regionSize` ops, so there are at
+  // most `numRegions` regions.
+  int64_t regionSize =
+      llvm::divideCeil(numOps, std::max<int64_t>(numRegions, 1));
+  for (Operation* topLevelOp : topLevelOps) {
+    if (regions.empty() ||
+        static_cast<int64_t>(regions.back().size()) >= regionSize) {
+      regions.emplace_back();
+    }
+    topLevelOp->walk<WalkOrder::PreOrder>(
+        [&](Operation* op) { regions.back().push_back(op); });
+  }
+  return regions;
+}
+
+int64_t ParallelPropagation::propagate(ModuleOp moduleOp,
+                                       int64_t numRegions) const {
+  SmallVector<SmallVector<Operation*>> regions =
+      partitionIntoRegions(moduleOp, numRegions);
+  // The region of each op, and its index in that region.
+  llvm::DenseMap<Operation*, std::pair<int64_t, int64_t>> opToPosition;
+  // The ops of each region that need to be propagated through.
+  SmallVector<llvm::BitVector> dirty;
+  dirty.reserve(regions.size());
+  for (auto [regionIndex, region] : llvm::enumerate(regions)) {
+    for (auto [indexInRegion, op] : llvm::enumerate(region)) {
+      opToPosition[op] = {regionIndex, indexInRegion};
+    }
+    dirty.emplace_back(region.size(), true);
+  }
+  // The regions whose ops are left to the sequential engine.
+  llvm::BitVector retired(regions.size());
+
+  MLIRContext* context = moduleOp.getContext();
+  int64_t round = 0;
+  for (; round < kMaxRounds &&
+         llvm::any_of(dirty, [](const llvm::BitVector& regionDirty) {
+           return regionDirty.any();
+         });
+       ++round) {
+    SmallVector<ShardingSideTable> sideTables(regions.size());
+    // The IR is only read while the regions are propagated through.
+    parallelFor(context, 0, regions.size(), [&](size_t regionIndex) {
+      llvm::BitVector& regionDirty = dirty[regionIndex];
+      if (regionDirty.none()) {
+        return;
+      }
+      SmallVector<Operation*> dirtyOps = llvm::map_to_vector(
+          regionDirty.set_bits(),
+          [&](unsigned index) { return regions[regionIndex][index]; });
+      regionDirty.reset();
+      // Each region has its own instance, since it caches sharding rules.
+      SideTablePropagation propagation(symbolTable, shardingGroupMap,
+                                       factorPropagation,
+                                       getDirectionToPropagate,
+                                       conservativePropagation);
+      propagation.propagateOps(
+          dirtyOps, sideTables[regionIndex], [&](Operation* op) {
+            auto it = opToPosition.find(op);
+            return it != opToPosition.end() &&
+                   it->second.first == static_cast<int64_t>(regionIndex);
+          });
+    });
+
+    // Exchange the updated boundary shardings between the regions.
+    llvm::DenseMap<Value, ValueUpdate> valueToUpdate;
+    for (auto [regionIndex, sideTable] : llvm::enumerate(sideTables)) {
+      for (auto [value, sharding] : sideTable.getValueShardings()) {
+        auto [it, inserted] = valueToUpdate.try_emplace(value);
+        ValueUpdate& update = it->second;
+        if (inserted) {
+          update.sharding = sharding;
+        } else if (update.sharding != sharding) {
+          update.conflicting = true;
+        }
+        update.regions.push_back(regionIndex);
+      }
+    }
+    // A region that updated a sharding differently than another region may
+    // have derived other updates from it, so none of its updates are set, and
+    // its ops are left to the sequential engine.
+    for (auto& [value, update] : valueToUpdate) {
+      if (update.conflicting) {
+        for (int64_t regionIndex : update.regions) {
+          retired.set(regionIndex);
+          dirty[regionIndex].reset();
+        }
+      }
+    }
+    for (auto& [value, update] : valueToUpdate) {
+      if (llvm::all_of(update.regions, [&](int64_t regionIndex) {
+            return retired.test(regionIndex);
+          })) {
+        continue;
+      }
+      setSharding(value, update.sharding);
+      // Ops in the regions that updated the sharding were already propagated
+      // through with it.
+      forEachOpAffectedBySharding(value, [&](Operation* op) {
+        if (auto it = opToPosition.find(op); it != opToPosition.end()) {
+          auto [regionIndex, indexInRegion] = it->second;
+          if (!retired.test(regionIndex) &&
+              !llvm::is_contained(update.regions, regionIndex)) {
+            dirty[regionIndex].set(indexInRegion);
+          }
+        }
+      });
+    }
+  }
+  return round;
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,102 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PARALLEL_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PARALLEL_PROPAGATION_H_
+
+#include <cstdint>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/transforms/propagation/basic_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+
+namespace mlir {
+namespace sdy {
+
+// Propagates shardings through the functions of a module concurrently, by
+// partitioning their ops into regions that are propagated through on separate
+// threads.
+//
+// Each round, every region with dirty ops is propagated through to a local
+// fixed point on its own `ShardingSideTable`, while the IR is only read. The
+// boundary shardings of all regions are then exchanged: every sharding that a
+// single region updated (or that all regions updated in the same way) is set
+// on the IR, and the ops in other regions that are affected by it become dirty
+// for the next round. Rounds repeat until no op is dirty.
+//
+// If multiple regions updated the sharding of a value differently in the same
+// round, none of the updates of those regions are set, since they may be
+// derived from the conflicting sharding, and their ops aren't propagated
+// through in later rounds. Therefore, this should be followed by the
+// sequential propagation engine, which confirms the fixed point and resolves
+// such conflicts. Since the parallel rounds already reach the fixed point for
+// most ops, the sequential engine usually only needs a single sweep that
+// doesn't update anything.
+//
+// Regions commit their shardings in a different order than the sequential
+// engine visits ops, so this should only be used if shardings are propagated in
+// both directions and without priorities, where the order of visiting ops is
+// unspecified anyway.
+class ParallelPropagation {
+ public:
+  // The maximum number of rounds, after which the remaining dirty ops are left
+  // to the sequential engine.
+  static constexpr int64_t kMaxRounds = 100;
+
+  ParallelPropagation(const SymbolTable& symbolTable,
+                      const ShardingGroupMap& shardingGroupMap,
+                      const FactorPropagation& factorPropagation,
+                      GetDirectionToPropagateFn getDirectionToPropagate,
+                      bool conservativePropagation)
+      : symbolTable(symbolTable),
+        shardingGroupMap(shardingGroupMap),
+        factorPropagation(factorPropagation),
+        getDirectionToPropagate(getDirectionToPropagate),
+        conservativePropagation(conservativePropagation) {}
+
+  // Propagates shardings through all functions in `moduleOp`, partitioned into
+  // at most `numRegions` regions, and returns the number of rounds.
+  //
+  // This doesn't propagate between function outputs and their producing
+  // values.
+  int64_t propagate(ModuleOp moduleOp, int64_t numRegions) const;
+
+  // Partitions the ops in the bodies of all functions in `moduleOp` into at
+  // most `numRegions` non-empty regions of roughly the same number of ops.
+  //
+  // Each region is a contiguous range of top-level ops in the function bodies,
+  // in program order, including all ops nested in them. Since program order is
+  // a topological order of the def-use graph within a block, most def-use
+  // edges stay within a region.
+  static SmallVector<SmallVector<Operation*>> partitionIntoRegions(
+      ModuleOp moduleOp, int64_t numRegions);
+
+ private:
+  const SymbolTable& symbolTable;
+  const ShardingGroupMap& shardingGroupMap;
+  const FactorPropagation& factorPropagation;
+  GetDirectionToPropagateFn getDirectionToPropagate;
+  bool conservativePropagation;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PARALLEL_PROPAGATION_H_
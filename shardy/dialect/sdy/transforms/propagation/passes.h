@@ -18,6 +18,7 @@ limitations under the License.
 
 // IWYU pragma: begin_keep
 
+#include <cstdint>
 #include <memory>
 
 #include "mlir/Dialect/Func/IR/FuncOps.h"
@@ -25,6 +26,7 @@ limitations under the License.
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
 
 // IWYU pragma: end_keep
 
@@ -35,6 +37,8 @@ namespace sdy {
 #define GEN_PASS_REGISTRATION
 #include "shardy/dialect/sdy/transforms/propagation/passes.h.inc"
 
+class ReshardCostModel;
+
 struct PropagationOptions {
   // Whether to keep existing and created `sdy::OpShardingRuleAttr` on ops.
   bool keepShardingRules = false;
@@ -52,8 +56,34 @@ struct PropagationOptions {
   bool skipConvertToReshard = false;
   // Whether to skip inlining in the module.
   bool skipInline = false;
+  // Whether to propagate across `func.call` ops by specializing each callee
+  // once per distinct call signature. Should be used with `skipInline`.
+  bool interproceduralPropagation = false;
+  // Whether to schedule propagation in sweeps over the strongly connected
+  // components of the def-use graph, instead of using the greedy rewrite
+  // driver.
+  bool sccScheduling = false;
+  // Whether to propagate through independent functions concurrently, in
+  // wavefronts where callees are propagated through before their callers.
+  bool perFunctionPropagation = false;
+  // The number of regions to partition the ops of the module into, which are
+  // propagated through concurrently before the sequential propagation. 0
+  // disables parallel propagation, and -1 uses the number of threads of the
+  // context.
+  int64_t parallelPropagationRegions = 0;
+  // Whether to cache the axes propagated along each factor of an op between
+  // visits, and only recompute the factors mapped to a tensor whose sharding
+  // changed since the previous visit.
+  bool incrementalFactorPropagation = false;
   // Whether to enable inserting explicit collectives.
   bool enableInsertExplicitCollectives = false;
+  // The per-device memory budget in bytes, which aggressive propagation tries
+  // to satisfy by further sharding tensors that exceed it. A non-positive value
+  // disables the budget. Can't be used with the cost-based strategy.
+  int64_t perDeviceMemoryBudget = 0;
+  // The cost model used by the cost-based propagation strategy to resolve
+  // conflicts across factors. If null, `BytesReshardCostModel` is used.
+  std::shared_ptr<const ReshardCostModel> reshardCostModel;
 };
 
 // Adds the SDY propagation pass, preceded by a sequence of import passes needed
@@ -67,6 +97,12 @@ void addPropagationPipeline(OpPassManager& pm,
 // Register the sdy-propagation-pipeline.
 void registerPropagationPipeline();
 
+// Registers `ReferenceAutoPartitionPass` as the auto-partitioner in
+// `AutoPartitionerRegistry`.
+//
+// Assumes no auto-partitioner has been registered yet.
+void registerReferenceAutoPartitioner();
+
 }  // namespace sdy
 }  // namespace mlir
 
@@ -0,0 +1,250 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/propagation_scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/Visitors.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+// Returns the op that holds the sharding of `value`.
+Operation* getShardingHolder(Value value) {
+  if (auto dataFlowEdge = DataFlowEdgeOp::lookup(value)) {
+    return dataFlowEdge;
+  }
+  if (auto opResult = dyn_cast<OpResult>(value)) {
+    return opResult.getOwner();
+  }
+  return value.getParentBlock()->getParentOp();
+}
+
+// Returns the op that propagates through `use`, same as `notifyUsersModified`
+// in basic propagation.
+Operation* getPropagatingUser(OpOperand& use) {
+  if (auto dataFlowEdge = DataFlowEdgeOp::lookup(use)) {
+    return dataFlowEdge;
+  }
+  Operation* user = use.getOwner();
+  if (user->hasTrait<OpTrait::IsTerminator>()) {
+    return user->getParentOp();
+  }
+  return user;
+}
+
+// Returns the SCCs of the graph with the given `successors` in reverse
+// topological order, using an iterative version of Tarjan's algorithm. Each SCC
+// holds its nodes in increasing order.
+SmallVector<SmallVector<int64_t>> getSCCsInReverseTopologicalOrder(
+    ArrayRef<SmallVector<int64_t>> successors) {
+  constexpr int64_t kUnvisited = -1;
+  int64_t numNodes = successors.size();
+  SmallVector<int64_t> index(numNodes, kUnvisited);
+  SmallVector<int64_t> lowLink(numNodes, 0);
+  llvm::BitVector onStack(numNodes);
+  SmallVector<int64_t> stack;
+  // Each frame holds a node and the position of its next successor to visit.
+  SmallVector<std::pair<int64_t, int64_t>> callStack;
+  SmallVector<SmallVector<int64_t>> sccs;
+  int64_t nextIndex = 0;
+
+  auto visit = [&](int64_t node) {
+    index[node] = lowLink[node] = nextIndex++;
+    stack.push_back(node);
+    onStack.set(node);
+    callStack.push_back({node, 0});
+  };
+
+  for (int64_t root = 0; root < numNodes; ++root) {
+    if (index[root] != kUnvisited) {
+      continue;
+    }
+    visit(root);
+    while (!callStack.empty()) {
+      auto& [node, nextSuccessor] = callStack.back();
+      if (nextSuccessor < static_cast<int64_t>(successors[node].size())) {
+        int64_t successor = successors[node][nextSuccessor++];
+        if (index[successor] == kUnvisited) {
+          // NOTE: this invalidates `node` and `nextSuccessor`.
+          visit(successor);
+        } else if (onStack.test(successor)) {
+          lowLink[node] = std::min(lowLink[node], index[successor]);
+        }
+        continue;
+      }
+
+      int64_t finished = node;
+      callStack.pop_back();
+      if (!callStack.empty()) {
+        int64_t parent = callStack.back().first;
+        lowLink[parent] = std::min(lowLink[parent], lowLink[finished]);
+      }
+      if (lowLink[finished] == index[finished]) {
+        SmallVector<int64_t>& scc = sccs.emplace_back();
+        int64_t member;
+        do {
+          member = stack.pop_back_val();
+          onStack.reset(member);
+          scc.push_back(member);
+        } while (member != finished);
+        llvm::sort(scc);
+      }
+    }
+  }
+  return sccs;
+}
+
+}  // namespace
+
+PropagationScheduler::PropagationScheduler(ModuleOp moduleOp)
+    : PropagationScheduler(
+          llvm::to_vector(moduleOp.getOps<func::FuncOp>())) {}
+
+PropagationScheduler::PropagationScheduler(ArrayRef<func::FuncOp> funcOps) {
+  for (func::FuncOp funcOp : funcOps) {
+    funcOp.getBody().walk<WalkOrder::PreOrder>([&](Operation* op) {
+      if (!op->hasTrait<OpTrait::IsTerminator>()) {
+        opToIndex.try_emplace(op, ops.size());
+        ops.push_back(op);
+      }
+    });
+  }
+
+  SmallVector<SmallVector<int64_t>> successors(ops.size());
+  for (func::FuncOp funcOp : funcOps) {
+    funcOp.getBody().walk([&](Operation* op) {
+      for (OpOperand& use : op->getOpOperands()) {
+        auto producer = opToIndex.find(getShardingHolder(use.get()));
+        auto consumer = opToIndex.find(getPropagatingUser(use));
+        // An op never needs to be revisited due to its own sharding changes.
+        if (producer != opToIndex.end() && consumer != opToIndex.end() &&
+            producer->second != consumer->second) {
+          successors[producer->second].push_back(consumer->second);
+        }
+      }
+    });
+  }
+  for (SmallVector<int64_t>& nodeSuccessors : successors) {
+    llvm::sort(nodeSuccessors);
+    nodeSuccessors.erase(
+        std::unique(nodeSuccessors.begin(), nodeSuccessors.end()),
+        nodeSuccessors.end());
+  }
+
+  sccs = getSCCsInReverseTopologicalOrder(successors);
+  std::reverse(sccs.begin(), sccs.end());
+  dirty.resize(ops.size(), true);
+  saturated.resize(ops.size(), false);
+}
+
+void PropagationScheduler::markDirty(Operation* op) {
+  if (auto it = opToIndex.find(op);
+      it != opToIndex.end() && !saturated.test(it->second)) {
+    dirty.set(it->second);
+  }
+}
+
+void PropagationScheduler::markSaturated(Operation* op) {
+  if (auto it = opToIndex.find(op); it != opToIndex.end()) {
+    saturated.set(it->second);
+    dirty.reset(it->second);
+  }
+}
+
+LogicalResult PropagationScheduler::runSCC(
+    ArrayRef<int64_t> scc, bool forward,
+    llvm::function_ref<void(Operation*)> propagateOp) {
+  auto visitDirtyOps = [&]() {
+    bool anyVisited = false;
+    auto visit = [&](int64_t index) {
+      if (!dirty.test(index)) {
+        return;
+      }
+      dirty.reset(index);
+      ++numVisits;
+      propagateOp(ops[index]);
+      anyVisited = true;
+    };
+    if (forward) {
+      llvm::for_each(scc, visit);
+    } else {
+      llvm::for_each(llvm::reverse(scc), visit);
+    }
+    return anyVisited;
+  };
+
+  if (scc.size() == 1) {
+    visitDirtyOps();
+    return success();
+  }
+  for (int64_t iteration = 0; iteration < kMaxIterations; ++iteration) {
+    if (!visitDirtyOps()) {
+      return success();
+    }
+  }
+  return failure();
+}
+
+LogicalResult PropagationScheduler::run(
+    llvm::function_ref<void(Operation*)> propagateOp) {
+  bool forward = true;
+  for (int64_t sweep = 0; dirty.any(); ++sweep) {
+    if (sweep == kMaxIterations) {
+      return failure();
+    }
+    auto runSCCs = [&](auto&& orderedSCCs) -> LogicalResult {
+      for (ArrayRef<int64_t> scc : orderedSCCs) {
+        if (failed(runSCC(scc, forward, propagateOp))) {
+          return failure();
+        }
+      }
+      return success();
+    };
+    if (failed(forward ? runSCCs(sccs) : runSCCs(llvm::reverse(sccs)))) {
+      return failure();
+    }
+    forward = !forward;
+  }
+  return success();
+}
+
+SmallVector<SmallVector<Operation*>> PropagationScheduler::getSCCs() const {
+  return llvm::map_to_vector(sccs, [&](ArrayRef<int64_t> scc) {
+    return llvm::map_to_vector(scc,
+                               [&](int64_t index) { return ops[index]; });
+  });
+}
+
+}  // namespace sdy
+}  // namespace mlir
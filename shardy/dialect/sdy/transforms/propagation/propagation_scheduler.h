@@ -0,0 +1,111 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PROPAGATION_SCHEDULER_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PROPAGATION_SCHEDULER_H_
+
+#include <cstdint>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+namespace sdy {
+
+// Schedules the ops that propagation goes through, such that shardings flow
+// along the def-use graph with as few revisits as possible.
+//
+// The def-use graph has an edge from op A to op B if B uses a value whose
+// sharding is held by A, where:
+// - The sharding of a target of an `sdy.data_flow_edge` (e.g. a while block
+//   argument) is held by the edge, and the edge uses all of its sources (e.g.
+//   the while operand and the yielded value).
+// - Any other use in a terminator is a use by the parent op.
+//
+// The graph is condensed into strongly connected components (SCCs), which are
+// sorted topologically. Propagation then goes through the SCCs in alternating
+// forward (topological) and backward (reverse topological) sweeps, and only
+// iterates to a fixed point within cyclic SCCs (e.g., the body of a while
+// loop). Only ops that were marked dirty, i.e., whose operands or results
+// changed since they were last propagated through, are visited.
+//
+// On an acyclic graph, shardings that flow forward are fully propagated in the
+// first sweep, and shardings that flow backward in the second, so each op is
+// visited about twice.
+class PropagationScheduler {
+ public:
+  // The maximum number of sweeps, and of iterations within a cyclic SCC in a
+  // single sweep, before propagation is considered to not converge.
+  static constexpr int64_t kMaxIterations = 100;
+
+  // Builds the def-use graph of all ops in the bodies of `funcOps`, except
+  // terminators, and marks all of them as dirty.
+  explicit PropagationScheduler(ArrayRef<func::FuncOp> funcOps);
+
+  // Same as above, for all functions in `moduleOp`.
+  explicit PropagationScheduler(ModuleOp moduleOp);
+
+  // Marks `op` to be propagated through again. Ops that aren't scheduled, e.g.
+  // functions, and saturated ops are ignored.
+  void markDirty(Operation* op);
+
+  // Drops `op` from the schedule permanently, e.g. since propagating through
+  // it can no longer update any sharding.
+  void markSaturated(Operation* op);
+
+  // Calls `propagateOp` on dirty ops in alternating forward and backward
+  // sweeps, until no op is dirty. An op is no longer dirty right before
+  // `propagateOp` is called on it, and `propagateOp` should mark all ops that
+  // are affected by sharding changes as dirty.
+  //
+  // Returns failure if an SCC or the sweeps didn't converge after
+  // `kMaxIterations`.
+  LogicalResult run(llvm::function_ref<void(Operation*)> propagateOp);
+
+  // Returns the number of times `propagateOp` was called by `run`.
+  int64_t getNumVisits() const { return numVisits; }
+
+  // Returns the SCCs of the def-use graph in topological order, where each SCC
+  // holds its ops in program order.
+  SmallVector<SmallVector<Operation*>> getSCCs() const;
+
+ private:
+  // Visits the dirty ops in `scc` in program order if `forward` is true, or in
+  // reverse order otherwise. If `scc` is cyclic, repeats until none of its ops
+  // are dirty.
+  LogicalResult runSCC(ArrayRef<int64_t> scc, bool forward,
+                       llvm::function_ref<void(Operation*)> propagateOp);
+
+  // The scheduled ops in program order, and their index in `ops`.
+  SmallVector<Operation*> ops;
+  llvm::DenseMap<Operation*, int64_t> opToIndex;
+  // The SCCs in topological order, each holding op indices in program order.
+  SmallVector<SmallVector<int64_t>> sccs;
+  llvm::BitVector dirty;
+  llvm::BitVector saturated;
+  int64_t numVisits = 0;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_PROPAGATION_SCHEDULER_H_
@@ -0,0 +1,212 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/propagation_scheduler.h"
+
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::SizeIs;
+
+class PropagationSchedulerTest : public PropagationTestBase {};
+
+// Returns the ops in the body of the main function, excluding the terminator.
+SmallVector<Operation*> getMainOps(ModuleOp module) {
+  auto mainFn = cast<func::FuncOp>(module.lookupSymbol("main"));
+  return llvm::map_to_vector(mainFn.getBody().front().without_terminator(),
+                             [](Operation& op) { return &op; });
+}
+
+TEST_F(PropagationSchedulerTest, ChainVisitedOnceInProgramOrder) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8xf32>
+      %1 = stablehlo.negate %0 : tensor<8xf32>
+      %2 = stablehlo.negate %1 : tensor<8xf32>
+      return %2 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  SmallVector<Operation*> ops = getMainOps(*module);
+  PropagationScheduler scheduler(*module);
+  EXPECT_THAT(scheduler.getSCCs(),
+              ElementsAre(ElementsAre(ops[0]), ElementsAre(ops[1]),
+                          ElementsAre(ops[2])));
+
+  SmallVector<Operation*> visited;
+  ASSERT_TRUE(succeeded(
+      scheduler.run([&](Operation* op) { visited.push_back(op); })));
+  EXPECT_THAT(visited, ElementsAre(ops[0], ops[1], ops[2]));
+  EXPECT_EQ(scheduler.getNumVisits(), 3);
+}
+
+TEST_F(PropagationSchedulerTest, BackwardSweepVisitsDirtyOpsInReverse) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8xf32>
+      %1 = stablehlo.negate %0 : tensor<8xf32>
+      %2 = stablehlo.negate %1 : tensor<8xf32>
+      return %2 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  SmallVector<Operation*> ops = getMainOps(*module);
+  PropagationScheduler scheduler(*module);
+
+  // Simulates a sharding that flows backward from the last op, i.e., once the
+  // last op is visited, every op marks the op that defines its operand dirty.
+  SmallVector<Operation*> visited;
+  bool flowBackward = false;
+  ASSERT_TRUE(succeeded(scheduler.run([&](Operation* op) {
+    visited.push_back(op);
+    flowBackward |= op == ops[2];
+    if (flowBackward && op != ops[0]) {
+      scheduler.markDirty(op->getOperand(0).getDefiningOp());
+    }
+  })));
+  EXPECT_THAT(visited, ElementsAre(ops[0], ops[1], ops[2], ops[1], ops[0]));
+}
+
+TEST_F(PropagationSchedulerTest, SaturatedOpsAreNeverVisited) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = stablehlo.negate %arg0 : tensor<8xf32>
+      %1 = stablehlo.negate %0 : tensor<8xf32>
+      %2 = stablehlo.negate %1 : tensor<8xf32>
+      return %2 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  SmallVector<Operation*> ops = getMainOps(*module);
+  PropagationScheduler scheduler(*module);
+  scheduler.markSaturated(ops[1]);
+
+  // The last op keeps marking the middle op dirty, which is ignored.
+  SmallVector<Operation*> visited;
+  ASSERT_TRUE(succeeded(scheduler.run([&](Operation* op) {
+    visited.push_back(op);
+    if (op == ops[2]) {
+      scheduler.markDirty(ops[1]);
+    }
+  })));
+  EXPECT_THAT(visited, ElementsAre(ops[0], ops[2]));
+}
+
+TEST_F(PropagationSchedulerTest, WhileBodyFormsCyclicSCC) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = stablehlo.constant dense<0> : tensor<i32>
+      %1:2 = stablehlo.while(%iterArg = %arg0, %iterArg_1 = %0) : tensor<8xf32>, tensor<i32>
+        cond {
+        %4 = stablehlo.compare LT, %iterArg_1, %iterArg_1 : (tensor<i32>, tensor<i32>) -> tensor<i1>
+        stablehlo.return %4 : tensor<i1>
+      } do {
+        %4 = stablehlo.negate %iterArg : tensor<8xf32>
+        stablehlo.return %4, %iterArg_1 : tensor<8xf32>, tensor<i32>
+      }
+      %2 = sdy.data_flow_edge %1#0 : tensor<8xf32>
+      %3 = sdy.data_flow_edge %1#1 : tensor<i32>
+      return %2 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  SmallVector<Operation*> ops = getMainOps(*module);
+  auto whileOp = cast<stablehlo::WhileOp>(ops[1]);
+  Operation* negateOp = &whileOp.getBody().front().front();
+  Operation* edge0 = ops[2];
+  PropagationScheduler scheduler(*module);
+
+  SmallVector<SmallVector<Operation*>> sccs = scheduler.getSCCs();
+  auto negateScc = llvm::find_if(sccs, [&](ArrayRef<Operation*> scc) {
+    return llvm::is_contained(scc, negateOp);
+  });
+  ASSERT_NE(negateScc, sccs.end());
+  EXPECT_THAT(*negateScc, ElementsAre(negateOp, edge0));
+
+  // The negate and the edge keep marking each other dirty a few times, which
+  // is resolved within the SCC in a single sweep.
+  int64_t remainingUpdates = 3;
+  SmallVector<Operation*> visited;
+  ASSERT_TRUE(succeeded(scheduler.run([&](Operation* op) {
+    visited.push_back(op);
+    if ((op == negateOp || op == edge0) && remainingUpdates > 0) {
+      --remainingUpdates;
+      scheduler.markDirty(op == negateOp ? edge0 : negateOp);
+    }
+  })));
+  EXPECT_EQ(llvm::count(visited, negateOp), 2);
+  EXPECT_EQ(llvm::count(visited, edge0), 2);
+  EXPECT_THAT(visited, SizeIs(scheduler.getNumVisits()));
+}
+
+TEST_F(PropagationSchedulerTest, NonConvergingSCCFails) {
+  const std::string program = R"mlir(
+    func.func @main(%arg0: tensor<8xf32>) -> tensor<8xf32> {
+      %0 = stablehlo.while(%iterArg = %arg0) : tensor<8xf32>
+        cond {
+        %c = stablehlo.constant dense<true> : tensor<i1>
+        stablehlo.return %c : tensor<i1>
+      } do {
+        %2 = stablehlo.negate %iterArg : tensor<8xf32>
+        stablehlo.return %2 : tensor<8xf32>
+      }
+      %1 = sdy.data_flow_edge %0 : tensor<8xf32>
+      return %1 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto whileOp = cast<stablehlo::WhileOp>(getMainOps(*module)[0]);
+  Operation* negateOp = &whileOp.getBody().front().front();
+  Operation* edge = getMainOps(*module)[1];
+  PropagationScheduler scheduler(*module);
+
+  EXPECT_TRUE(failed(scheduler.run([&](Operation* op) {
+    if (op == negateOp) {
+      scheduler.markDirty(edge);
+    } else if (op == edge) {
+      scheduler.markDirty(negateOp);
+    }
+  })));
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
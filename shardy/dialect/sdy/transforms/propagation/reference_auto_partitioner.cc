@@ -0,0 +1,212 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <memory>  // IWYU pragma: keep
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BlockSupport.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"  // IWYU pragma: keep
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/auto_partitioner_registry.h"
+#include "shardy/dialect/sdy/transforms/propagation/passes.h"  // IWYU pragma: keep
+#include "shardy/dialect/sdy/transforms/propagation/sharding_evaluation.h"
+
+namespace mlir {
+namespace sdy {
+
+#define GEN_PASS_DEF_REFERENCEAUTOPARTITIONPASS
+#include "shardy/dialect/sdy/transforms/propagation/passes.h.inc"
+
+namespace {
+
+using func::FuncOp;
+using Clock = std::chrono::steady_clock;
+
+// A function argument whose sharding is chosen by the partitioner, and the
+// shardings it can be assigned, where the first candidate is always null
+// (i.e., left for propagation to decide).
+struct ArgCandidates {
+  BlockArgument arg;
+  SmallVector<TensorShardingAttr> shardings;
+};
+
+// Returns the mesh named `meshName`, or the first mesh in `moduleOp` that has
+// more than one device if `meshName` is empty.
+MeshOp getPartitioningMesh(ModuleOp moduleOp, const SymbolTable& symbolTable,
+                           StringRef meshName) {
+  if (!meshName.empty()) {
+    return symbolTable.lookup<MeshOp>(meshName);
+  }
+  for (MeshOp meshOp : moduleOp.getOps<MeshOp>()) {
+    if (!meshOp.getMesh().empty() && !meshOp.getMesh().isMaximal()) {
+      return meshOp;
+    }
+  }
+  return nullptr;
+}
+
+// Returns true if `sharding` leaves all dimensions for propagation to decide,
+// i.e., it's null or all dimension shardings are open and empty.
+bool isUnannotated(TensorShardingAttr sharding) {
+  return !sharding ||
+         llvm::all_of(sharding.getDimShardings(), [](DimensionShardingAttr d) {
+           return !d.getIsClosed() && d.emptyAxes();
+         });
+}
+
+// Returns the candidate shardings of each unannotated function argument in
+// `moduleOp`, sorted by decreasing argument size, so larger arguments are
+// decided first.
+//
+// The candidates of an argument are: no sharding, and sharding a single
+// dimension along a single axis of `meshOp` that evenly divides it.
+SmallVector<ArgCandidates> getArgCandidates(ModuleOp moduleOp, MeshOp meshOp) {
+  MLIRContext* context = moduleOp.getContext();
+  MeshAttr mesh = meshOp.getMesh();
+  SmallVector<std::pair<int64_t, ArgCandidates>> sizeAndCandidates;
+  for (FuncOp funcOp : moduleOp.getOps<FuncOp>()) {
+    if (funcOp.isExternal()) {
+      continue;
+    }
+    for (BlockArgument arg : funcOp.getArguments()) {
+      auto tensorType = dynCastStaticShapedType(arg.getType());
+      if (!tensorType || !isUnannotated(getSharding(arg))) {
+        continue;
+      }
+      ArgCandidates candidates{arg, {TensorShardingAttr()}};
+      TensorShardingAttr fullyOpen = TensorShardingAttr::getFullyOpen(
+          context, tensorType.getRank(), meshOp.getSymName());
+      for (auto [dim, dimSize] : llvm::enumerate(tensorType.getShape())) {
+        for (MeshAxisAttr axis : mesh.getAxes()) {
+          if (axis.getSize() > 1 && dimSize % axis.getSize() == 0) {
+            candidates.shardings.push_back(
+                fullyOpen.getSharded(dim, axis.getName()));
+          }
+        }
+      }
+      if (candidates.shardings.size() > 1) {
+        sizeAndCandidates.emplace_back(tensorType.getNumElements(),
+                                       std::move(candidates));
+      }
+    }
+  }
+  llvm::stable_sort(sizeAndCandidates, [](const auto& a, const auto& b) {
+    return a.first > b.first;
+  });
+  return llvm::map_to_vector(sizeAndCandidates,
+                             [](auto& pair) { return std::move(pair.second); });
+}
+
+struct ReferenceAutoPartitionPass
+    : public impl::ReferenceAutoPartitionPassBase<ReferenceAutoPartitionPass> {
+  using ReferenceAutoPartitionPassBase::ReferenceAutoPartitionPassBase;
+
+  void runOnOperation() final {
+    ModuleOp moduleOp = getOperation();
+    SymbolTable symbolTable(moduleOp);
+    MeshOp meshOp = getPartitioningMesh(moduleOp, symbolTable, meshName);
+    if (!meshOp) {
+      if (!meshName.empty()) {
+        moduleOp.emitError("unknown mesh: ") << meshName.getValue();
+        signalPassFailure();
+      }
+      return;
+    }
+    MeshAttr mesh = meshOp.getMesh();
+    SmallVector<ArgCandidates> argCandidates =
+        getArgCandidates(moduleOp, meshOp);
+
+    ShardingEvaluator evaluator(moduleOp, mesh);
+
+    // Returns the candidate shardings chosen by `choice`.
+    auto getCandidate = [&](ArrayRef<int64_t> choice) {
+      ShardingCandidate candidate;
+      for (auto [candidates, candidateIndex] :
+           llvm::zip_equal(argCandidates, choice)) {
+        candidate.emplace_back(candidates.arg,
+                               candidates.shardings[candidateIndex]);
+      }
+      return candidate;
+    };
+
+    // Greedy coordinate descent: each sweep tries all candidates of one
+    // argument at a time, keeping the others fixed, and keeps the best
+    // candidate only if it strictly reduces the cost. The candidates of an
+    // argument are evaluated concurrently. Stops when a sweep doesn't improve
+    // the cost or the time budget is exceeded.
+    Clock::time_point deadline =
+        Clock::now() + std::chrono::milliseconds(timeBudgetMs);
+    SmallVector<int64_t> bestChoice(argCandidates.size(), 0);
+    ShardingEvaluation best = evaluator.evaluate(getCandidate(bestChoice));
+    bool improved = true;
+    while (improved && Clock::now() < deadline) {
+      improved = false;
+      for (auto [argIndex, candidates] : llvm::enumerate(argCandidates)) {
+        if (Clock::now() >= deadline) {
+          break;
+        }
+        SmallVector<SmallVector<int64_t>> choices;
+        for (int64_t candidateIndex :
+             llvm::seq<int64_t>(candidates.shardings.size())) {
+          if (candidateIndex != bestChoice[argIndex]) {
+            choices.push_back(bestChoice);
+            choices.back()[argIndex] = candidateIndex;
+          }
+        }
+        SmallVector<ShardingEvaluation> evaluations = evaluator.evaluateAll(
+            llvm::map_to_vector(choices, [&](ArrayRef<int64_t> choice) {
+              return getCandidate(choice);
+            }));
+        for (auto [choice, evaluation] :
+             llvm::zip_equal(choices, evaluations)) {
+          if (evaluation.getCost() < best.getCost()) {
+            best = std::move(evaluation);
+            bestChoice = choice;
+            improved = true;
+          }
+        }
+      }
+    }
+
+    best.shardings.commit();
+  }
+};
+
+}  // namespace
+
+void registerReferenceAutoPartitioner() {
+  AutoPartitionerRegistry::setCallback(
+      [](OpPassManager& pm) { pm.addPass(createReferenceAutoPartitionPass()); },
+      [](DialectRegistry& registry) { registry.insert<SdyDialect>(); });
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,50 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/reshard_cost_model.h"
+
+#include <cstdint>
+
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+// Returns the total size of `axes`.
+int64_t getTotalAxesSize(ArrayRef<AxisRefAttr> axes, MeshAttr mesh) {
+  int64_t totalSize = 1;
+  for (AxisRefAttr axis : axes) {
+    totalSize *= axis.getSize(mesh);
+  }
+  return totalSize;
+}
+
+}  // namespace
+
+int64_t BytesReshardCostModel::getReshardCost(const LosingTensor& losingTensor,
+                                              MeshAttr mesh) const {
+  int64_t localSize =
+      getLocalSizeInBytes(losingTensor.tensor, losingTensor.factorSizes,
+                          losingTensor.elementBitWidth, mesh);
+  return localSize * (getTotalAxesSize(losingTensor.axes, mesh) - 1);
+}
+
+}  // namespace sdy
+}  // namespace mlir
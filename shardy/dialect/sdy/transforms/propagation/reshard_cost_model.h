@@ -0,0 +1,75 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_RESHARD_COST_MODEL_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_RESHARD_COST_MODEL_H_
+
+#include <cstdint>
+
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+// A tensor on the losing side of a conflict across factors, i.e., a source of
+// the sharding along a factor that isn't propagated since the factor lost the
+// conflict. Such a tensor needs to be resharded, as the tensors its sharding
+// isn't propagated to are sharded differently.
+struct LosingTensor {
+  // The factor shardings of the tensor.
+  const TensorFactorShardings& tensor;
+  // The factor that lost the conflict.
+  int64_t factorIndex;
+  // The axes that aren't propagated along `factorIndex`, which are a prefix of
+  // the axes of the tensor along that factor.
+  ArrayRef<AxisRefAttr> axes;
+  // The size of each factor of the tensor's op.
+  ArrayRef<int64_t> factorSizes;
+  // The bit width of a single element of the tensor.
+  int64_t elementBitWidth;
+};
+
+// An interface for estimating the cost of resharding a tensor on the losing
+// side of a conflict across factors.
+//
+// Users can override this interface to plug a different cost model into
+// `CostBasedFactorPropagation`.
+class ReshardCostModel {
+ public:
+  virtual ~ReshardCostModel() = default;
+
+  // Returns the estimated cost of resharding `losingTensor`. The cost must be
+  // non-negative, and costs of different tensors are summed.
+  virtual int64_t getReshardCost(const LosingTensor& losingTensor,
+                                 MeshAttr mesh) const = 0;
+};
+
+// The default cost model, which estimates the number of bytes each device
+// receives when the losing tensor is all-gathered along the lost axes.
+//
+// If the losing tensor has a local size of S bytes, and the lost axes have a
+// total size of N, each device needs to receive S * (N - 1) bytes.
+class BytesReshardCostModel : public ReshardCostModel {
+ public:
+  int64_t getReshardCost(const LosingTensor& losingTensor,
+                         MeshAttr mesh) const override;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_RESHARD_COST_MODEL_H_
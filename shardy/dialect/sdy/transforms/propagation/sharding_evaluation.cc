@@ -0,0 +1,211 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/sharding_evaluation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/ValueRange.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/memory_estimation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir {
+namespace sdy {
+
+namespace {
+
+using func::FuncOp;
+
+// Returns the axes that `factorIndex` is sharded on in the first tensor in
+// `tensors` that is mapped to it, or std::nullopt if there is no such tensor.
+std::optional<ArrayRef<AxisRefAttr>> getFirstFactorAxes(
+    ArrayRef<TensorFactorShardings> tensors, int64_t factorIndex) {
+  for (const TensorFactorShardings& tensor : tensors) {
+    if (auto it = tensor.factorIndexToSharding.find(factorIndex);
+        it != tensor.factorIndexToSharding.end()) {
+      return ArrayRef<AxisRefAttr>(it->second.axisRefs);
+    }
+  }
+  return std::nullopt;
+}
+
+int64_t getAxesSize(ArrayRef<AxisRefAttr> axes, MeshAttr mesh) {
+  int64_t size = 1;
+  for (AxisRefAttr axis : axes) {
+    size *= axis.getSize(mesh);
+  }
+  return size;
+}
+
+}  // namespace
+
+// Returns true if `op` is a gather and `factorIndex` is mapped to its input
+// but not to its result, i.e., it's a collapsed or sliced dimension. If the
+// input is sharded along such a factor, each shard gathers the indices within
+// its range (and zero otherwise), and the partial results are all-reduced, as
+// for a reduction factor.
+bool isGatherInputOnlyFactor(Operation* op,
+                             const ShardingProjection& projection,
+                             int64_t factorIndex) {
+  return isa<stablehlo::GatherOp>(op) &&
+         projection.getOperand(0).factorIndexToSharding.contains(
+             factorIndex) &&
+         !getFirstFactorAxes(projection.getResults(), factorIndex);
+}
+
+int64_t estimateCommunicationBytes(Operation* op,
+                                   OpShardingRuleAttr shardingRule,
+                                   const ShardingSideTable& sideTable,
+                                   MeshAttr mesh) {
+  auto getShardings = [&](ValueRange values) {
+    return llvm::map_to_vector(values, [&](Value value) {
+      return sideTable.getSharding(value);
+    });
+  };
+  ShardingProjection projection =
+      ShardingProjection::build(getShardings(op->getOperands()),
+                                getShardings(op->getResults()), shardingRule,
+                                mesh);
+  ArrayRef<int64_t> factorSizes = shardingRule.getFactorSizes();
+  SmallVector<int64_t> elementBitWidths = getTensorElementBitWidths(
+      op, projection.getNumOperands(), projection.getNumResults());
+  auto getLocalSize = [&](const TensorFactorShardings& tensor,
+                          int64_t tensorIndex) {
+    return getLocalSizeInBytes(tensor, factorSizes,
+                               elementBitWidths[tensorIndex], mesh);
+  };
+
+  int64_t cost = 0;
+  for (int64_t factorIndex = 0; factorIndex < shardingRule.getNumFactors();
+       ++factorIndex) {
+    if (shardingRule.isReductionFactor(factorIndex) ||
+        isGatherInputOnlyFactor(op, projection, factorIndex)) {
+      std::optional<ArrayRef<AxisRefAttr>> axes =
+          getFirstFactorAxes(projection.getOperands(), factorIndex);
+      int64_t numShards = axes ? getAxesSize(*axes, mesh) : 1;
+      if (numShards == 1) {
+        continue;
+      }
+      for (auto [resultIndex, result] :
+           llvm::enumerate(projection.getResults())) {
+        int64_t localSize =
+            getLocalSize(result, projection.getNumOperands() + resultIndex);
+        cost += 2 * localSize * (numShards - 1) / numShards;
+      }
+      continue;
+    }
+
+    std::optional<ArrayRef<AxisRefAttr>> resultAxes =
+        getFirstFactorAxes(projection.getResults(), factorIndex);
+    if (!resultAxes) {
+      continue;
+    }
+    int64_t resultSize = getAxesSize(*resultAxes, mesh);
+    for (auto [operandIndex, operand] :
+         llvm::enumerate(projection.getOperands())) {
+      auto it = operand.factorIndexToSharding.find(factorIndex);
+      if (it == operand.factorIndexToSharding.end()) {
+        continue;
+      }
+      ArrayRef<AxisRefAttr> operandAxes = it->second.axisRefs;
+      if (isAxisListPrefixOf(operandAxes, *resultAxes) !=
+          PrefixStatus::NOT_A_PREFIX) {
+        continue;
+      }
+      int64_t operandSize = getAxesSize(operandAxes, mesh);
+      int64_t localSize = getLocalSize(operand, operandIndex);
+      cost += operandSize > resultSize
+                  ? localSize * (operandSize / resultSize - 1)
+                  : localSize;
+    }
+  }
+  return cost;
+}
+
+ShardingEvaluator::ShardingEvaluator(ModuleOp moduleOp, MeshAttr mesh)
+    : moduleOp(moduleOp),
+      mesh(mesh),
+      symbolTable(moduleOp),
+      shardingGroupMap(moduleOp),
+      propagation(symbolTable, shardingGroupMap, factorPropagation) {
+  // Candidates are evaluated concurrently, so the cache of sharding rules must
+  // not be modified while they are.
+  propagation.cacheShardingRules(moduleOp);
+}
+
+void ShardingEvaluator::estimateCost(ShardingEvaluation& evaluation) const {
+  const ShardingSideTable& sideTable = evaluation.shardings;
+  GetShardingFn getShardingFn = [&](Value value) {
+    return sideTable.getSharding(value);
+  };
+  for (FuncOp funcOp : moduleOp.getOps<FuncOp>()) {
+    if (funcOp.isExternal()) {
+      continue;
+    }
+    funcOp.walk([&](Operation* op) {
+      // Candidates are evaluated concurrently, so the lookup must not modify
+      // the cache.
+      if (OpShardingRuleAttr shardingRule =
+              propagation.getCachedShardingRule(op)) {
+        evaluation.communicationBytes +=
+            estimateCommunicationBytes(op, shardingRule, sideTable, mesh);
+      }
+    });
+    evaluation.peakMemoryBytes +=
+        estimatePeakMemory(funcOp, symbolTable, /*topN=*/0, getShardingFn)
+            .peakSizeInBytes;
+  }
+}
+
+ShardingEvaluation ShardingEvaluator::evaluate(
+    const ShardingCandidate& candidate) const {
+  ShardingEvaluation evaluation;
+  for (auto [value, sharding] : candidate) {
+    if (sharding) {
+      evaluation.shardings.setSharding(value, sharding);
+    }
+  }
+  (void)propagation.propagate(moduleOp, evaluation.shardings);
+  estimateCost(evaluation);
+  return evaluation;
+}
+
+SmallVector<ShardingEvaluation> ShardingEvaluator::evaluateAll(
+    ArrayRef<ShardingCandidate> candidates) const {
+  SmallVector<ShardingEvaluation> evaluations(candidates.size());
+  parallelFor(moduleOp.getContext(), 0, candidates.size(),
+              [&](size_t index) {
+                evaluations[index] = evaluate(candidates[index]);
+              });
+  return evaluations;
+}
+
+}  // namespace sdy
+}  // namespace mlir
@@ -0,0 +1,103 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SHARDING_EVALUATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SHARDING_EVALUATION_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/basic_factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+
+namespace mlir {
+namespace sdy {
+
+// A candidate set of shardings to evaluate, e.g., for function arguments or
+// the results of sharding constraints. Each non-null sharding replaces the one
+// in the IR before propagation.
+using ShardingCandidate = SmallVector<std::pair<Value, TensorShardingAttr>>;
+
+// The result of propagating from a `ShardingCandidate`.
+struct ShardingEvaluation {
+  // The shardings after propagation, on top of the shardings in the IR.
+  ShardingSideTable shardings;
+  // The estimated per-device communication of all ops, in bytes.
+  int64_t communicationBytes = 0;
+  // The estimated peak per-device memory, summed over all functions, in bytes.
+  int64_t peakMemoryBytes = 0;
+
+  int64_t getCost() const { return communicationBytes + peakMemoryBytes; }
+};
+
+// Returns the estimated per-device communication in bytes needed by `op`
+// with the shardings in `sideTable`, according to `shardingRule`.
+//
+// For each reduction factor that is sharded, every result needs an all-reduce,
+// which sends and receives twice its local size. For any other factor, every
+// operand that is sharded differently than the results along that factor needs
+// a reshard:
+// - If the operand is sharded along a prefix of the result axes, a local slice
+//   is free.
+// - If the operand is more sharded, it needs an all-gather.
+// - Otherwise, it needs an all-to-all, which moves the entire local operand.
+int64_t estimateCommunicationBytes(Operation* op,
+                                   OpShardingRuleAttr shardingRule,
+                                   const ShardingSideTable& sideTable,
+                                   MeshAttr mesh);
+
+// Evaluates candidate shardings of a module without modifying it, by
+// propagating from each candidate on its own `ShardingSideTable` and
+// estimating the cost of the result.
+//
+// The module must not be modified while the evaluator is alive.
+class ShardingEvaluator {
+ public:
+  // Creates an evaluator for `moduleOp`, whose communication is estimated
+  // w.r.t. `mesh`. All sharding rules are created once up front.
+  ShardingEvaluator(ModuleOp moduleOp, MeshAttr mesh);
+
+  // Propagates from `candidate` and returns the resulting shardings and cost.
+  ShardingEvaluation evaluate(const ShardingCandidate& candidate) const;
+
+  // Same as above for each candidate in `candidates`, which are evaluated
+  // concurrently on the thread pool of the context.
+  SmallVector<ShardingEvaluation> evaluateAll(
+      ArrayRef<ShardingCandidate> candidates) const;
+
+ private:
+  // Sets the cost estimates of `evaluation` w.r.t. its shardings.
+  void estimateCost(ShardingEvaluation& evaluation) const;
+
+  ModuleOp moduleOp;
+  MeshAttr mesh;
+  SymbolTable symbolTable;
+  ShardingGroupMap shardingGroupMap;
+  BasicFactorPropagation factorPropagation;
+  SideTablePropagation propagation;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SHARDING_EVALUATION_H_
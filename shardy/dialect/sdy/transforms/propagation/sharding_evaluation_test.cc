@@ -0,0 +1,192 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/sharding_evaluation.h"
+
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/AsmParser/AsmParser.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/testing_utils.h"
+#include <gtest/gtest.h>
+
+namespace mlir {
+namespace sdy {
+namespace {
+
+class ShardingEvaluatorTest : public PropagationTestBase {
+ protected:
+  TensorShardingAttr parseSharding(const std::string& sharding) {
+    return cast<TensorShardingAttr>(parseAttribute(sharding, &context));
+  }
+};
+
+TEST_F(ShardingEvaluatorTest, CandidatesDontModifyModule) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x8xf32>, %arg1: tensor<8x8xf32>)
+        -> tensor<8x8xf32> {
+      %0 = stablehlo.add %arg0, %arg1 : tensor<8x8xf32>
+      %1 = stablehlo.negate %0 : tensor<8x8xf32>
+      return %1 : tensor<8x8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto mainFn = cast<func::FuncOp>(module->lookupSymbol("main"));
+  Value arg0 = mainFn.getArgument(0);
+  Value arg1 = mainFn.getArgument(1);
+  Operation* negateOp = mainFn.getBody().front().front().getNextNode();
+
+  auto mesh = cast<MeshOp>(module->lookupSymbol("mesh")).getMesh();
+  ShardingEvaluator evaluator(*module, mesh);
+  TensorShardingAttr shardedA =
+      parseSharding(R"(#sdy.sharding<@mesh, [{"a"}, {}]>)");
+  TensorShardingAttr shardedB =
+      parseSharding(R"(#sdy.sharding<@mesh, [{"b"}, {}]>)");
+  SmallVector<ShardingCandidate> candidates = {
+      {},
+      {{arg0, shardedA}, {arg1, shardedA}},
+      {{arg0, shardedA}, {arg1, shardedB}}};
+  SmallVector<ShardingEvaluation> evaluations =
+      evaluator.evaluateAll(candidates);
+  ASSERT_EQ(evaluations.size(), candidates.size());
+
+  // Nothing was set on the IR.
+  EXPECT_FALSE(getSharding(arg0));
+  EXPECT_FALSE(getSharding(negateOp->getResult(0)));
+
+  // No shardings means no communication, but more memory.
+  EXPECT_EQ(evaluations[0].communicationBytes, 0);
+  EXPECT_EQ(evaluations[1].communicationBytes, 0);
+  EXPECT_LT(evaluations[1].peakMemoryBytes, evaluations[0].peakMemoryBytes);
+  EXPECT_TRUE(evaluations[1].shardings.getSharding(negateOp->getResult(0)));
+  // Conflicting operand shardings need a reshard.
+  EXPECT_GT(evaluations[2].communicationBytes, 0);
+
+  // Evaluating concurrently gives the same result as one at a time.
+  for (auto [candidate, evaluation] :
+       llvm::zip_equal(candidates, evaluations)) {
+    ShardingEvaluation expected = evaluator.evaluate(candidate);
+    EXPECT_EQ(evaluation.communicationBytes, expected.communicationBytes);
+    EXPECT_EQ(evaluation.peakMemoryBytes, expected.peakMemoryBytes);
+    EXPECT_EQ(evaluation.shardings.getSharding(negateOp->getResult(0)),
+              expected.shardings.getSharding(negateOp->getResult(0)));
+  }
+}
+
+TEST_F(ShardingEvaluatorTest, ConcurrentCandidatesWithDataFlowEdges) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<i32>, %arg1: tensor<8x8xf32>,
+                    %arg2: tensor<8x8xf32>) -> tensor<8x8xf32> {
+      %0 = "stablehlo.case"(%arg0) ({
+        stablehlo.return %arg1 : tensor<8x8xf32>
+      }, {
+        stablehlo.return %arg2 : tensor<8x8xf32>
+      }) : (tensor<i32>) -> tensor<8x8xf32>
+      %1 = sdy.data_flow_edge %0 : tensor<8x8xf32>
+      %2 = stablehlo.negate %1 : tensor<8x8xf32>
+      %3 = sdy.propagation_barrier %2 allowed_direction=FORWARD
+          : tensor<8x8xf32>
+      return %3 : tensor<8x8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto mainFn = cast<func::FuncOp>(module->lookupSymbol("main"));
+  Value arg1 = mainFn.getArgument(1);
+  Value arg2 = mainFn.getArgument(2);
+  Operation* negateOp =
+      mainFn.getBody().front().front().getNextNode()->getNextNode();
+
+  auto mesh = cast<MeshOp>(module->lookupSymbol("mesh")).getMesh();
+  ShardingEvaluator evaluator(*module, mesh);
+  auto shardDim0 = [&](const std::string& dimAxes) {
+    return parseSharding("#sdy.sharding<@mesh, [" + dimAxes + ", {}]>");
+  };
+  // Many candidates, so that several are evaluated at the same time.
+  SmallVector<ShardingCandidate> candidates;
+  for (const char* axes1 : {"{}", R"({"a"})", R"({"b"})", R"({"a", "b"})"}) {
+    for (const char* axes2 : {"{}", R"({"a"})", R"({"b"})"}) {
+      candidates.push_back(
+          {{arg1, shardDim0(axes1)}, {arg2, shardDim0(axes2)}});
+    }
+  }
+  SmallVector<ShardingEvaluation> evaluations =
+      evaluator.evaluateAll(candidates);
+  ASSERT_EQ(evaluations.size(), candidates.size());
+
+  // Evaluating concurrently gives the same result as one at a time.
+  for (auto [candidate, evaluation] :
+       llvm::zip_equal(candidates, evaluations)) {
+    ShardingEvaluation expected = evaluator.evaluate(candidate);
+    EXPECT_EQ(evaluation.communicationBytes, expected.communicationBytes);
+    EXPECT_EQ(evaluation.peakMemoryBytes, expected.peakMemoryBytes);
+    EXPECT_EQ(evaluation.shardings.getSharding(negateOp->getResult(0)),
+              expected.shardings.getSharding(negateOp->getResult(0)));
+  }
+}
+
+TEST_F(ShardingEvaluatorTest, GatherWithInputShardedAlongCollapsedDim) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=2, "b"=2]>
+    func.func @main(%arg0: tensor<8x4xf32>, %arg1: tensor<2x1xi32>)
+        -> tensor<2x4xf32> {
+      %0 = "stablehlo.gather"(%arg0, %arg1) {
+        dimension_numbers = #stablehlo.gather<
+          offset_dims = [1],
+          collapsed_slice_dims = [0],
+          start_index_map = [0],
+          index_vector_dim = 1>,
+        slice_sizes = array<i64: 1, 4>,
+        indices_are_sorted = false
+      } : (tensor<8x4xf32>, tensor<2x1xi32>) -> tensor<2x4xf32>
+      return %0 : tensor<2x4xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  auto mainFn = cast<func::FuncOp>(module->lookupSymbol("main"));
+  Value arg0 = mainFn.getArgument(0);
+
+  auto mesh = cast<MeshOp>(module->lookupSymbol("mesh")).getMesh();
+  ShardingEvaluator evaluator(*module, mesh);
+  SmallVector<ShardingCandidate> candidates = {
+      {{arg0, parseSharding(R"(#sdy.sharding<@mesh, [{}, {"a"}]>)")}},
+      {{arg0, parseSharding(R"(#sdy.sharding<@mesh, [{"a"}, {}]>)")}}};
+  SmallVector<ShardingEvaluation> evaluations =
+      evaluator.evaluateAll(candidates);
+  ASSERT_EQ(evaluations.size(), candidates.size());
+
+  // Sharding the offset dimension is propagated to the result.
+  EXPECT_EQ(evaluations[0].communicationBytes, 0);
+  // Sharding the collapsed dimension needs an all-reduce of the result.
+  EXPECT_GT(evaluations[1].communicationBytes, 0);
+}
+
+}  // namespace
+}  // namespace sdy
+}  // namespace mlir
@@ -18,6 +18,8 @@ limitations under the License.
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <numeric>
 #include <optional>
 #include <utility>
@@ -260,23 +262,34 @@ void addRemainingAxes(SmallVector<AxisRefAttr>& currentAxes,
 }
 
 // Builds a `TensorFactorShardings` for a tensor with the specified
-// `optionalSharding` and `tensorMapping`.
+// `optionalSharding` and `tensorMapping` into `result`, reusing the memory it
+// already allocated.
 //
 // The high level algorithm for projecting a dimension sharding into factor
 // shardings is to add axes (or sub-axes) from the dimension sharding to the
 // current factor sharding (starting from the major-most factor and axis) until
 // the factor is fully sharded, which might require further splitting an axis,
 // or this is the minor-most factor, then moving to the next factor.
-TensorFactorShardings buildTensorFactorShardings(
-    TensorMappingAttr tensorMapping, TensorShardingAttr optionalSharding,
-    ArrayRef<int64_t> factorSizes, MeshAttr mesh, const bool closedIfMissing) {
-  TensorFactorShardings result;
+void buildTensorFactorShardings(
+    ArrayRef<ShardingRuleLayout::FactorPlacement> factors,
+    TensorShardingAttr optionalSharding, ArrayRef<int64_t> factorSizes,
+    MeshAttr mesh, const bool closedIfMissing, TensorFactorShardings& result) {
   auto& [factorIndexToSharding, replicatedAxes] = result;
+  factorIndexToSharding.clear();
+  replicatedAxes.clear();
   factorIndexToSharding.reserve(factorSizes.size());
 
   // 1. Populate factor shardings
-  for (const auto [dim, dimMapping] :
-       llvm::enumerate(tensorMapping.getDimMappings())) {
+  while (!factors.empty()) {
+    // The factors of each dimension are consecutive in `factors`.
+    const int64_t dim = factors.front().dim;
+    ArrayRef<ShardingRuleLayout::FactorPlacement> dimFactors =
+        factors.take_while(
+            [dim](const ShardingRuleLayout::FactorPlacement& factor) {
+              return factor.dim == dim;
+            });
+    factors = factors.drop_front(dimFactors.size());
+
     ArrayRef<AxisRefAttr> axes =
         optionalSharding ? optionalSharding.getDimSharding(dim).getAxes()
                          : ArrayRef<AxisRefAttr>();
@@ -290,9 +303,9 @@ TensorFactorShardings buildTensorFactorShardings(
     MLIRContext* ctx = mesh.getContext();
 
     bool hasOverflowAxes = false;
-    for (int64_t factorIndex : dimMapping.getFactorIndices()) {
+    for (const auto [_, factorIndex, isMinorMost] : dimFactors) {
       FactorSharding& factorSharding = factorIndexToSharding[factorIndex];
-      factorSharding.isMinorMost = dimMapping.isMinorMost(factorIndex);
+      factorSharding.isMinorMost = isMinorMost;
 
       if (hasOverflowAxes) {
         // If a previous factor had overflow axes, all subsequent factors should
@@ -359,8 +372,6 @@ TensorFactorShardings buildTensorFactorShardings(
     replicatedAxes.assign(optionalSharding.getReplicatedAxes().begin(),
                           optionalSharding.getReplicatedAxes().end());
   }
-
-  return result;
 }
 
 TensorFactorShardings buildTensorFactorShardings(
@@ -384,6 +395,39 @@ TensorFactorShardings buildTensorFactorShardings(
 
 }  // namespace
 
+ShardingRuleLayout::ShardingRuleLayout(OpShardingRuleAttr shardingRule)
+    : shardingRule(shardingRule) {
+  tensorOffsets.reserve(shardingRule.getNumOperands() +
+                        shardingRule.getNumResults() + 1);
+  for (TensorMappingAttr tensorMapping :
+       llvm::concat<const TensorMappingAttr>(
+           shardingRule.getOperandMappings(),
+           shardingRule.getResultMappings())) {
+    tensorOffsets.push_back(placements.size());
+    for (auto [dim, dimMapping] :
+         llvm::enumerate(tensorMapping.getDimMappings())) {
+      for (int64_t factorIndex : dimMapping.getFactorIndices()) {
+        placements.push_back({static_cast<int64_t>(dim), factorIndex,
+                              dimMapping.isMinorMost(factorIndex)});
+      }
+    }
+  }
+  tensorOffsets.push_back(placements.size());
+}
+
+const ShardingRuleLayout& ShardingRuleLayoutCache::getLayout(
+    OpShardingRuleAttr shardingRule) {
+  std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+  if (threadSafe) {
+    lock.lock();
+  }
+  std::unique_ptr<ShardingRuleLayout>& layout = layouts[shardingRule];
+  if (!layout) {
+    layout = std::make_unique<ShardingRuleLayout>(shardingRule);
+  }
+  return *layout;
+}
+
 ShardingProjection::ShardingProjection(
     SmallVector<TensorFactorShardings> operands,
     SmallVector<TensorFactorShardings> results)
@@ -395,22 +439,38 @@ ShardingProjection ShardingProjection::build(
     OpShardingRuleAttr shardingRule, MeshAttr mesh,
     const bool closedIfMissing) {
   ShardingProjection projection;
+  projection.rebuild(operandShardings, resultShardings, shardingRule, mesh,
+                     closedIfMissing);
+  return projection;
+}
 
-  for (const auto& [operandSharding, operandMapping] :
-       llvm::zip_equal(operandShardings, shardingRule.getOperandMappings())) {
-    projection.operands.push_back(buildTensorFactorShardings(
-        operandMapping, operandSharding, shardingRule.getFactorSizes(), mesh,
-        closedIfMissing));
-  }
+void ShardingProjection::rebuild(ArrayRef<TensorShardingAttr> operandShardings,
+                                 ArrayRef<TensorShardingAttr> resultShardings,
+                                 OpShardingRuleAttr shardingRule, MeshAttr mesh,
+                                 const bool closedIfMissing) {
+  rebuild(operandShardings, resultShardings, ShardingRuleLayout(shardingRule),
+          mesh, closedIfMissing);
+}
 
-  for (const auto& [resultSharding, resultMapping] :
-       llvm::zip_equal(resultShardings, shardingRule.getResultMappings())) {
-    projection.results.push_back(buildTensorFactorShardings(
-        resultMapping, resultSharding, shardingRule.getFactorSizes(), mesh,
-        closedIfMissing));
+void ShardingProjection::rebuild(ArrayRef<TensorShardingAttr> operandShardings,
+                                 ArrayRef<TensorShardingAttr> resultShardings,
+                                 const ShardingRuleLayout& layout,
+                                 MeshAttr mesh, const bool closedIfMissing) {
+  ArrayRef<int64_t> factorSizes = layout.getShardingRule().getFactorSizes();
+  // Only tensors beyond the new size are destroyed, the rest are rebuilt in
+  // place.
+  operands.resize(operandShardings.size());
+  for (int64_t operandNum = 0; operandNum < getNumOperands(); ++operandNum) {
+    buildTensorFactorShardings(layout.getOperandFactors(operandNum),
+                               operandShardings[operandNum], factorSizes, mesh,
+                               closedIfMissing, operands[operandNum]);
+  }
+  results.resize(resultShardings.size());
+  for (int64_t resultNum = 0; resultNum < getNumResults(); ++resultNum) {
+    buildTensorFactorShardings(layout.getResultFactors(resultNum),
+                               resultShardings[resultNum], factorSizes, mesh,
+                               closedIfMissing, results[resultNum]);
   }
-
-  return projection;
 }
 
 ShardingProjection ShardingProjection::build(Operation* op,
@@ -456,5 +516,56 @@ AxesPerFactor ShardingProjection::getGreatestCommonPrefixAxes(
   return factorAxisRefs;
 }
 
+std::optional<FactorAxesMasks> FactorAxesMasks::build(
+    const ShardingProjection& projection, int64_t numFactors, MeshAttr mesh) {
+  if (!mesh || mesh.getAxes().size() > 64) {
+    return std::nullopt;
+  }
+  FactorAxesMasks masks(mesh, numFactors);
+  for (const TensorFactorShardings& tensorFactorSharding :
+       llvm::concat<const TensorFactorShardings>(projection.getOperands(),
+                                                 projection.getResults())) {
+    for (const auto& [factorIndex, factorSharding] :
+         tensorFactorSharding.factorIndexToSharding) {
+      masks.addAxes(factorIndex, factorSharding.axisRefs);
+      masks.addAxes(factorIndex, factorSharding.overflowAxes);
+    }
+  }
+  return masks;
+}
+
+FactorAxesMasks::FactorAxesMasks(MeshAttr mesh, int64_t numFactors)
+    : factorMasks(numFactors, 0) {
+  for (auto [axisIndex, meshAxis] : llvm::enumerate(mesh.getAxes())) {
+    axisNameToMask.try_emplace(meshAxis.getName(), uint64_t{1} << axisIndex);
+  }
+}
+
+void FactorAxesMasks::addAxes(int64_t factorIndex,
+                              ArrayRef<AxisRefAttr> axes) {
+  uint64_t& factorMask = factorMasks[factorIndex];
+  for (AxisRefAttr axisRef : axes) {
+    uint64_t newBits = getMask(axisRef) & ~factorMask;
+    sharedMask |= unionMask & newBits;
+    unionMask |= newBits;
+    factorMask |= newBits;
+  }
+}
+
+bool FactorAxesMasks::mayOverlapWithOtherFactors(AxisRefAttr axisRef,
+                                                 int64_t factorIndex) const {
+  // A bit is in the mask of another factor if it's shared by several factors,
+  // or it's only in the mask of a factor other than `factorIndex`.
+  uint64_t otherFactorsMask =
+      sharedMask | (unionMask & ~factorMasks[factorIndex]);
+  return (getMask(axisRef) & otherFactorsMask) != 0;
+}
+
+uint64_t FactorAxesMasks::getMask(AxisRefAttr axisRef) const {
+  // An axis that isn't in the mesh may overlap with anything.
+  auto it = axisNameToMask.find(axisRef.getName());
+  return it == axisNameToMask.end() ? ~uint64_t{0} : it->second;
+}
+
 }  // namespace sdy
 }  // namespace mlir
@@ -17,8 +17,13 @@ limitations under the License.
 #define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SHARDING_PROJECTION_H_
 
 #include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <optional>
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/Support/LLVM.h"
@@ -136,6 +141,67 @@ struct UpdateTensorShardings {
   }
 };
 
+// A flat layout of the factors an `OpShardingRuleAttr` maps to each dimension
+// of each operand and result, so that a `ShardingProjection` can be built with
+// a linear pass over a dense array, instead of walking the nested tensor and
+// dimension mappings of the rule for every op visit.
+class ShardingRuleLayout {
+ public:
+  // A factor mapped to a dimension of a tensor.
+  struct FactorPlacement {
+    int64_t dim;
+    int64_t factorIndex;
+    bool isMinorMost;
+  };
+
+  explicit ShardingRuleLayout(OpShardingRuleAttr shardingRule);
+
+  OpShardingRuleAttr getShardingRule() const { return shardingRule; }
+
+  // Returns the factors mapped to the operand at `operandNum`, ordered by
+  // dimension and then from major to minor.
+  ArrayRef<FactorPlacement> getOperandFactors(int64_t operandNum) const {
+    return getTensorFactors(operandNum);
+  }
+  // Same as above, but for the result at `resultNum`.
+  ArrayRef<FactorPlacement> getResultFactors(int64_t resultNum) const {
+    return getTensorFactors(shardingRule.getNumOperands() + resultNum);
+  }
+
+ private:
+  ArrayRef<FactorPlacement> getTensorFactors(int64_t tensorNum) const {
+    return ArrayRef<FactorPlacement>(placements)
+        .slice(tensorOffsets[tensorNum],
+               tensorOffsets[tensorNum + 1] - tensorOffsets[tensorNum]);
+  }
+
+  OpShardingRuleAttr shardingRule;
+  SmallVector<FactorPlacement, 8> placements;
+  // The offset of each tensor in `placements`, where operands precede results,
+  // followed by the total number of placements.
+  SmallVector<int64_t, 4> tensorOffsets;
+};
+
+// Caches the `ShardingRuleLayout` of each `OpShardingRuleAttr`. Since rules
+// are uniqued, ops with the same rule share the same layout.
+//
+// If `threadSafe` is true, layouts are created under a lock, since independent
+// functions may be propagated through concurrently. Layouts are never
+// destroyed or moved until the cache is.
+class ShardingRuleLayoutCache {
+ public:
+  explicit ShardingRuleLayoutCache(bool threadSafe = false)
+      : threadSafe(threadSafe) {}
+
+  const ShardingRuleLayout& getLayout(OpShardingRuleAttr shardingRule);
+
+ private:
+  bool threadSafe;
+  std::mutex mutex;
+  llvm::DenseMap<OpShardingRuleAttr, std::unique_ptr<ShardingRuleLayout>>
+      layouts;
+};
+
 // The sharding projection holds information about how factors (rather than
 // dimensions), defined by an `OpShardingRuleAttr`, are sharded.
 //
@@ -188,8 +254,7 @@ class ShardingProjection {
   const TensorFactorShardings& getResult(int64_t resultNum) const {
     return results[resultNum];
   }
-  // TODO(enver): Move expandTensorSharding from propagation code to sharding
-  // projection and employ `getTensor`.
+  // Returns the tensor at `tensorNum`, where operands precede results.
   const TensorFactorShardings& getTensor(int64_t tensorNum) const {
     return tensorNum < getNumOperands()
                ? getOperand(tensorNum)
@@ -204,6 +269,15 @@ class ShardingProjection {
                             ArrayRef<AxisRefAttr> newAxes) {
     return results[resultIndex].expandShardingAxes(factorIndex, newAxes);
   }
+  // Same as above, but for the tensor at `tensorIndex`, where operands precede
+  // results.
+  bool expandTensorSharding(int64_t tensorIndex, int64_t factorIndex,
+                            ArrayRef<AxisRefAttr> newAxes) {
+    return tensorIndex < getNumOperands()
+               ? expandOperandSharding(tensorIndex, factorIndex, newAxes)
+               : expandResultSharding(tensorIndex - getNumOperands(),
+                                      factorIndex, newAxes);
+  }
 
   // Expands the shardings of all tensors that are associated with
   // `factorIndex` to be `newAxes` for that factor. Returns two BitVectors
@@ -229,6 +303,23 @@ class ShardingProjection {
                                   OpShardingRuleAttr shardingRule,
                                   MeshAttr mesh, bool closedIfMissing = false);
 
+  // Same as `build` above, but rebuilds this projection in place.
+  //
+  // The memory already allocated by the tensors of this projection, e.g., for
+  // a previously visited op, is reused, so that a projection that is rebuilt
+  // for every op doesn't need to allocate each time.
+  void rebuild(ArrayRef<TensorShardingAttr> operandShardings,
+               ArrayRef<TensorShardingAttr> resultShardings,
+               OpShardingRuleAttr shardingRule, MeshAttr mesh,
+               bool closedIfMissing = false);
+
+  // Same as `rebuild` above, but w.r.t. the rule of the given `layout`, which
+  // avoids walking the mappings of the rule.
+  void rebuild(ArrayRef<TensorShardingAttr> operandShardings,
+               ArrayRef<TensorShardingAttr> resultShardings,
+               const ShardingRuleLayout& layout, MeshAttr mesh,
+               bool closedIfMissing = false);
+
   // Builds a `ShardingProjection` for the operand and result shardings of the
   // given `op`, w.r.t. the given `shardingRule`.
   //
@@ -264,6 +355,52 @@ class ShardingProjection {
   SmallVector<TensorFactorShardings> results;
 };
 
+// Packs the mesh axes along which each factor is sharded, across all tensors
+// of a `ShardingProjection`, into a bit mask per factor with one bit per mesh
+// axis. A sub-axis sets the bit of its full axis, so the masks over-approximate
+// which axes overlap.
+//
+// This allows ruling out a conflict between an axis and all tensors with a few
+// bitwise operations, instead of comparing the axis with every factor sharding
+// of every tensor, which matters for ops with many operands (e.g.
+// concatenate or a while with many carried values).
+//
+// The bit of each mesh axis is looked up once when the masks are built, and
+// the axes shared by several factors are kept up to date as axes are added, so
+// that `mayOverlapWithOtherFactors` doesn't depend on the number of factors.
+class FactorAxesMasks {
+ public:
+  // Builds the masks of the `numFactors` factors in `projection`, including
+  // both the sharding and overflow axes of each factor.
+  //
+  // Returns std::nullopt if `mesh` is null or has more than 64 axes.
+  static std::optional<FactorAxesMasks> build(
+      const ShardingProjection& projection, int64_t numFactors, MeshAttr mesh);
+
+  // Adds `axes` to the mask of `factorIndex`, e.g., after it was expanded.
+  void addAxes(int64_t factorIndex, ArrayRef<AxisRefAttr> axes);
+
+  // Returns false if `axisRef` doesn't overlap with the sharding or overflow
+  // axes of any factor other than `factorIndex` in any tensor. May return true
+  // even if it doesn't overlap, e.g., for disjoint sub-axes of the same axis.
+  bool mayOverlapWithOtherFactors(AxisRefAttr axisRef,
+                                  int64_t factorIndex) const;
+
+ private:
+  FactorAxesMasks(MeshAttr mesh, int64_t numFactors);
+
+  // Returns the bit of the full axis of `axisRef`.
+  uint64_t getMask(AxisRefAttr axisRef) const;
+
+  // The bit of each mesh axis, keyed by axis name.
+  llvm::SmallDenseMap<StringRef, uint64_t, 16> axisNameToMask;
+  SmallVector<uint64_t, 8> factorMasks;
+  // The union of all factor masks.
+  uint64_t unionMask = 0;
+  // The bits that are in the masks of more than one factor.
+  uint64_t sharedMask = 0;
+};
+
 }  // namespace sdy
 }  // namespace mlir
 
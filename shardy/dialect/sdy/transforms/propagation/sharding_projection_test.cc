@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cassert>
 #include <cstdint>
+#include <optional>
 #include <string>
 
 #include "llvm/ADT/STLExtras.h"
@@ -42,7 +43,9 @@ namespace {
 
 inline constexpr StringRef kMeshName = "mesh";
 
+using ::testing::AllOf;
 using ::testing::ElementsAre;
+using ::testing::Field;
 using ::testing::IsEmpty;
 using ::testing::UnorderedElementsAre;
 
@@ -737,6 +740,84 @@ TEST_F(ShardingProjectionBuildTest,
                   /*replicatedAxes*/ IsEmpty()));
 }
 
+TEST_F(ShardingProjectionBuildTest, RebuildInPlaceMatchesBuild) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=4, "b"=2, "c"=3]>
+
+    func.func @main(%arg0: tensor<2x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"b"}, {"a", ?}]>},
+                    %arg1: tensor<8x4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {?}], replicated={"c"}>},
+                    %arg2: tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}]>})
+        -> (tensor<2x4xf32>, tensor<2x4xf32>) {
+      %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<2x8xf32>, tensor<8x4xf32>) -> tensor<2x4xf32>
+      %1 = stablehlo.reshape %arg2 : (tensor<8xf32>) -> tensor<2x4xf32>
+      return %0, %1 : tensor<2x4xf32>, tensor<2x4xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  MeshAttr mesh = getMeshAttr(module.get());
+  auto dotGeneralOp = getFirstOp<stablehlo::DotGeneralOp>(module.get());
+  auto reshapeOp = getFirstOp<stablehlo::ReshapeOp>(module.get());
+  OpShardingRuleAttr dotGeneralRule = getOrCreateShardingRule(dotGeneralOp);
+  OpShardingRuleAttr reshapeRule = getOrCreateShardingRule(reshapeOp);
+
+  // Rebuilding the projection of an op with more tensors and factors for
+  // another op gives the same projection as building it from scratch.
+  ShardingProjection projection =
+      ShardingProjection::build(dotGeneralOp, dotGeneralRule, mesh);
+  projection.rebuild(getShardings(reshapeOp->getOperands()),
+                     getShardings(reshapeOp->getResults()), reshapeRule, mesh);
+  EXPECT_EQ(projection,
+            ShardingProjection::build(reshapeOp, reshapeRule, mesh));
+
+  projection.rebuild(getShardings(dotGeneralOp->getOperands()),
+                     getShardings(dotGeneralOp->getResults()), dotGeneralRule,
+                     mesh);
+  EXPECT_EQ(projection,
+            ShardingProjection::build(dotGeneralOp, dotGeneralRule, mesh));
+}
+
+TEST_F(ShardingProjectionBuildTest, RebuildFromCachedLayout) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=4, "b"=2]>
+
+    func.func @main(%arg0: tensor<2x4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"b"}, {"a"}]>})
+        -> tensor<8xf32> {
+      %0 = stablehlo.reshape %arg0 : (tensor<2x4xf32>) -> tensor<8xf32>
+      return %0 : tensor<8xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  MeshAttr mesh = getMeshAttr(module.get());
+  auto reshapeOp = getFirstOp<stablehlo::ReshapeOp>(module.get());
+  OpShardingRuleAttr reshapeRule = getOrCreateShardingRule(reshapeOp);
+
+  ShardingRuleLayoutCache layoutCache;
+  const ShardingRuleLayout& layout = layoutCache.getLayout(reshapeRule);
+  EXPECT_EQ(&layoutCache.getLayout(reshapeRule), &layout);
+
+  // The operand maps each dimension to a single factor, and the result maps
+  // its only dimension to both factors.
+  auto placementIs = [](int64_t dim, int64_t factorIndex, bool isMinorMost) {
+    return AllOf(Field(&ShardingRuleLayout::FactorPlacement::dim, dim),
+                 Field(&ShardingRuleLayout::FactorPlacement::factorIndex,
+                       factorIndex),
+                 Field(&ShardingRuleLayout::FactorPlacement::isMinorMost,
+                       isMinorMost));
+  };
+  EXPECT_THAT(layout.getOperandFactors(0),
+              ElementsAre(placementIs(0, 0, true), placementIs(1, 1, true)));
+  EXPECT_THAT(layout.getResultFactors(0),
+              ElementsAre(placementIs(0, 0, false), placementIs(0, 1, true)));
+
+  ShardingProjection projection;
+  projection.rebuild(getShardings(reshapeOp->getOperands()),
+                     getShardings(reshapeOp->getResults()), layout, mesh);
+  EXPECT_EQ(projection,
+            ShardingProjection::build(reshapeOp, reshapeRule, mesh));
+}
+
 //===----------------------------------------------------------------------===//
 // Tests for ShardingProjection::expandSharding
 //===----------------------------------------------------------------------===//
@@ -1228,6 +1309,58 @@ TEST_F(ShardingProjectionGetGreatestCommonPrefixAxesTest,
               ElementsAre(ElementsAre(AxisRefIs("b"))));
 }
 
+class FactorAxesMasksTest : public PropagationTestBase {};
+
+TEST_F(FactorAxesMasksTest, DotGeneralSimple) {
+  const std::string program = R"mlir(
+    sdy.mesh @mesh = <["a"=4, "b"=2, "c"=2, "d"=2, "e"=2, "f"=2]>
+
+    func.func @main(%arg0: tensor<2x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"b"}, {"a", ?}]>},
+                    %arg1: tensor<8x4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "c"}, {"d", ?}]>})
+        -> tensor<2x4xf32> {
+      %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] {
+        sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{?}, {"d", "e"}]>]>
+      } : (tensor<2x8xf32>, tensor<8x4xf32>) -> tensor<2x4xf32>
+      return %0 : tensor<2x4xf32>
+    })mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(program, &context);
+  ASSERT_TRUE(module);
+  ShardingProjection projection =
+      getShardingProjection<stablehlo::DotGeneralOp>(module.get());
+
+  EXPECT_FALSE(FactorAxesMasks::build(projection, /*numFactors=*/3,
+                                      /*mesh=*/MeshAttr()));
+
+  std::optional<FactorAxesMasks> masks = FactorAxesMasks::build(
+      projection, /*numFactors=*/3, getMeshAttr(module.get()));
+  ASSERT_TRUE(masks);
+
+  // Factor 0 is sharded by "b", factor 1 by "d" and "e", and factor 2 by "a"
+  // and "c".
+  EXPECT_FALSE(masks->mayOverlapWithOtherFactors(createAxis("a"), 2));
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("a"), 0));
+  EXPECT_FALSE(masks->mayOverlapWithOtherFactors(createAxis("e"), 1));
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("e"), 2));
+  EXPECT_FALSE(masks->mayOverlapWithOtherFactors(createAxis("f"), 0));
+  // Sub-axes are over-approximated by their full axis.
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createSubAxis("a", 1, 2), 1));
+
+  masks->addAxes(/*factorIndex=*/1, {createAxis("f")});
+  EXPECT_FALSE(masks->mayOverlapWithOtherFactors(createAxis("f"), 1));
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("f"), 0));
+
+  // Adding an axis that a factor already has doesn't make it shared.
+  masks->addAxes(/*factorIndex=*/2, {createAxis("c")});
+  EXPECT_FALSE(masks->mayOverlapWithOtherFactors(createAxis("c"), 2));
+
+  // "b" is in the masks of both factor 0 and 1.
+  masks->addAxes(/*factorIndex=*/1, {createAxis("b")});
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("b"), 0));
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("b"), 1));
+  EXPECT_TRUE(masks->mayOverlapWithOtherFactors(createAxis("b"), 2));
+}
+
 }  // namespace
 }  // namespace sdy
 }  // namespace mlir
@@ -0,0 +1,421 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/dialect/sdy/transforms/propagation/side_table_propagation.h"
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/IR/ValueRange.h"
+#include "mlir/IR/Visitors.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/ir/utils.h"
+#include "shardy/dialect/sdy/transforms/propagation/basic_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_builder.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_registry.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_projection.h"
+
+namespace mlir {
+namespace sdy {
+
+using func::FuncOp;
+
+namespace {
+
+// Sets the sharding of the tensor at a given index.
+using SetShardingPerTensorFn =
+    llvm::function_ref<void(int64_t, TensorShardingAttr)>;
+
+// Calls `addToWorklist` on all users of `value`, with the same special cases
+// as `notifyUsersModified` in basic propagation.
+void addUsersToWorklist(Value value,
+                        llvm::function_ref<void(Operation*)> addToWorklist) {
+  for (OpOperand& use : value.getUses()) {
+    Operation* user = use.getOwner();
+    if (auto dataFlowEdge = DataFlowEdgeOp::lookup(use)) {
+      addToWorklist(dataFlowEdge);
+    } else if (user->hasTrait<OpTrait::IsTerminator>()) {
+      addToWorklist(user->getParentOp());
+    } else {
+      addToWorklist(user);
+    }
+  }
+}
+
+// Returns the shardings of `values` in `sideTable`.
+SmallVector<TensorShardingAttr> getShardings(
+    ValueRange values, const ShardingSideTable& sideTable) {
+  return llvm::map_to_vector(
+      values, [&](Value value) { return sideTable.getSharding(value); });
+}
+
+// Propagates between `operandShardings` and `resultShardings` according to
+// `shardingRule`, and calls `setOperandSharding` and `setResultSharding` for
+// each tensor whose sharding can be updated.
+void propagateTensorShardings(
+    ArrayRef<TensorShardingAttr> operandShardings,
+    ArrayRef<TensorShardingAttr> resultShardings,
+    OpShardingRuleAttr shardingRule,
+    PropagationDirectionAlongFactor directionAlongFactor,
+    const FactorPropagation& factorPropagation, bool conservativePropagation,
+    Operation* op, const SymbolTable& symbolTable,
+    SetShardingPerTensorFn setOperandSharding,
+    SetShardingPerTensorFn setResultSharding) {
+  std::optional<StringRef> meshName =
+      getCommonMeshName(operandShardings, resultShardings, symbolTable);
+  if (!meshName.has_value()) {
+    return;
+  }
+  MeshAttr mesh = getMeshAttr(symbolTable, *meshName);
+  assert(mesh && "unknown mesh");
+
+  // Reuses the memory of the projection of the previous op visited by this
+  // thread, see `propagateTensorShardings` in basic propagation.
+  static thread_local ShardingProjection shardingProjection;
+  shardingProjection.rebuild(operandShardings, resultShardings, shardingRule,
+                             mesh);
+  auto [updateOperand, updateResult] =
+      factorPropagation.propagateFactorShardings(
+          shardingProjection, directionAlongFactor,
+          shardingRule.getFactorSizes(), mesh, op, conservativePropagation);
+
+  auto updateTensorShardings =
+      [&](ArrayRef<TensorShardingAttr> oldShardings,
+          ArrayRef<TensorFactorShardings> tensorFactorShardings,
+          ArrayRef<TensorMappingAttr> tensorMappings,
+          const BitVector& updateTensor,
+          SetShardingPerTensorFn setTensorSharding) {
+        for (int64_t index : updateTensor.set_bits()) {
+          TensorShardingAttr newSharding =
+              tensorFactorShardings[index].createTensorShardingAttr(
+                  mesh.getContext(), tensorMappings[index],
+                  shardingRule.getFactorSizes(), *meshName, mesh);
+          // The sharding can't be updated if a strided view is needed, see
+          // `updateTensorSharding` in basic propagation.
+          TensorShardingAttr oldSharding = oldShardings[index];
+          if ((!oldSharding && newSharding.emptyAxes()) ||
+              newSharding == oldSharding) {
+            continue;
+          }
+          setTensorSharding(index, newSharding);
+        }
+      };
+  updateTensorShardings(operandShardings, shardingProjection.getOperands(),
+                        shardingRule.getOperandMappings(), updateOperand,
+                        setOperandSharding);
+  updateTensorShardings(resultShardings, shardingProjection.getResults(),
+                        shardingRule.getResultMappings(), updateResult,
+                        setResultSharding);
+}
+
+}  // namespace
+
+void forEachOpAffectedBySharding(Value value,
+                                 llvm::function_ref<void(Operation*)> fn) {
+  if (auto dataFlowEdge = value.getDefiningOp<DataFlowEdgeOp>()) {
+    for (Value nonEdgeOwnerTarget : dataFlowEdge.getNonOwnerTargets()) {
+      addUsersToWorklist(nonEdgeOwnerTarget, fn);
+    }
+  }
+  if (auto opResult = dyn_cast<OpResult>(value)) {
+    fn(opResult.getOwner());
+  } else {
+    fn(value.getParentBlock()->getParentOp());
+  }
+  addUsersToWorklist(value, fn);
+}
+
+//===----------------------------------------------------------------------===//
+// ShardingSideTable
+//===----------------------------------------------------------------------===//
+
+TensorShardingAttr ShardingSideTable::getSharding(Value value) const {
+  if (Value shardableValue = getShardableValue(value)) {
+    if (auto it = valueToSharding.find(shardableValue);
+        it != valueToSharding.end()) {
+      return it->second;
+    }
+  }
+  return sdy::getSharding(value);
+}
+
+void ShardingSideTable::setSharding(Value value, TensorShardingAttr sharding) {
+  Value shardableValue = getShardableValue(value);
+  assert(shardableValue && "value should exist if its sharding is updated");
+  valueToSharding[shardableValue] = sharding;
+}
+
+TensorShardingAttr ShardingSideTable::getFuncResultSharding(
+    FuncOp funcOp, int64_t resNum) const {
+  if (auto it = funcResultToSharding.find({funcOp, resNum});
+      it != funcResultToSharding.end()) {
+    return it->second;
+  }
+  return sdy::getFuncResultSharding(funcOp, resNum);
+}
+
+void ShardingSideTable::setFuncResultSharding(FuncOp funcOp, int64_t resNum,
+                                              TensorShardingAttr sharding) {
+  funcResultToSharding[{funcOp, resNum}] = sharding;
+}
+
+void ShardingSideTable::commit() const {
+  for (auto [value, sharding] : valueToSharding) {
+    sdy::setSharding(value, sharding);
+  }
+  for (auto [funcResult, sharding] : funcResultToSharding) {
+    auto [funcOp, resNum] = funcResult;
+    sdy::setFuncResultSharding(cast<FuncOp>(funcOp), resNum, sharding);
+  }
+}
+
+void ShardingSideTable::clear() {
+  valueToSharding.clear();
+  funcResultToSharding.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// SideTablePropagation
+//===----------------------------------------------------------------------===//
+
+OpShardingRuleAttr SideTablePropagation::getShardingRule(Operation* op) const {
+  if (auto it = opToShardingRule.find(op); it != opToShardingRule.end()) {
+    return it->second;
+  }
+  OpShardingRuleAttr shardingRule = getOrCreateShardingRule(
+      op, conservativePropagation, /*setShardingRuleOnOp=*/false);
+  opToShardingRule.try_emplace(op, shardingRule);
+  return shardingRule;
+}
+
+OpShardingRuleAttr SideTablePropagation::getCachedShardingRule(
+    Operation* op) const {
+  auto it = opToShardingRule.find(op);
+  assert(it != opToShardingRule.end() &&
+         "sharding rule of op should have been cached");
+  return it->second;
+}
+
+void SideTablePropagation::cacheShardingRules(ModuleOp moduleOp) const {
+  moduleOp.walk([&](Operation* op) {
+    if (op == moduleOp) {
+      return;
+    }
+    if (isa<DataFlowEdgeOp, PropagationBarrierOp>(op)) {
+      // These ops are propagated through without a sharding rule.
+      opToShardingRule.try_emplace(op, nullptr);
+    } else {
+      getShardingRule(op);
+    }
+  });
+}
+
+void SideTablePropagation::updateValueAndGroupSharding(
+    Value value, TensorShardingAttr sharding, ShardingSideTable& sideTable,
+    llvm::function_ref<void(Value)> onValueUpdated) const {
+  value = getShardableValue(value);
+  sideTable.setSharding(value, sharding);
+  onValueUpdated(value);
+  for (Value groupValue : shardingGroupMap.getGroupMembers(value)) {
+    if (groupValue != value) {
+      sideTable.setSharding(groupValue, sharding);
+      onValueUpdated(groupValue);
+    }
+  }
+}
+
+void SideTablePropagation::propagateOp(
+    Operation* op, ShardingSideTable& sideTable,
+    llvm::function_ref<void(Operation*)> addToWorklist,
+    ShardingUpdateListener onUpdate) const {
+  auto addAffectedOp = [&](Operation* affectedOp) {
+    // `op` itself doesn't need to be propagated through again, since nothing
+    // else changed.
+    if (affectedOp != op) {
+      addToWorklist(affectedOp);
+    }
+  };
+  auto updateValueSharding = [&](Value value, TensorShardingAttr sharding) {
+    updateValueAndGroupSharding(value, sharding, sideTable,
+                                [&](Value updatedValue) {
+                                  forEachOpAffectedBySharding(updatedValue,
+                                                              addAffectedOp);
+                                  if (onUpdate) {
+                                    onUpdate(op, updatedValue);
+                                  }
+                                });
+  };
+  PropagationDirectionAlongFactor directionAlongFactor =
+      std::bind(getDirectionToPropagate, op, std::placeholders::_1);
+
+  if (auto dataFlowEdgeOp = dyn_cast<DataFlowEdgeOp>(op)) {
+    SmallVector<Value> sources = dataFlowEdgeOp.getSources();
+    Value result = dataFlowEdgeOp.getResult();
+    TensorShardingAttr resultSharding = dataFlowEdgeOp.transformTargetSharding(
+        sideTable.getSharding(result),
+        DataFlowShardingTransformType::kBeforeEdgePropagation);
+    propagateTensorShardings(
+        getShardings(sources, sideTable), resultSharding,
+        createIdentityShardingRule(cast<ShapedType>(dataFlowEdgeOp.getType()),
+                                   sources.size()),
+        directionAlongFactor, factorPropagation,
+        /*conservativePropagation=*/false, op, symbolTable,
+        [&](int64_t index, TensorShardingAttr sharding) {
+          updateValueSharding(sources[index], sharding);
+        },
+        [&](int64_t, TensorShardingAttr sharding) {
+          updateValueSharding(
+              result, dataFlowEdgeOp.transformTargetSharding(
+                          sharding, DataFlowShardingTransformType::
+                                        kAfterEdgePropagation));
+        });
+    return;
+  }
+
+  if (auto barrierOp = dyn_cast<PropagationBarrierOp>(op)) {
+    Value input = barrierOp.getInput();
+    Value result = barrierOp.getResult();
+    propagateTensorShardings(
+        sideTable.getSharding(input), sideTable.getSharding(result),
+        createIdentityShardingRule(cast<RankedTensorType>(barrierOp.getType())),
+        [&](int64_t) { return barrierOp.getAllowedDirection(); },
+        factorPropagation, /*conservativePropagation=*/false, op, symbolTable,
+        [&](int64_t, TensorShardingAttr sharding) {
+          updateValueSharding(input, sharding);
+        },
+        [&](int64_t, TensorShardingAttr sharding) {
+          updateValueSharding(result, sharding);
+        });
+    return;
+  }
+
+  OpShardingRuleAttr shardingRule = getShardingRule(op);
+  if (!shardingRule) {
+    return;
+  }
+  propagateTensorShardings(
+      getShardings(op->getOperands(), sideTable),
+      getShardings(op->getResults(), sideTable), shardingRule,
+      directionAlongFactor, factorPropagation, conservativePropagation, op,
+      symbolTable,
+      [&](int64_t index, TensorShardingAttr sharding) {
+        updateValueSharding(op->getOperand(index), sharding);
+      },
+      [&](int64_t index, TensorShardingAttr sharding) {
+        updateValueSharding(op->getResult(index), sharding);
+      });
+}
+
+void SideTablePropagation::propagateFuncResults(
+    FuncOp funcOp, ShardingSideTable& sideTable,
+    llvm::function_ref<void(Operation*)> addToWorklist) const {
+  for (OpOperand& returnOperand : getBodyTerminatorOpOperands(funcOp)) {
+    Value returnValue = returnOperand.get();
+    auto tensorType = dynCastStaticShapedType(returnValue.getType());
+    if (!tensorType) {
+      continue;
+    }
+    int64_t resNum = returnOperand.getOperandNumber();
+    propagateTensorShardings(
+        sideTable.getSharding(returnValue),
+        sideTable.getFuncResultSharding(funcOp, resNum),
+        createIdentityShardingRule(tensorType),
+        std::bind(propagateAny, funcOp, std::placeholders::_1),
+        factorPropagation, /*conservativePropagation=*/false, funcOp,
+        symbolTable,
+        [&](int64_t, TensorShardingAttr sharding) {
+          updateValueAndGroupSharding(
+              returnValue, sharding, sideTable, [&](Value updatedValue) {
+                if (addToWorklist) {
+                  forEachOpAffectedBySharding(updatedValue, addToWorklist);
+                }
+              });
+        },
+        [&](int64_t, TensorShardingAttr sharding) {
+          sideTable.setFuncResultSharding(funcOp, resNum, sharding);
+        });
+  }
+}
+
+void SideTablePropagation::propagateOps(
+    ArrayRef<Operation*> ops, ShardingSideTable& sideTable,
+    llvm::function_ref<bool(Operation*)> isInScope,
+    ShardingUpdateListener onUpdate) const {
+  // Ops are propagated through in the given order, and ops that are added back
+  // to the worklist are propagated through after all ops that are already in
+  // it.
+  std::deque<Operation*> worklist;
+  llvm::DenseSet<Operation*> inWorklist;
+  auto addToWorklist = [&](Operation* op) {
+    if (isInScope(op) && inWorklist.insert(op).second) {
+      worklist.push_back(op);
+    }
+  };
+  llvm::for_each(ops, addToWorklist);
+  while (!worklist.empty()) {
+    Operation* op = worklist.front();
+    worklist.pop_front();
+    inWorklist.erase(op);
+    propagateOp(op, sideTable, addToWorklist, onUpdate);
+  }
+}
+
+LogicalResult SideTablePropagation::propagate(
+    ModuleOp moduleOp, ShardingSideTable& sideTable,
+    ShardingUpdateListener onUpdate) const {
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    propagateFuncResults(funcOp, sideTable);
+  }
+
+  SmallVector<Operation*> ops;
+  moduleOp.walk<WalkOrder::PreOrder>([&](Operation* op) {
+    if (op != moduleOp) {
+      ops.push_back(op);
+    }
+  });
+  // Propagating to the return values may affect other ops, e.g., the ones
+  // using a value in the same sharding group, so we repeat until no return
+  // value is updated.
+  while (!ops.empty()) {
+    propagateOps(
+        ops, sideTable, [](Operation*) { return true; }, onUpdate);
+    ops.clear();
+    for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+      propagateFuncResults(funcOp, sideTable,
+                           [&](Operation* op) { ops.push_back(op); });
+    }
+  }
+  return success();
+}
+
+}  // namespace sdy
+}  // namespace mlir
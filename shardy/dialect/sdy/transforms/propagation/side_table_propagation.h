@@ -0,0 +1,191 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SIDE_TABLE_PROPAGATION_H_
+#define SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SIDE_TABLE_PROPAGATION_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/basic_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/factor_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_group_map.h"
+
+namespace mlir {
+namespace sdy {
+
+// Calls `fn` on all ops that are affected by changing the sharding of `value`,
+// i.e., the ops that need to be propagated through again, same as
+// `notifyShardingModified` in basic propagation.
+void forEachOpAffectedBySharding(Value value,
+                                 llvm::function_ref<void(Operation*)> fn);
+
+// Holds shardings of values and function results on the side, without
+// modifying the IR.
+//
+// A value (or function result) that wasn't set in the table has the sharding
+// that is attached to it in the IR. Values are keyed by their shardable value
+// (see `getShardableValue`), same as `getSharding` and `setSharding`.
+class ShardingSideTable {
+ public:
+  // Returns the sharding of `value` in this table, or the sharding in the IR if
+  // it wasn't set.
+  TensorShardingAttr getSharding(Value value) const;
+
+  // Sets the sharding of `value` in this table.
+  void setSharding(Value value, TensorShardingAttr sharding);
+
+  // Returns the sharding of the `resNum` result of `funcOp` in this table, or
+  // the sharding in the IR if it wasn't set.
+  TensorShardingAttr getFuncResultSharding(func::FuncOp funcOp,
+                                           int64_t resNum) const;
+
+  // Sets the sharding of the `resNum` result of `funcOp` in this table.
+  void setFuncResultSharding(func::FuncOp funcOp, int64_t resNum,
+                             TensorShardingAttr sharding);
+
+  // Sets all shardings in this table on the IR.
+  void commit() const;
+
+  // Removes all shardings from this table.
+  void clear();
+
+  // Returns the shardings of all values set in this table.
+  const llvm::DenseMap<Value, TensorShardingAttr>& getValueShardings() const {
+    return valueToSharding;
+  }
+
+  // Returns the number of values and function results set in this table.
+  int64_t size() const {
+    return valueToSharding.size() + funcResultToSharding.size();
+  }
+
+ private:
+  llvm::DenseMap<Value, TensorShardingAttr> valueToSharding;
+  llvm::DenseMap<std::pair<Operation*, int64_t>, TensorShardingAttr>
+      funcResultToSharding;
+};
+
+// Called with an op that is propagated through, and a value whose sharding was
+// updated by propagating through it.
+using ShardingUpdateListener = llvm::function_ref<void(Operation*, Value)>;
+
+// Runs the same propagation as `BasicPropagationPassImpl::propagate`, but
+// reads and writes shardings from a `ShardingSideTable` instead of the IR.
+//
+// This allows evaluating many sharding configurations of the same module
+// without modifying it, e.g., for automatic partitioning. Sharding rules are
+// created once per op and cached, but are never set on the ops.
+//
+// Ops are propagated through in a worklist, initialized with all ops in
+// program order. Whenever the sharding of a value changes, all ops that are
+// affected by it are added back to the worklist, same as the greedy driver in
+// `BasicPropagationPassImpl::propagate`.
+class SideTablePropagation {
+ public:
+  SideTablePropagation(const SymbolTable& symbolTable,
+                       const ShardingGroupMap& shardingGroupMap,
+                       const FactorPropagation& factorPropagation,
+                       GetDirectionToPropagateFn getDirectionToPropagate =
+                           propagateAny,
+                       bool conservativePropagation = false)
+      : symbolTable(symbolTable),
+        shardingGroupMap(shardingGroupMap),
+        factorPropagation(factorPropagation),
+        getDirectionToPropagate(getDirectionToPropagate),
+        conservativePropagation(conservativePropagation) {}
+
+  // Propagates shardings through all functions in `moduleOp` until a fixed
+  // point is reached, where the current shardings are given by `sideTable`.
+  //
+  // This includes propagating shardings between function outputs and their
+  // producing values, before propagating through the function bodies and
+  // after, until no return value is updated.
+  //
+  // If `onUpdate` is set, it's called for every sharding that is updated by
+  // propagating through an op.
+  LogicalResult propagate(ModuleOp moduleOp, ShardingSideTable& sideTable,
+                          ShardingUpdateListener onUpdate = nullptr) const;
+
+  // Propagates through `ops` in the given order, and through any op that is
+  // affected by an updated sharding and for which `isInScope` returns true,
+  // until a fixed point is reached. Ops for which `isInScope` returns false are
+  // never propagated through, even if they are in `ops`.
+  //
+  // Unlike `propagate`, this doesn't propagate between function outputs and
+  // their producing values.
+  void propagateOps(ArrayRef<Operation*> ops, ShardingSideTable& sideTable,
+                    llvm::function_ref<bool(Operation*)> isInScope,
+                    ShardingUpdateListener onUpdate = nullptr) const;
+
+  // Propagates between the return values of `funcOp` and its results.
+  //
+  // If `addToWorklist` is set, it's called on all ops that are affected by
+  // updated shardings of the return values and their sharding groups.
+  void propagateFuncResults(
+      func::FuncOp funcOp, ShardingSideTable& sideTable,
+      llvm::function_ref<void(Operation*)> addToWorklist = nullptr) const;
+
+  // Returns the sharding rule of `op`, or null if it has none. The rule is
+  // created once and cached, without setting it on `op`.
+  //
+  // This is safe to call concurrently for ops whose rule is already cached.
+  OpShardingRuleAttr getShardingRule(Operation* op) const;
+
+  // Returns the cached sharding rule of `op`, or null if it has none, without
+  // ever modifying the cache. `op` must have been cached by
+  // `cacheShardingRules`, so this is safe to call concurrently.
+  OpShardingRuleAttr getCachedShardingRule(Operation* op) const;
+
+  // Creates and caches the sharding rules of all ops in `moduleOp`, so that
+  // `propagate` can then run concurrently on separate side tables. Data flow
+  // edges and propagation barriers are cached without a rule.
+  void cacheShardingRules(ModuleOp moduleOp) const;
+
+ private:
+  // Updates the sharding of `value` and all values in the same sharding group,
+  // and calls `onValueUpdated` on each of them.
+  void updateValueAndGroupSharding(
+      Value value, TensorShardingAttr sharding, ShardingSideTable& sideTable,
+      llvm::function_ref<void(Value)> onValueUpdated) const;
+
+  // Propagates through `op`, and calls `addToWorklist` on all ops that are
+  // affected by updated shardings.
+  void propagateOp(Operation* op, ShardingSideTable& sideTable,
+                   llvm::function_ref<void(Operation*)> addToWorklist,
+                   ShardingUpdateListener onUpdate) const;
+
+  const SymbolTable& symbolTable;
+  const ShardingGroupMap& shardingGroupMap;
+  const FactorPropagation& factorPropagation;
+  GetDirectionToPropagateFn getDirectionToPropagate;
+  bool conservativePropagation;
+  mutable llvm::DenseMap<Operation*, OpShardingRuleAttr> opToShardingRule;
+};
+
+}  // namespace sdy
+}  // namespace mlir
+
+#endif  // SHARDY_DIALECT_SDY_TRANSFORMS_PROPAGATION_SIDE_TABLE_PROPAGATION_H_
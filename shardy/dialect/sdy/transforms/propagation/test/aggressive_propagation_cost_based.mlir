@@ -0,0 +1,34 @@
+// RUN: sdy_opt %s -sdy-aggressive-propagate="propagation-strategy=cost-based" 2>&1 | FileCheck %s
+
+sdy.mesh @mesh = <["a"=2]>
+
+// The lhs has more elements than the rhs, but a smaller local size in bytes,
+// so the cost-based strategy prefers the non-contracting factor of the rhs.
+// CHECK-LABEL: func @prefer_larger_local_size_in_bytes(
+// CHECK-SAME:  -> (tensor<8x6xf32> {sdy.sharding = #sdy.sharding<@mesh, [{?}, {"a", ?}]>}) {
+func.func @prefer_larger_local_size_in_bytes(
+    %arg0: tensor<8x32xbf16> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+    %arg1: tensor<32x6xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"a"}]>})
+    -> tensor<8x6xf32> {
+  // CHECK-NEXT: stablehlo.dot_general %arg0, %arg1
+  // CHECK-SAME:   {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{?}, {"a", ?}]>]>}
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] :
+    (tensor<8x32xbf16>, tensor<32x6xf32>) -> tensor<8x6xf32>
+  return %0 : tensor<8x6xf32>
+}
+
+// With the same element type, the lhs has a larger local size in bytes, so
+// the cost-based strategy prefers the non-contracting factor of the lhs, like
+// the aggressive strategy.
+// CHECK-LABEL: func @same_element_type(
+// CHECK-SAME:  -> (tensor<8x6xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", ?}, {?}]>}) {
+func.func @same_element_type(
+    %arg0: tensor<8x32xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+    %arg1: tensor<32x6xf32> {sdy.sharding = #sdy.sharding<@mesh, [{}, {"a"}]>})
+    -> tensor<8x6xf32> {
+  // CHECK-NEXT: stablehlo.dot_general %arg0, %arg1
+  // CHECK-SAME:   {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] :
+    (tensor<8x32xf32>, tensor<32x6xf32>) -> tensor<8x6xf32>
+  return %0 : tensor<8x6xf32>
+}
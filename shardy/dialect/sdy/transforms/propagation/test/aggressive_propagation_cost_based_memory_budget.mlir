@@ -0,0 +1,11 @@
+// RUN: sdy_opt %s -sdy-aggressive-propagate="propagation-strategy=cost-based per-device-memory-budget=8" -verify-diagnostics
+
+// expected-error @+1 {{The per-device memory budget isn't supported by the cost-based propagation strategy.}}
+module {
+  sdy.mesh @mesh = <["a"=2]>
+
+  func.func @main(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>}) -> tensor<8x8xf32> {
+    %0 = stablehlo.add %arg0, %arg0 : tensor<8x8xf32>
+    return %0 : tensor<8x8xf32>
+  }
+}
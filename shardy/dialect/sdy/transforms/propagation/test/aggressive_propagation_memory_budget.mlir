@@ -0,0 +1,34 @@
+// RUN: sdy_opt %s -sdy-aggressive-propagate="per-device-memory-budget=8" 2>&1 | FileCheck %s
+
+sdy.mesh @mesh = <["a"=2, "b"=2, "c"=2]>
+
+// The operands have conflicting shardings, so the aggressive strategy would
+// only propagate "a" to the add, whose local size (16 bytes) exceeds the
+// budget. Therefore, the add takes the sharding of the first operand.
+// CHECK-LABEL: func @over_budget_takes_conflicting_sharding(
+// CHECK-SAME:      %arg0: tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}]>},
+// CHECK-SAME:      %arg1: tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "c"}]>})
+// CHECK-SAME:  -> (tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b", ?}]>}) {
+func.func @over_budget_takes_conflicting_sharding(
+    %arg0: tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}]>},
+    %arg1: tensor<8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "c"}]>})
+    -> tensor<8xf32> {
+  // CHECK-NEXT: stablehlo.add %arg0, %arg1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", "b", ?}]>]>}
+  %0 = stablehlo.add %arg0, %arg1 : tensor<8xf32>
+  return %0 : tensor<8xf32>
+}
+
+// The add is within the budget when sharded along "a", so this is equivalent
+// to the aggressive strategy.
+// CHECK-LABEL: func @within_budget(
+// CHECK-SAME:      %arg0: tensor<4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}]>},
+// CHECK-SAME:      %arg1: tensor<4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "c"}]>})
+// CHECK-SAME:  -> (tensor<4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", ?}]>}) {
+func.func @within_budget(
+    %arg0: tensor<4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}]>},
+    %arg1: tensor<4xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "c"}]>})
+    -> tensor<4xf32> {
+  // CHECK-NEXT: stablehlo.add %arg0, %arg1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}]>]>}
+  %0 = stablehlo.add %arg0, %arg1 : tensor<4xf32>
+  return %0 : tensor<4xf32>
+}
@@ -1,4 +1,5 @@
 // RUN: sdy_opt %s -sdy-basic-propagate -verify-diagnostics 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-basic-propagate='incremental-factor-propagation=true' -verify-diagnostics 2>&1 | FileCheck %s
 
 sdy.mesh @empty_mesh = <[]>
 sdy.mesh @maximal_mesh = <[], device_ids=[0]>
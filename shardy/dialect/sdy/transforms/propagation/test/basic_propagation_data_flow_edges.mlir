@@ -1,4 +1,5 @@
 // RUN: sdy_opt %s -sdy-basic-propagate 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-basic-propagate='parallel-propagation-regions=4' 2>&1 | FileCheck %s
 
 // Propagation tests for ops with data-flow edges like CaseOp and WhileOp
 
@@ -0,0 +1,73 @@
+// RUN: sdy_opt %s -sdy-basic-propagate 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-basic-propagate='parallel-propagation-regions=2' 2>&1 | FileCheck %s
+
+sdy.mesh @mesh = <["a"=2, "b"=2]>
+
+// The body is partitioned into two regions, of four and three ops. The
+// sharding of %arg0 flows forward through both regions, and the sharding of the
+// function result flows backward through both regions.
+// CHECK-LABEL: func @two_regions(
+// CHECK-SAME:      %arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {"b", ?}]>})
+// CHECK-SAME:      -> (tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", ?}, {"b"}]>}) {
+func.func @two_regions(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {?}]>})
+    -> (tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{?}, {"b"}]>}) {
+  // CHECK-NEXT: stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %2 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %3 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %4 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+  %1 = stablehlo.negate %0 : tensor<8x8xf32>
+  %2 = stablehlo.negate %1 : tensor<8x8xf32>
+  %3 = stablehlo.negate %2 : tensor<8x8xf32>
+  %4 = stablehlo.negate %3 : tensor<8x8xf32>
+  %5 = stablehlo.negate %4 : tensor<8x8xf32>
+  return %5 : tensor<8x8xf32>
+}
+
+// The body is partitioned into two regions of three ops, which update the
+// sharding of %2 differently. The add must not be sharded along "b", which the
+// second region derived from its own sharding of %2.
+// CHECK-LABEL: func @conflicting_boundary_value(
+func.func @conflicting_boundary_value(
+    %arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+    %arg1: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"b"}, {}]>})
+    -> tensor<8x8xf32> {
+  // CHECK-NEXT: %[[NEGATE_0:.*]] = stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_1:.*]] = stablehlo.negate %[[NEGATE_0]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_2:.*]] = stablehlo.negate %[[NEGATE_1]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_3:.*]] = stablehlo.negate %arg1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"b", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[ADD:.*]] = stablehlo.add %[[NEGATE_2]], %[[NEGATE_3]] : tensor<8x8xf32>
+  // CHECK-NEXT: return %[[ADD]]
+  %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+  %1 = stablehlo.negate %0 : tensor<8x8xf32>
+  %2 = stablehlo.negate %1 : tensor<8x8xf32>
+  %3 = stablehlo.negate %arg1 : tensor<8x8xf32>
+  %4 = stablehlo.add %2, %3 : tensor<8x8xf32>
+  return %4 : tensor<8x8xf32>
+}
+
+// The values of the sharding group are in different regions. The sharding that
+// %arg0 propagates to %0 in the first region is applied to %5 through the
+// group, and flows backward from %5 to %3 in the second region.
+// CHECK-LABEL: func @sharding_group_spanning_regions(
+func.func @sharding_group_spanning_regions(
+    %arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {}]>},
+    %arg1: tensor<8x8xf32>) -> (tensor<8x8xf32>, tensor<8x8xf32>) {
+  // CHECK-NEXT: %[[NEGATE_0:.*]] = stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_1:.*]] = stablehlo.negate %[[NEGATE_0]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_2:.*]] = stablehlo.negate %[[NEGATE_1]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_3:.*]] = stablehlo.negate %arg1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_4:.*]] = stablehlo.negate %[[NEGATE_3]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  // CHECK-NEXT: %[[NEGATE_5:.*]] = stablehlo.negate %[[NEGATE_4]] {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {?}]>]>}
+  %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+  %1 = stablehlo.negate %0 : tensor<8x8xf32>
+  %2 = stablehlo.negate %1 : tensor<8x8xf32>
+  %3 = stablehlo.negate %arg1 : tensor<8x8xf32>
+  %4 = stablehlo.negate %3 : tensor<8x8xf32>
+  %5 = stablehlo.negate %4 : tensor<8x8xf32>
+  sdy.sharding_group %0 group_id=0 : tensor<8x8xf32>
+  sdy.sharding_group %5 group_id=0 : tensor<8x8xf32>
+  return %2, %5 : tensor<8x8xf32>, tensor<8x8xf32>
+}
@@ -0,0 +1,33 @@
+// RUN: sdy_opt %s -sdy-basic-propagate='scc-scheduling=true' -mlir-pass-statistics 2>&1 | FileCheck %s --check-prefixes=CHECK,STATS
+// RUN: sdy_opt %s -sdy-basic-propagate 2>&1 | FileCheck %s
+
+sdy.mesh @mesh = <["a"=2, "b"=2]>
+
+// Every op becomes saturated once it's propagated through, since all axes of
+// the mesh are used, so each op is only visited once.
+// CHECK-LABEL: func @all_axes_used(
+// CHECK-SAME:      -> (tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", ?}, {"b", ?}]>}) {
+func.func @all_axes_used(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {"b"}]>}) -> tensor<8x8xf32> {
+  // CHECK-NEXT: stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %1 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", ?}, {"b", ?}]>]>}
+  %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+  %1 = stablehlo.negate %0 : tensor<8x8xf32>
+  %2 = stablehlo.negate %1 : tensor<8x8xf32>
+  return %2 : tensor<8x8xf32>
+}
+
+// The second dimension of the argument is open, but all axes of the mesh are
+// already used by the first dimension.
+// CHECK-LABEL: func @open_dim_all_axes_used(
+func.func @open_dim_all_axes_used(%arg0: tensor<8x8xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a", "b"}, {?}]>}) -> tensor<8x8xf32> {
+  // CHECK-NEXT: stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", "b", ?}, {?}]>]>}
+  // CHECK-NEXT: stablehlo.negate %0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a", "b", ?}, {?}]>]>}
+  %0 = stablehlo.negate %arg0 : tensor<8x8xf32>
+  %1 = stablehlo.negate %0 : tensor<8x8xf32>
+  return %1 : tensor<8x8xf32>
+}
+
+// STATS: BasicPropagationPass
+// STATS-DAG: (S) {{[0-9]+}} saturated-ops
+// STATS-DAG: (S) {{[0-9]+}} scc-op-visits
@@ -0,0 +1,23 @@
+// RUN: sdy_opt %s -sdy-estimate-peak-memory='top-n=2' -verify-diagnostics
+
+sdy.mesh @mesh = <["a"=2, "b"=4]>
+
+// The peak is reached at %2, where %arg0 (64 bytes), %arg1 (512 bytes), %1
+// (512 bytes) and %2 (512 bytes) are live.
+// expected-remark@+2 {{estimated peak per-device memory of 1600 bytes}}
+// expected-note@+1 {{512 bytes live at peak}}
+func.func @peak_in_the_middle(%arg0: tensor<8x16xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {"b"}]>}, %arg1: tensor<8x16xf32>) -> tensor<8x16xf32> {
+  %0 = stablehlo.add %arg0, %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a"}, {}]>]>} : tensor<8x16xf32>
+  // expected-note@+1 {{512 bytes live at peak}}
+  %1 = stablehlo.add %0, %arg1 : tensor<8x16xf32>
+  %2 = stablehlo.negate %1 : tensor<8x16xf32>
+  return %2 : tensor<8x16xf32>
+}
+
+// expected-remark@+2 {{estimated peak per-device memory of 320 bytes}}
+// expected-note@+1 {{64 bytes live at peak with sharding #sdy.sharding<@mesh, [{"a"}, {"b"}]>}}
+func.func @sharded_values(%arg0: tensor<8x16xf32> {sdy.sharding = #sdy.sharding<@mesh, [{"a"}, {"b"}]>}) -> tensor<8x16xf32> {
+  // expected-note@+1 {{256 bytes live at peak with sharding #sdy.sharding<@mesh, [{"a"}, {}]>}}
+  %0 = stablehlo.negate %arg0 {sdy.sharding = #sdy.sharding_per_value<[<@mesh, [{"a"}, {}]>]>} : tensor<8x16xf32>
+  return %0 : tensor<8x16xf32>
+}
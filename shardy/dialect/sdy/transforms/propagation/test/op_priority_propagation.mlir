@@ -1,4 +1,5 @@
 // RUN: sdy_opt %s -sdy-op-priority-propagate 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-op-priority-propagate='parallel-propagation-regions=2' -mlir-pass-statistics 2>&1 | FileCheck %s --check-prefixes=CHECK,STATS
 
 sdy.mesh @mesh = <["a"=2, "b"=2]>
 
@@ -130,3 +131,7 @@ func.func @manual_computation(%arg0: tensor<32x32xf32> {sdy.sharding = #sdy.shar
   %4 = sdy.data_flow_edge %0 sharding=<@mesh, [{"a", ?}, {?}]> : tensor<32x32xf32>
   func.return %4: tensor<32x32xf32>
 }
+
+// Regions aren't propagated through concurrently with op priorities.
+// STATS: OpPriorityPropagationPass
+// STATS: (S) 0 parallel-propagation-rounds
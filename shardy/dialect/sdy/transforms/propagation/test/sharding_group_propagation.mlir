@@ -1,4 +1,5 @@
 // RUN: sdy_opt %s -sdy-basic-propagate 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-basic-propagate='per-function-propagation=true' 2>&1 | FileCheck %s
 
 sdy.mesh @mesh = <["a"=2, "b"=2, "c"=2, "d"=2]>
 
@@ -1,4 +1,5 @@
 // RUN: sdy_opt %s -sdy-user-priority-propagate 2>&1 | FileCheck %s
+// RUN: sdy_opt %s -sdy-user-priority-propagate='parallel-propagation-regions=2' -mlir-pass-statistics 2>&1 | FileCheck %s --check-prefixes=CHECK,STATS
 
 sdy.mesh @mesh = <["a"=2, "b"=2, "c"=2]>
 sdy.mesh @maximal_mesh = <[], device_ids=[0]>
@@ -376,3 +377,7 @@ func.func @maximal_sharding_no_results(%arg0: tensor<8x8xf32>) -> tensor<8x8xf32
   stablehlo.custom_call @foo(%arg0) {has_side_effect = true, sdy.sharding = #sdy.sharding_per_value<[<@maximal_mesh, []>]>} : (tensor<8x8xf32>) -> ()
   return %arg0 : tensor<8x8xf32>
 }
+
+// Regions aren't propagated through concurrently with user priorities.
+// STATS: UserPriorityPropagationPass
+// STATS: (S) 0 parallel-propagation-rounds
@@ -241,6 +241,9 @@ LogicalResult UserPriorityPropagationPassImpl::propagate(
     GetDirectionToPropagateFn getDirectionToPropagate) {
   SmallVector<PriorityShardingReferences> shardingReferencesPerPriority =
       getShardingReferencesPerPriorityAndInitialize(moduleOp, symbolTable);
+  // Regions can't be propagated through concurrently, since the shardings of
+  // later priorities must not be committed before earlier ones.
+  prioritizedPropagation = !shardingReferencesPerPriority.empty();
   // We first run the first iteration (priority 0):
   if (failed(OpPriorityPropagationPassImpl::propagate(
           moduleOp, symbolTable, shardingGroupMap, getDirectionToPropagate))) {
@@ -19,8 +19,10 @@ limitations under the License.
 #include <iterator>
 
 #include "llvm/ADT/BitVector.h"  // IWYU pragma: keep
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"  // IWYU pragma: keep
+#include "llvm/ADT/StringRef.h"
 #include "mlir/Support/LLVM.h"
 #include "shardy/dialect/sdy/ir/dialect.h"
 
@@ -69,5 +71,24 @@ bool isFullyReplicated(TensorShardingAttr sharding) {
                       });
 }
 
+bool isSaturated(TensorShardingAttr sharding, MeshAttr mesh) {
+  if (!sharding || !mesh) {
+    return false;
+  }
+  if (sharding.isFullyClosed()) {
+    return true;
+  }
+  // A sub-axis leaves the rest of its full axis free, so only full axes count.
+  llvm::SmallDenseSet<StringRef> usedAxes;
+  sharding.forEachAxisRef([&](AxisRefAttr axisRef) {
+    if (!axisRef.getSubAxisInfo()) {
+      usedAxes.insert(axisRef.getName());
+    }
+  });
+  return llvm::all_of(mesh.getAxes(), [&](MeshAxisAttr axis) {
+    return usedAxes.contains(axis.getName());
+  });
+}
+
 }  // namespace sdy
 }  // namespace mlir
@@ -45,6 +45,14 @@ PropagationDirection intersectionOfPropagationDirections(
 // Returns whether all dimensions are fully replicated.
 bool isFullyReplicated(TensorShardingAttr sharding);
 
+// Returns whether propagation can no longer update `sharding`, i.e., all its
+// dimensions are closed, or every axis of `mesh` is already used in full by a
+// dimension sharding or the replicated axes, so no open dimension can be
+// further sharded.
+//
+// Returns false if `sharding` is null.
+bool isSaturated(TensorShardingAttr sharding, MeshAttr mesh);
+
 }  // namespace sdy
 }  // namespace mlir
 
@@ -0,0 +1,177 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shardy/integrations/c/propagation.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir-c/IR.h"
+#include "mlir-c/Support.h"
+#include "mlir/CAPI/IR.h"
+#include "mlir/CAPI/Support.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "shardy/dialect/sdy/ir/dialect.h"
+#include "shardy/dialect/sdy/transforms/propagation/incremental_propagation.h"
+#include "shardy/dialect/sdy/transforms/propagation/op_sharding_rule_registry.h"
+#include "shardy/dialect/sdy/transforms/propagation/sharding_evaluation.h"
+
+namespace {
+
+namespace sdy = ::mlir::sdy;
+
+sdy::IncrementalPropagation* unwrapSession(SdyIncrementalPropagation session) {
+  return static_cast<sdy::IncrementalPropagation*>(session.ptr);
+}
+
+llvm::SmallVector<sdy::ShardingEvaluation>* unwrapEvaluations(
+    SdyShardingEvaluations evaluations) {
+  return static_cast<llvm::SmallVector<sdy::ShardingEvaluation>*>(
+      evaluations.ptr);
+}
+
+// Owns the `userData` of a `SdyCustomCallShardingRuleCallback`.
+class CustomCallShardingRuleUserData {
+ public:
+  CustomCallShardingRuleUserData(void* userData, void (*destroy)(void*))
+      : userData(userData), destroy(destroy) {}
+  CustomCallShardingRuleUserData(const CustomCallShardingRuleUserData&) =
+      delete;
+  CustomCallShardingRuleUserData& operator=(
+      const CustomCallShardingRuleUserData&) = delete;
+  ~CustomCallShardingRuleUserData() {
+    if (destroy) {
+      destroy(userData);
+    }
+  }
+
+  void* get() const { return userData; }
+
+ private:
+  void* userData;
+  void (*destroy)(void*);
+};
+
+}  // namespace
+
+SdyIncrementalPropagation sdyIncrementalPropagationCreate(MlirModule module) {
+  return {new sdy::IncrementalPropagation(unwrap(module))};
+}
+
+void sdyIncrementalPropagationDestroy(SdyIncrementalPropagation session) {
+  delete unwrapSession(session);
+}
+
+MlirLogicalResult sdyIncrementalPropagationPropagate(
+    SdyIncrementalPropagation session) {
+  return wrap(unwrapSession(session)->propagate());
+}
+
+MlirLogicalResult sdyIncrementalPropagationPropagateFromValues(
+    SdyIncrementalPropagation session, intptr_t nValues,
+    const MlirValue* values) {
+  llvm::SmallVector<mlir::Value> unwrappedValues;
+  unwrappedValues.reserve(nValues);
+  for (intptr_t i = 0; i < nValues; ++i) {
+    unwrappedValues.push_back(unwrap(values[i]));
+  }
+  return wrap(unwrapSession(session)->propagateFromValues(unwrappedValues));
+}
+
+MlirLogicalResult sdyIncrementalPropagationPropagateFromOps(
+    SdyIncrementalPropagation session, intptr_t nOps,
+    const MlirOperation* ops) {
+  llvm::SmallVector<mlir::Operation*> unwrappedOps;
+  unwrappedOps.reserve(nOps);
+  for (intptr_t i = 0; i < nOps; ++i) {
+    unwrappedOps.push_back(unwrap(ops[i]));
+  }
+  return wrap(unwrapSession(session)->propagateFromOps(unwrappedOps));
+}
+
+void sdyIncrementalPropagationNotifyOpErased(SdyIncrementalPropagation session,
+                                             MlirOperation op) {
+  unwrapSession(session)->notifyOpErased(unwrap(op));
+}
+
+SdyShardingEvaluations sdyEvaluateShardingCandidates(
+    MlirModule module, MlirAttribute mesh, intptr_t nCandidates,
+    const intptr_t* candidateSizes, const MlirValue* values,
+    const MlirAttribute* shardings) {
+  llvm::SmallVector<sdy::ShardingCandidate> candidates(nCandidates);
+  intptr_t pos = 0;
+  for (intptr_t candidateIndex = 0; candidateIndex < nCandidates;
+       ++candidateIndex) {
+    for (intptr_t i = 0; i < candidateSizes[candidateIndex]; ++i, ++pos) {
+      candidates[candidateIndex].emplace_back(
+          unwrap(values[pos]),
+          mlir::cast_or_null<sdy::TensorShardingAttr>(unwrap(shardings[pos])));
+    }
+  }
+  sdy::ShardingEvaluator evaluator(
+      unwrap(module), mlir::cast<sdy::MeshAttr>(unwrap(mesh)));
+  return {new llvm::SmallVector<sdy::ShardingEvaluation>(
+      evaluator.evaluateAll(candidates))};
+}
+
+void sdyShardingEvaluationsDestroy(SdyShardingEvaluations evaluations) {
+  delete unwrapEvaluations(evaluations);
+}
+
+intptr_t sdyShardingEvaluationsGetSize(SdyShardingEvaluations evaluations) {
+  return unwrapEvaluations(evaluations)->size();
+}
+
+int64_t sdyShardingEvaluationsGetCommunicationBytes(
+    SdyShardingEvaluations evaluations, intptr_t pos) {
+  return (*unwrapEvaluations(evaluations))[pos].communicationBytes;
+}
+
+int64_t sdyShardingEvaluationsGetPeakMemoryBytes(
+    SdyShardingEvaluations evaluations, intptr_t pos) {
+  return (*unwrapEvaluations(evaluations))[pos].peakMemoryBytes;
+}
+
+MlirAttribute sdyShardingEvaluationsGetSharding(
+    SdyShardingEvaluations evaluations, intptr_t pos, MlirValue value) {
+  return wrap((*unwrapEvaluations(evaluations))[pos].shardings.getSharding(
+      unwrap(value)));
+}
+
+void sdyRegisterCustomCallShardingRule(
+    MlirStringRef callTargetName, SdyCustomCallShardingRuleCallback callback,
+    void* userData, void (*destroyUserData)(void*)) {
+  auto ownedUserData = std::make_shared<CustomCallShardingRuleUserData>(
+      userData, destroyUserData);
+  sdy::CustomCallShardingRuleRegistry::setCallback(
+      unwrap(callTargetName),
+      [callback, ownedUserData](mlir::Operation* customCall,
+                                bool conservativePropagation) {
+        return mlir::dyn_cast_or_null<sdy::OpShardingRuleAttr>(unwrap(callback(
+            wrap(customCall), conservativePropagation, ownedUserData->get())));
+      });
+}
+
+void sdyUnregisterCustomCallShardingRule(MlirStringRef callTargetName) {
+  sdy::CustomCallShardingRuleRegistry::erase(unwrap(callTargetName));
+}
+
+bool sdyIsCustomCallShardingRuleRegistered(MlirStringRef callTargetName) {
+  return sdy::CustomCallShardingRuleRegistry::isRegistered(
+      unwrap(callTargetName));
+}
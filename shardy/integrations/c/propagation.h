@@ -0,0 +1,133 @@
+/* Copyright 2024 The Shardy Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SHARDY_INTEGRATIONS_C_PROPAGATION_H_
+#define SHARDY_INTEGRATIONS_C_PROPAGATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "mlir-c/IR.h"
+#include "mlir-c/Support.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//===----------------------------------------------------------------------===//
+// IncrementalPropagation
+//===----------------------------------------------------------------------===//
+
+/// A session that re-propagates a module after some of its shardings were
+/// edited. The module must outlive the session.
+typedef struct SdyIncrementalPropagation {
+  void* ptr;
+} SdyIncrementalPropagation;
+
+MLIR_CAPI_EXPORTED SdyIncrementalPropagation
+sdyIncrementalPropagationCreate(MlirModule module);
+
+MLIR_CAPI_EXPORTED void sdyIncrementalPropagationDestroy(
+    SdyIncrementalPropagation session);
+
+/// Propagates shardings through the entire module.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+sdyIncrementalPropagationPropagate(SdyIncrementalPropagation session);
+
+/// Re-propagates after the shardings of `values` were edited.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+sdyIncrementalPropagationPropagateFromValues(SdyIncrementalPropagation session,
+                                             intptr_t nValues,
+                                             const MlirValue* values);
+
+/// Re-propagates after `ops` were added to the module or modified.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+sdyIncrementalPropagationPropagateFromOps(SdyIncrementalPropagation session,
+                                          intptr_t nOps,
+                                          const MlirOperation* ops);
+
+/// Stops tracking the shardings of `op`, which must be called before `op` is
+/// erased from the module.
+MLIR_CAPI_EXPORTED void sdyIncrementalPropagationNotifyOpErased(
+    SdyIncrementalPropagation session, MlirOperation op);
+
+//===----------------------------------------------------------------------===//
+// ShardingEvaluations
+//===----------------------------------------------------------------------===//
+
+/// The results of propagating from candidate shardings of a module, without
+/// modifying it. The module must outlive the results.
+typedef struct SdyShardingEvaluations {
+  void* ptr;
+} SdyShardingEvaluations;
+
+/// Propagates from each of `nCandidates` candidates concurrently, and
+/// estimates the cost of the resulting shardings w.r.t. `mesh`. Candidate `i`
+/// sets the shardings of the next `candidateSizes[i]` entries of `values` to
+/// the corresponding entries of `shardings`.
+MLIR_CAPI_EXPORTED SdyShardingEvaluations sdyEvaluateShardingCandidates(
+    MlirModule module, MlirAttribute mesh, intptr_t nCandidates,
+    const intptr_t* candidateSizes, const MlirValue* values,
+    const MlirAttribute* shardings);
+
+MLIR_CAPI_EXPORTED void sdyShardingEvaluationsDestroy(
+    SdyShardingEvaluations evaluations);
+
+MLIR_CAPI_EXPORTED intptr_t
+sdyShardingEvaluationsGetSize(SdyShardingEvaluations evaluations);
+
+MLIR_CAPI_EXPORTED int64_t sdyShardingEvaluationsGetCommunicationBytes(
+    SdyShardingEvaluations evaluations, intptr_t pos);
+
+MLIR_CAPI_EXPORTED int64_t sdyShardingEvaluationsGetPeakMemoryBytes(
+    SdyShardingEvaluations evaluations, intptr_t pos);
+
+/// Returns the sharding of `value` after propagating from candidate `pos`, or
+/// a null attribute if it has none.
+MLIR_CAPI_EXPORTED MlirAttribute sdyShardingEvaluationsGetSharding(
+    SdyShardingEvaluations evaluations, intptr_t pos, MlirValue value);
+
+//===----------------------------------------------------------------------===//
+// CustomCallShardingRules
+//===----------------------------------------------------------------------===//
+
+/// Creates the sharding rule of a `stablehlo.custom_call` op. Returns a null
+/// attribute if the op has no sharding rule. May be called concurrently from
+/// multiple threads.
+typedef MlirAttribute (*SdyCustomCallShardingRuleCallback)(
+    MlirOperation customCall, bool conservativePropagation, void* userData);
+
+/// Registers `callback` for custom calls with the given `callTargetName`,
+/// replacing any callback already registered for it, including built-in ones.
+/// `destroyUserData` (if not null) is called with `userData` once the callback
+/// is replaced or unregistered.
+MLIR_CAPI_EXPORTED void sdyRegisterCustomCallShardingRule(
+    MlirStringRef callTargetName, SdyCustomCallShardingRuleCallback callback,
+    void* userData, void (*destroyUserData)(void*));
+
+/// Unregisters the callback of `callTargetName`, if any.
+MLIR_CAPI_EXPORTED void sdyUnregisterCustomCallShardingRule(
+    MlirStringRef callTargetName);
+
+/// Returns true if a callback is registered for `callTargetName`.
+MLIR_CAPI_EXPORTED bool sdyIsCustomCallShardingRuleRegistered(
+    MlirStringRef callTargetName);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SHARDY_INTEGRATIONS_C_PROPAGATION_H_
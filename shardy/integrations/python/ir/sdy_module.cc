@@ -14,8 +14,11 @@ limitations under the License.
 ==============================================================================*/
 
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -24,12 +27,15 @@ limitations under the License.
 #include "mlir-c/Support.h"
 #include "mlir/Bindings/Python/NanobindAdaptors.h"  // IWYU pragma: keep
 #include "nanobind/nanobind.h"
-#include "nanobind/stl/optional.h"  // IWYU pragma: keep
-#include "nanobind/stl/string.h"    // IWYU pragma: keep
-#include "nanobind/stl/variant.h"   // IWYU pragma: keep
-#include "nanobind/stl/vector.h"    // IWYU pragma: keep
+#include "nanobind/stl/optional.h"    // IWYU pragma: keep
+#include "nanobind/stl/pair.h"        // IWYU pragma: keep
+#include "nanobind/stl/string.h"      // IWYU pragma: keep
+#include "nanobind/stl/unique_ptr.h"  // IWYU pragma: keep
+#include "nanobind/stl/variant.h"     // IWYU pragma: keep
+#include "nanobind/stl/vector.h"      // IWYU pragma: keep
 #include "shardy/integrations/c/attributes.h"
 #include "shardy/integrations/c/dialect.h"
+#include "shardy/integrations/c/propagation.h"
 
 namespace mlir {
 namespace sdy {
@@ -70,6 +76,119 @@ MlirAttribute toMeshOrRefAttr(
   return std::get<MlirAttribute>(meshOrRef);
 }
 
+void throwIfFailed(MlirLogicalResult result, const char* message) {
+  if (mlirLogicalResultIsFailure(result)) {
+    throw std::runtime_error(message);
+  }
+}
+
+// Owns an `SdyIncrementalPropagation` session.
+class PyIncrementalPropagation {
+ public:
+  explicit PyIncrementalPropagation(MlirModule module)
+      : session(sdyIncrementalPropagationCreate(module)) {}
+  PyIncrementalPropagation(const PyIncrementalPropagation&) = delete;
+  PyIncrementalPropagation& operator=(const PyIncrementalPropagation&) =
+      delete;
+  ~PyIncrementalPropagation() { sdyIncrementalPropagationDestroy(session); }
+
+  void propagate() {
+    throwIfFailed(sdyIncrementalPropagationPropagate(session),
+                  "propagation failed");
+  }
+
+  void propagateFromValues(const std::vector<MlirValue>& values) {
+    throwIfFailed(sdyIncrementalPropagationPropagateFromValues(
+                      session, values.size(), values.data()),
+                  "incremental propagation failed");
+  }
+
+  void propagateFromOps(const std::vector<MlirOperation>& ops) {
+    throwIfFailed(sdyIncrementalPropagationPropagateFromOps(
+                      session, ops.size(), ops.data()),
+                  "incremental propagation failed");
+  }
+
+  void notifyOpErased(MlirOperation op) {
+    sdyIncrementalPropagationNotifyOpErased(session, op);
+  }
+
+ private:
+  SdyIncrementalPropagation session;
+};
+
+// Owns the `SdyShardingEvaluations` of a list of candidates.
+class PyShardingEvaluations {
+ public:
+  explicit PyShardingEvaluations(SdyShardingEvaluations evaluations)
+      : evaluations(evaluations) {}
+  PyShardingEvaluations(const PyShardingEvaluations&) = delete;
+  PyShardingEvaluations& operator=(const PyShardingEvaluations&) = delete;
+  ~PyShardingEvaluations() { sdyShardingEvaluationsDestroy(evaluations); }
+
+  intptr_t size() const { return sdyShardingEvaluationsGetSize(evaluations); }
+
+  void checkIndex(intptr_t index) const {
+    if (index < 0 || index >= size()) {
+      throw nb::index_error();
+    }
+  }
+
+  int64_t getCommunicationBytes(intptr_t index) const {
+    checkIndex(index);
+    return sdyShardingEvaluationsGetCommunicationBytes(evaluations, index);
+  }
+
+  int64_t getPeakMemoryBytes(intptr_t index) const {
+    checkIndex(index);
+    return sdyShardingEvaluationsGetPeakMemoryBytes(evaluations, index);
+  }
+
+  std::optional<MlirAttribute> getSharding(intptr_t index,
+                                           MlirValue value) const {
+    checkIndex(index);
+    MlirAttribute sharding =
+        sdyShardingEvaluationsGetSharding(evaluations, index, value);
+    if (mlirAttributeIsNull(sharding)) {
+      return std::nullopt;
+    }
+    return sharding;
+  }
+
+ private:
+  SdyShardingEvaluations evaluations;
+};
+
+// Invokes the Python callable in `userData` to create the sharding rule of
+// `customCall`. Errors are reported as unraisable exceptions, in which case no
+// sharding rule is created, since they can't be propagated through the C API.
+MlirAttribute invokePyCustomCallShardingRule(MlirOperation customCall,
+                                             bool conservativePropagation,
+                                             void* userData) {
+  nb::gil_scoped_acquire acquire;
+  try {
+    nb::object rule = (*static_cast<nb::callable*>(userData))(
+        customCall, conservativePropagation);
+    if (rule.is_none()) {
+      return {nullptr};
+    }
+    return nb::cast<MlirAttribute>(rule);
+  } catch (nb::python_error& e) {
+    e.discard_as_unraisable("custom call sharding rule");
+  } catch (const nb::cast_error&) {
+    PyErr_SetString(PyExc_TypeError,
+                    "custom call sharding rule must return an "
+                    "OpShardingRuleAttr or None");
+    PyErr_WriteUnraisable(nullptr);
+  }
+  return {nullptr};
+}
+
+void destroyPyCustomCallShardingRule(void* userData) {
+  nb::gil_scoped_acquire acquire;
+  delete static_cast<nb::callable*>(userData);
+}
+
 NB_MODULE(_sdy, m) {
   m.doc() = "SDY main Python extension";
 
@@ -398,6 +517,97 @@ NB_MODULE(_sdy, m) {
       .def("__len__", [](MlirAttribute& self) {
         return sdyManualAxesAttrGetAxesSize(self);
       });
+
+  //
+  // Propagation.
+  //
+
+  nb::class_<PyIncrementalPropagation>(m, "IncrementalPropagation")
+      .def(nb::init<MlirModule>(), nb::arg("module"),
+           nb::keep_alive<1, 2>(),
+           "Creates a session that re-propagates `module` after some of its "
+           "shardings were edited.")
+      .def("propagate", &PyIncrementalPropagation::propagate,
+           "Propagates shardings through the entire module.")
+      .def("propagate_from_values",
+           &PyIncrementalPropagation::propagateFromValues, nb::arg("values"),
+           "Re-propagates after the shardings of `values` were edited.")
+      .def("propagate_from_ops", &PyIncrementalPropagation::propagateFromOps,
+           nb::arg("ops"),
+           "Re-propagates after `ops` were added to the module or modified.")
+      .def("notify_op_erased", &PyIncrementalPropagation::notifyOpErased,
+           nb::arg("op"),
+           "Stops tracking the shardings of `op`, which must be called before "
+           "`op` is erased from the module.");
+
+  nb::class_<PyShardingEvaluations>(m, "ShardingEvaluations")
+      .def("__len__", &PyShardingEvaluations::size)
+      .def("communication_bytes", &PyShardingEvaluations::getCommunicationBytes,
+           nb::arg("index"))
+      .def("peak_memory_bytes", &PyShardingEvaluations::getPeakMemoryBytes,
+           nb::arg("index"))
+      .def("get_sharding", &PyShardingEvaluations::getSharding,
+           nb::arg("index"), nb::arg("value"),
+           "Returns the sharding of `value` after propagating from candidate "
+           "`index`, or None if it has none.");
+
+  m.def(
+      "evaluate_sharding_candidates",
+      [](MlirModule module, MlirAttribute mesh,
+         const std::vector<std::vector<std::pair<MlirValue, MlirAttribute>>>&
+             candidates) {
+        std::vector<intptr_t> candidateSizes;
+        std::vector<MlirValue> values;
+        std::vector<MlirAttribute> shardings;
+        for (const auto& candidate : candidates) {
+          candidateSizes.push_back(candidate.size());
+          for (const auto& [value, sharding] : candidate) {
+            values.push_back(value);
+            shardings.push_back(sharding);
+          }
+        }
+        return std::make_unique<PyShardingEvaluations>(
+            sdyEvaluateShardingCandidates(module, mesh, candidates.size(),
+                                          candidateSizes.data(), values.data(),
+                                          shardings.data()));
+      },
+      nb::arg("module"), nb::arg("mesh"), nb::arg("candidates"),
+      nb::keep_alive<0, 1>(),
+      "Propagates from each candidate list of (value, sharding) pairs "
+      "concurrently without modifying `module`, and returns the resulting "
+      "shardings and estimated costs.");
+
+  //
+  // Custom call sharding rules.
+  //
+
+  m.def(
+      "register_custom_call_sharding_rule",
+      [](const std::string& callTargetName, nb::callable ruleFn) {
+        sdyRegisterCustomCallShardingRule(
+            toStringRef(callTargetName), invokePyCustomCallShardingRule,
+            new nb::callable(std::move(ruleFn)),
+            destroyPyCustomCallShardingRule);
+      },
+      nb::arg("call_target_name"), nb::arg("rule_fn"),
+      "Registers `rule_fn(op, conservative_propagation)`, which returns an "
+      "`OpShardingRuleAttr` or None, as the sharding rule of custom calls "
+      "with `call_target_name`. Replaces any rule already registered for it. "
+      "`rule_fn` may be called from propagation threads other than the "
+      "calling one.");
+  m.def(
+      "unregister_custom_call_sharding_rule",
+      [](const std::string& callTargetName) {
+        sdyUnregisterCustomCallShardingRule(toStringRef(callTargetName));
+      },
+      nb::arg("call_target_name"));
+  m.def(
+      "is_custom_call_sharding_rule_registered",
+      [](const std::string& callTargetName) {
+        return sdyIsCustomCallShardingRuleRegistered(
+            toStringRef(callTargetName));
+      },
+      nb::arg("call_target_name"));
 }
 
 }  // namespace